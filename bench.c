@@ -0,0 +1,235 @@
+/*	Micro-benchmarks of RDS decoders
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	Decoders are run over fixed synthetic corpora built by rdsgen, so
+	numbers are comparable between builds. Results are printed one JSON
+	object per line:
+
+	{"bench":"gt02a","groups":1000000,"ns_group":10.5,"groups_s":95238095,
+	 "cycles_group":31.2,"allocs":0}
+
+	cycles_group is null if CPU cycles counter is not available, allocs is
+	number of malloc/calloc/realloc calls per run, see --wrap in Makefile.
+*/
+#include <time.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "rds.h"
+#include "rdsgen.h"
+#include "rdsmon.h"
+
+#define BENCH_CORPUS 4096 // groups in corpus, fits into L1 cache
+#define BENCH_GROUPS 1000000
+#define BENCH_REPEAT 5
+
+static uint32_t allocs;
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+	allocs++;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+	allocs++;
+	return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	allocs++;
+	return __real_realloc(ptr, size);
+}
+}
+
+typedef struct bench_s
+{
+	const char *name;
+	const char *sched; // corpus group types
+	int (*parse)(const uint16_t *prds, void *pgt);
+	uint16_t pr_mask;  // for rds_mon_group() runs
+} bench_t;
+
+// calling a parser through a cast function pointer is undefined,
+// so every one gets a wrapper with the exact bench_t signature
+#define PARSE(gt) \
+static int parse_##gt(const uint16_t *prds, void *pgt) \
+{ \
+	return rds_parse_##gt(prds, (rds_##gt##_t *)pgt); \
+}
+
+PARSE(gt00a)
+PARSE(gt01a)
+PARSE(gt02a)
+PARSE(gt03a)
+PARSE(gt04a)
+PARSE(gt05a)
+PARSE(gt08a)
+PARSE(gt10a)
+PARSE(gt14a)
+
+static const bench_t benches[] = {
+	{ "gt00a", "0A",  parse_gt00a, 0 },
+	{ "gt01a", "1A",  parse_gt01a, 0 },
+	{ "gt02a", "2A",  parse_gt02a, 0 },
+	{ "gt03a", "3A",  parse_gt03a, 0 },
+	{ "gt04a", "4A",  parse_gt04a, 0 },
+	{ "gt05a", "5A",  parse_gt05a, 0 },
+	{ "gt08a", "8A",  parse_gt08a, 0 },
+	{ "gt10a", "10A", parse_gt10a, 0 },
+	{ "gt14a", "14A", parse_gt14a, 0 },
+	// full path of cmd_monitor_si() without and with printing
+	{ "dispatch", NULL, NULL, 0 },
+	{ "format",   NULL, NULL, 0xFFFF },
+};
+
+static uint64_t bench_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec;
+}
+
+static int bench_cycles_open(void)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CPU_CYCLES;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t bench_cycles(int fd, int start)
+{
+	uint64_t cycles = 0;
+	if (fd < 0)
+		return 0;
+	if (start) {
+		ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		return 0;
+	}
+	ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+	if (read(fd, &cycles, sizeof(cycles)) != sizeof(cycles))
+		return 0;
+	return cycles;
+}
+
+static void bench_corpus(uint16_t *corpus, const char *sched)
+{
+	gen_station_t st;
+	gen_station_init(&st, 0xC201, 9500);
+	// clock-time is inserted every minute, keep time still for single type corpora
+	if (sched) {
+		gen_set_sched(&st, sched);
+		st.ct_min = 0;
+	}
+	for(int i = 0; i < BENCH_CORPUS; i++)
+		gen_group(&st, sched ? 0 : i*876/10000, &corpus[i*4]);
+}
+
+static uint64_t bench_run(const bench_t *b, const uint16_t *corpus, uint32_t ngroups, int out)
+{
+	// union of all decoders state, any parser can write into it
+	static union {
+		rds_gt00a_t gt00a; rds_gt01a_t gt01a; rds_gt02a_t gt02a;
+		rds_gt03a_t gt03a; rds_gt04a_t gt04a; rds_gt05a_t gt05a;
+		rds_gt08a_t gt08a; rds_gt10a_t gt10a; rds_gt14a_t gt14a;
+	} gt;
+	static rds_mon_t mon;
+
+	memset(&gt, 0, sizeof(gt));
+	rds_mon_init(&mon, b->pr_mask, 1);
+
+	uint64_t start = bench_ns();
+	if (b->parse) {
+		for(uint32_t i = 0; i < ngroups; i++)
+			b->parse(&corpus[(i % BENCH_CORPUS)*4], &gt);
+	}
+	else {
+		for(uint32_t i = 0; i < ngroups; i++)
+			rds_mon_group(out, &mon, &corpus[(i % BENCH_CORPUS)*4]);
+	}
+	return bench_ns() - start;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t ngroups = (argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_GROUPS;
+	int repeat = (argc > 2) ? atoi(argv[2]) : BENCH_REPEAT;
+	int out = open("/dev/null", O_WRONLY);
+	int perf = bench_cycles_open();
+	uint16_t *corpus = (uint16_t *)malloc(BENCH_CORPUS*4*sizeof(uint16_t));
+
+	if (!ngroups || repeat <= 0 || out < 0 || !corpus)
+		return 1;
+
+	for(size_t n = 0; n < sizeof(benches)/sizeof(benches[0]); n++) {
+		const bench_t *b = &benches[n];
+		bench_corpus(corpus, b->sched);
+
+		// warm up, then keep the best run
+		bench_run(b, corpus, ngroups/10 + 1, out);
+		uint64_t best = ~0ull, cycles = 0;
+		uint32_t nalloc = 0;
+		for(int r = 0; r < repeat; r++) {
+			allocs = 0;
+			bench_cycles(perf, 1);
+			uint64_t ns = bench_run(b, corpus, ngroups, out);
+			uint64_t cy = bench_cycles(perf, 0);
+			if (ns < best) {
+				best = ns;
+				cycles = cy;
+				nalloc = allocs;
+			}
+		}
+
+		double ns_group = (double)best/ngroups;
+		printf("{\"bench\":\"%s\",\"groups\":%u,\"ns_group\":%.2f,\"groups_s\":%.0f,",
+			b->name, ngroups, ns_group, best ? ngroups*1e9/best : 0.0);
+		if (cycles)
+			printf("\"cycles_group\":%.1f,", (double)cycles/ngroups);
+		else
+			printf("\"cycles_group\":null,");
+		printf("\"allocs\":%u}\n", nalloc);
+		fflush(stdout);
+	}
+
+	free(corpus);
+	if (perf >= 0)
+		close(perf);
+	close(out);
+	return 0;
+}
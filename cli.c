@@ -50,6 +50,22 @@ static int seek_proc(console_io_t *cli, char *arg, void *ptr);
 static int volume_proc(console_io_t *cli, char *arg, void *ptr);
 static int set_proc(console_io_t *cli, char *arg, void *ptr);
 static int rds_proc(console_io_t *cli, char *arg, void *ptr);
+static int replay_proc(console_io_t *cli, char *arg, void *ptr);
+static int decode_proc(console_io_t *cli, char *arg, void *ptr);
+static int query_proc(console_io_t *cli, char *arg, void *ptr);
+static int index_proc(console_io_t *cli, char *arg, void *ptr);
+static int search_proc(console_io_t *cli, char *arg, void *ptr);
+static int gen_proc(console_io_t *cli, char *arg, void *ptr);
+static int bench_proc(console_io_t *cli, char *arg, void *ptr);
+static int trace_proc(console_io_t *cli, char *arg, void *ptr);
+static int fdr_proc(console_io_t *cli, char *arg, void *ptr);
+static int status_proc(console_io_t *cli, char *arg, void *ptr);
+static int state_proc(console_io_t *cli, char *arg, void *ptr);
+static int daemon_proc(console_io_t *cli, char *arg, void *ptr);
+static int batch_proc(console_io_t *cli, char *arg, void *ptr);
+static int duty_proc(console_io_t *cli, char *arg, void *ptr);
+static int harvest_proc(console_io_t *cli, char *arg, void *ptr);
+static int verify_proc(console_io_t *cli, char *arg, void *ptr);
 
 typedef int (cmd_proc)(console_io_t *cli, char *arg, void *ptr);
 static struct command_s {
@@ -73,6 +89,22 @@ static struct command_s {
 	{ "volume", volume_proc },
 	{ "set", set_proc },
 	{ "rds", rds_proc },
+	{ "replay", replay_proc },
+	{ "decode", decode_proc },
+	{ "query", query_proc },
+	{ "index", index_proc },
+	{ "search", search_proc },
+	{ "gen", gen_proc },
+	{ "bench", bench_proc },
+	{ "trace", trace_proc },
+	{ "fdr", fdr_proc },
+	{ "status", status_proc },
+	{ "state", state_proc },
+	{ "daemon", daemon_proc },
+	{ "batch", batch_proc },
+	{ "duty", duty_proc },
+	{ "harvest", harvest_proc },
+	{ "verify", verify_proc },
 	{ NULL, NULL }
 };
 extern cmd_t commands[];
@@ -180,3 +212,83 @@ int rds_proc(console_io_t *cli, char *arg, UNUSED(void *ptr))
 {
 	return cmd_monitor(cli->ofd, arg);
 }
+
+int replay_proc(console_io_t *cli, char *arg, UNUSED(void *ptr))
+{
+	return cmd_replay(cli->ofd, arg);
+}
+
+int decode_proc(console_io_t *cli, char *arg, UNUSED(void *ptr))
+{
+	return cmd_decode(cli->ofd, arg);
+}
+
+int query_proc(console_io_t *cli, char *arg, UNUSED(void *ptr))
+{
+	return cmd_query(cli->ofd, arg);
+}
+
+int index_proc(console_io_t *cli, char *arg, UNUSED(void *ptr))
+{
+	return cmd_index(cli->ofd, arg);
+}
+
+int search_proc(console_io_t *cli, char *arg, UNUSED(void *ptr))
+{
+	return cmd_search(cli->ofd, arg);
+}
+
+int gen_proc(console_io_t *cli, char *arg, UNUSED(void *ptr))
+{
+	return cmd_gen(cli->ofd, arg);
+}
+
+int bench_proc(console_io_t *cli, char *arg, UNUSED(void *ptr))
+{
+	return cmd_bench(cli->ofd, arg);
+}
+
+int trace_proc(console_io_t *cli, char *arg, UNUSED(void *ptr))
+{
+	return cmd_trace(cli->ofd, arg);
+}
+
+int fdr_proc(console_io_t *cli, char *arg, UNUSED(void *ptr))
+{
+	return cmd_fdr(cli->ofd, arg);
+}
+
+int status_proc(console_io_t *cli, char *arg, UNUSED(void *ptr))
+{
+	return cmd_status(cli->ofd, arg);
+}
+
+int daemon_proc(console_io_t *cli, char *arg, UNUSED(void *ptr))
+{
+	return cmd_daemon(cli->ofd, arg);
+}
+
+int state_proc(console_io_t *cli, char *arg, UNUSED(void *ptr))
+{
+	return cmd_state(cli->ofd, arg);
+}
+
+int batch_proc(console_io_t *cli, char *arg, UNUSED(void *ptr))
+{
+	return cmd_batch(cli->ofd, arg);
+}
+
+int duty_proc(console_io_t *cli, char *arg, UNUSED(void *ptr))
+{
+	return cmd_duty(cli->ofd, arg);
+}
+
+int harvest_proc(console_io_t *cli, char *arg, UNUSED(void *ptr))
+{
+	return cmd_harvest(cli->ofd, arg);
+}
+
+int verify_proc(console_io_t *cli, char *arg, UNUSED(void *ptr))
+{
+	return cmd_verify(cli->ofd, arg);
+}
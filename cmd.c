@@ -19,12 +19,31 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <time.h>
 
 #include "cmd.h"
 #include "cli.h"
 #include "rds.h"
 #include "pi2c.h"
+#include "rdsarc.h"
+#include "rdsd.h"
+#include "rdsevt.h"
+#include "rdscap.h"
+#include "rdsgen.h"
+#include "rdsmon.h"
+#include "rdsqry.h"
+#include "sifdr.h"
+#include "rdsrx.h"
+#include "rdsshm.h"
+#include "rdstxt.h"
 #include "si4703.h"
+#include "sibatch.h"
+#include "siready.h"
+#include "sibench.h"
+#include "siharv.h"
+#include "trace.h"
+#include "wbuf.h"
+#include "jsonw.h"
 #include "rpi_pin.h"
 
 #define RSSI_LIMIT 35
@@ -64,43 +83,202 @@ int cmd_is(char *str, const char *is)
 	return cmd_arg(str, is, NULL);
 }
 
-int cmd_reset(int fd, UNUSED(char *arg))
+// removes '--json' from arguments, returns 1 if it was there
+static int cmd_json(char *arg)
+{
+	char *p = arg;
+	while(p && (p = strstr(p, "--json")) != NULL) {
+		if ((p == arg || p[-1] <= ' ') && p[6] <= ' ') {
+			memmove(p, p + 6, strlen(p + 6) + 1);
+			for(p = arg + strlen(arg); p > arg && p[-1] <= ' '; p--)
+				p[-1] = '\0';
+			return 1;
+		}
+		p += 6;
+	}
+	return 0;
+}
+
+static void cmd_json_regs(int fd, uint16_t *regs)
+{
+	wbuf_t wb;
+	jw_t jw;
+	wbuf_init(&wb, fd);
+	jw_begin(&jw, &wb, "regs");
+	jw_uint(&jw, "freq", si_get_freq(regs)*10);
+	jw_uint(&jw, "rssi", regs[STATUSRSSI] & RSSI);
+	jw_bool(&jw, "stereo", regs[STATUSRSSI] & STEREO);
+	jw_arr(&jw, "regs");
+	for(int i = 0; i < 16; i++)
+		jw_hex(&jw, NULL, regs[i], 4);
+	jw_arr_end(&jw);
+	jw_end(&jw);
+	wbuf_flush(&wb);
+}
+
+// frequency and RSSI part of scan and spectrum line
+static void cmd_station_rssi(wbuf_t *wb, int freq, uint8_t rssi, int stereo)
+{
+	wbuf_uint(wb, freq, 5);
+	wbuf_putc(wb, ' ');
+	wbuf_fill(wb, '-', rssi);
+	wbuf_putc(wb, ' ');
+	wbuf_uint(wb, rssi, 0);
+	if (stereo)
+		wbuf_puts(wb, " ST");
+}
+
+// scan and spectrum line, 'pi' is -1 if PS is not known, 'shown' if
+// cmd_station_rssi() part was already flushed while PS was collected
+static void cmd_station(wbuf_t *wb, int json, int freq, uint8_t rssi, int stereo, int pi, const char *ps, int shown)
+{
+	if (json) {
+		jw_t jw;
+		jw_begin(&jw, wb, "station");
+		jw_uint(&jw, "freq", freq*10);
+		jw_uint(&jw, "rssi", rssi);
+		jw_bool(&jw, "stereo", stereo);
+		if (pi != -1) {
+			jw_hex(&jw, "pi", pi, 4);
+			jw_str(&jw, "ps", ps);
+		}
+		jw_end(&jw);
+	}
+	else {
+		if (!shown)
+			cmd_station_rssi(wb, freq, rssi, stereo);
+		if (pi != -1) {
+			wbuf_putc(wb, ' ');
+			wbuf_hex(wb, pi, 4);
+			wbuf_printf(wb, " '%s'", ps);
+		}
+		wbuf_putc(wb, '\n');
+	}
+	wbuf_flush(wb);
+}
+
+#define RESET_RSSI_MS   200 // first valid RSSI after tune
+#define RESET_STABLE_MS 200 // settled RSSI and AFC after tune
+
+// 'reset' skips everything if radio is already up, 'reset cold' does not,
+// 'reset learn' measures crystal start up again instead of learned value
+int cmd_reset(int fd, char *arg)
 {
 	uint16_t si_regs[16];
-	si_read_regs(si_regs);
+	int cold = 0, verbose = 0, learn = 0;
+	uint64_t start = rpi_micros();
+
+	while(arg && *arg) {
+		char *next = cmd_word(arg);
+		if (cmd_is(arg, "cold"))
+			cold = 1;
+		else if (cmd_is(arg, "learn"))
+			cold = learn = 1;
+		else if (cmd_is(arg, "verbose"))
+			verbose = 1;
+		else
+			return CLI_EARG;
+		arg = next;
+	}
+
+	if (!cold && si_probe(si_regs) == SI_WARM) {
+		si_dump(fd, si_regs, "Warm start:\n", 16);
+		dprintf(fd, "Ready in %u ms\n", (uint32_t)((rpi_micros() - start)/1000));
+		return 0;
+	}
 
-	rpi_pin_set_dir(SI_RESET, RPI_OUTPUT);
+	// reset pin is exported only when it is needed
+	if (rpi_pin_set_dir(SI_RESET, RPI_OUTPUT) != 0)
+		rpi_pin_export(SI_RESET, RPI_OUTPUT);
 	rpi_pin_set(SI_RESET, 0);
-	rpi_delay_ms(10);
-	rpi_pin_set_dir(SI_RESET, RPI_INPUT);
 	rpi_delay_ms(1);
+	rpi_pin_set_dir(SI_RESET, RPI_INPUT);
 
-	if (si_read_regs(si_regs) != 0) {
+	int ready = -1;
+	for(int i = 0; i < 10 && ready < 0; i++) {
+		rpi_delay_ms(1);
+		ready = si_probe(si_regs);
+	}
+	if (ready < 0) {
 		dprintf(fd, "Unable to read Si4703!\n");
 		return CLI_ENODEV;
 	}
-	si_dump(fd, si_regs, "Reset Map:\n", 16);
+	if (verbose)
+		si_dump(fd, si_regs, "Reset Map:\n", 16);
+
+	// first reset on this unit polls power up right after oscillator start,
+	// STC comes long before crystal is stable, so the time counts only if
+	// RSSI and AFC settle after tune
+	si_ready_t rd;
+	int learned = (si_ready_load(&rd, si_regs[CHIPID]) == 0) && !learn;
+	uint32_t wait = learned ? si_ready_wait(&rd) : 0;
 
 	// enable the oscillator
 	si_regs[TEST1] |= XOSCEN;
 	si_update(si_regs);
-	rpi_delay_ms(500); // recommended delay
-	si_read_regs(si_regs);
-	si_dump(fd, si_regs, "\nOscillator enabled:\n", 16);
+	uint64_t xosc = rpi_micros();
+	rpi_delay_ms(wait);
+	if (verbose) {
+		si_read_regs(si_regs);
+		si_dump(fd, si_regs, "\nOscillator enabled:\n", 16);
+	}
 	// the only way to reliable start the device is to powerdown and powerup
 	// just powering up does not work for me after cold start
 	uint8_t powerdown[2] = { 0, PWR_DISABLE | PWR_ENABLE };
 	pi2c_write(PI2C_BUS, powerdown, 2);
-	rpi_delay_ms(110);
 
-	cmd_power(fd, const_cast<char *>("up"));
 	// tune to the local station with known signal strength
-	si_tune(si_regs, DEFAULT_STATION);
-	// si_tune() does not update registers
-	si_update(si_regs);
-	rpi_delay_ms(10);
+	uint32_t power = 0;
+	int ms = si_powerup(si_regs, DEFAULT_STATION, SI_XOSC_MS + SI_READY_MS, &power);
+	// crystal was stable when the successful power up attempt started
+	uint32_t xosc_ms = (rpi_micros() - xosc)/1000 - power;
+	int rssi = (ms < 0) ? -1 : si_wait_rssi(si_regs, RESET_RSSI_MS);
+	int stable = (ms < 0) ? -1 : si_wait_stable(si_regs, RESET_STABLE_MS);
+	if (ms >= 0 && stable < 0) {
+		// no sign of stable crystal, power up again after datasheet time
+		uint32_t elapsed = (rpi_micros() - xosc)/1000;
+		if (elapsed < SI_XOSC_MS)
+			rpi_delay_ms(SI_XOSC_MS - elapsed);
+		pi2c_write(PI2C_BUS, powerdown, 2);
+		ms = si_powerup(si_regs, DEFAULT_STATION, SI_READY_MS, &power);
+		rssi = (ms < 0) ? -1 : si_wait_rssi(si_regs, RESET_RSSI_MS);
+		xosc_ms = SI_XOSC_MS;
+	}
 	si_read_regs(si_regs);
-	si_dump(fd, si_regs, "\nTuned\n", 16);
+	si_dump(fd, si_regs, verbose ? "\nTuned\n" : "Tuned\n", 16);
+	if (ms < 0) {
+		dprintf(fd, "Si4703 is not ready after %u ms\n", SI_XOSC_MS + SI_READY_MS);
+		return CLI_ENODEV;
+	}
+
+	if (stable < 0) {
+		// nothing measured, next reset learns again
+		rd.xosc_ms = SI_XOSC_MS;
+		rd.resets = 0;
+	}
+	else if (!learned || xosc_ms > wait + SI_TUNE_MS) {
+		// learned time was too short, or first measurement
+		rd.xosc_ms = xosc_ms;
+	}
+	if (rd.resets) {
+		rd.power_ms = (rd.power_ms*3 + power)/4;
+		rd.rssi_ms  = (rssi < 0) ? rd.rssi_ms : (rd.rssi_ms*3 + rssi)/4;
+	}
+	else {
+		rd.power_ms = power;
+		rd.rssi_ms  = (rssi < 0) ? 0 : rssi;
+	}
+	if (stable >= 0)
+		rd.resets++;
+	if (si_ready_save(&rd) != 0)
+		dprintf(fd, "Unable to save timings to %s\n", getenv(SI_READY_ENV) ? getenv(SI_READY_ENV) : SI_READY_FILE);
+
+	dprintf(fd, "Ready in %u ms: crystal %u ms%s (waited %u), power up %u ms, ",
+		(uint32_t)((rpi_micros() - start)/1000), xosc_ms, (stable < 0) ? " not confirmed" : "", wait, power);
+	if (rssi < 0)
+		dprintf(fd, "no RSSI\n");
+	else
+		dprintf(fd, "RSSI %d ms\n", rssi);
 	return 0;
 }
 
@@ -112,8 +290,11 @@ int cmd_power(int fd, char *arg)
 
 	if (arg && *arg) {
 		if (cmd_is(arg, "up")) {
-			si_power(si_regs, PWR_ENABLE);
+			int ms = si_power(si_regs, PWR_ENABLE);
 			si_dump(fd, si_regs, "\nPowerup:\n", 16);
+			if (ms < 0)
+				return CLI_ENODEV;
+			dprintf(fd, "Ready in %d ms\n", ms);
 			return 0;
 		}
 		if (cmd_is(arg, "down")) {
@@ -127,11 +308,15 @@ int cmd_power(int fd, char *arg)
 	return 0;
 }
 
-int cmd_dump(int fd, char *arg __attribute__((unused)))
+int cmd_dump(int fd, char *arg)
 {
 	uint16_t si_regs[16];
+	int json = cmd_json(arg);
 	if (si_read_regs(si_regs) == 0) {
-		si_dump(fd, si_regs, "Registers map:\n", 16);
+		if (json)
+			cmd_json_regs(fd, si_regs);
+		else
+			si_dump(fd, si_regs, "Registers map:\n", 16);
 		return 0;
 	}
 	return CLI_ENODEV;
@@ -139,6 +324,7 @@ int cmd_dump(int fd, char *arg __attribute__((unused)))
 
 static int get_ps_si(char *ps_name, uint16_t *regs, int timeout)
 {
+	TRACE_SPAN(TRACE_GET_PS);
 	int dt = 0;
 	rds_gt00a_t rd;
 	memset(&rd, 0, sizeof(rd));
@@ -173,6 +359,7 @@ int cmd_scan(int fd, char *arg)
 	int nstations = 0;
 	int freq, seek = 0;
 	uint16_t si_regs[16];
+	int json = cmd_json(arg);
 
 	if (si_read_regs(si_regs) != 0)
 		return CLI_ENODEV;
@@ -186,40 +373,16 @@ int cmd_scan(int fd, char *arg)
 	}
 
 	si_set_channel(si_regs, 0);
-	dprintf(fd, "scanning, press any key to terminate...\n");
+	if (!json)
+		dprintf(fd, "scanning, press any key to terminate...\n");
 
 	if (mode > 0) {
-		si_regs[SYSCONF2] &= 0x00FF;
-		si_regs[SYSCONF3] &= 0xFF00;
-		uint16_t conf2 = 0;
-		uint16_t conf3 = 0;
-
-		if (mode == 1) {
-			conf2 = 0x1900;
-			conf3 = 0x0000;
-		}
-		if (mode == 2) {
-			conf2 = 0x1900;
-			conf3 = 0x0048;
-		}
-		if (mode == 3) {
-			conf2 = 0x0C00;
-			conf3 = 0x0048;
-		}
-		if (mode == 4) {
-			conf2 = 0x0C00;
-			conf3 = 0x007F;
-		}
-		if (mode == 5) {
-			conf2 = 0x0000;
-			conf3 = 0x004F;
-		}
-		si_regs[SYSCONF2] |= conf2;
-		si_regs[SYSCONF3] |= conf3;
-
+		si_set_seek_mode(si_regs, mode);
 		si_update(si_regs);
 	}
 
+	wbuf_t wb;
+	wbuf_init(&wb, fd);
 	int stop = 0;
 	while(!is_stop(&stop)) {
 		freq = si_seek(si_regs, SEEK_UP);
@@ -228,10 +391,6 @@ int cmd_scan(int fd, char *arg)
 		seek = freq;
 		nstations++;
 		uint8_t rssi = si_regs[STATUSRSSI]	& RSSI;
-		dprintf(fd, "%5d ", freq);
-		for(int si = 0; si < rssi; si++)
-			dprintf(fd, "-");
-		dprintf(fd, " %d", rssi);
 
 		int dt = 0;
 		if (rssi > RSSI_LIMIT) {
@@ -245,22 +404,26 @@ int cmd_scan(int fd, char *arg)
 		}
 		uint16_t st = si_regs[STATUSRSSI] & STEREO;
 
-		if (st) {
-			dprintf(fd, " ST");
-			if (rssi > RSSI_LIMIT) {
-				int pi;
-				char ps_name[16];
-				if ((pi = get_ps_si(ps_name, si_regs, 5000)) != -1)
-					dprintf(fd, " %04X '%s'", pi, ps_name);
+		int pi = -1;
+		char ps_name[16];
+		int shown = 0;
+		if (st && rssi > RSSI_LIMIT) {
+			// PS takes up to 5 s, show the channel meanwhile
+			if (!json) {
+				cmd_station_rssi(&wb, freq, rssi, st);
+				wbuf_flush(&wb);
+				shown = 1;
 			}
+			pi = get_ps_si(ps_name, si_regs, 5000);
 		}
-		dprintf(fd, "\n");
+		cmd_station(&wb, json, freq, rssi, st, pi, ps_name, shown);
 	}
 
 	si_regs[POWERCFG] &= ~SKMODE; // restore wrap mode
 	si_tune(si_regs, seek);
 
-	dprintf(fd, "%d stations found\n", nstations);
+	if (!json)
+		dprintf(fd, "%d stations found\n", nstations);
 	return 0;
 }
 
@@ -268,6 +431,7 @@ int cmd_spectrum(int fd, char *arg)
 {
 	uint16_t si_regs[16];
 	uint8_t rssi_limit = RSSI_LIMIT;
+	int json = cmd_json(arg);
 
 	if (si_read_regs(si_regs) != 0)
 		return CLI_ENODEV;
@@ -278,8 +442,12 @@ int cmd_spectrum(int fd, char *arg)
 	if (arg && *arg)
 		rssi_limit = (uint8_t)atoi(arg);
 
-	dprintf(fd, "scanning, press any key to terminate...\n");
+	if (!json)
+		dprintf(fd, "scanning, press any key to terminate...\n");
 
+	// every channel is printed with one write, two if PS is collected
+	wbuf_t wb;
+	wbuf_init(&wb, fd);
 	int stop = 0;
 	for (int i = 0; i <= nchan && !stop; i++, is_stop(&stop)) {
 		si_regs[CHANNEL] &= ~CHAN;
@@ -304,10 +472,6 @@ int cmd_spectrum(int fd, char *arg)
 		}
 
 		uint8_t rssi = si_regs[STATUSRSSI]	& 0xFF;
-		dprintf(fd, "%5d ", si_band[band][0] + i*si_space[space]);
-		for(int si = 0; si < rssi; si++)
-			dprintf(fd, "-");
-		dprintf(fd, " %d", rssi);
 
 		int dt = 0;
 		if (rssi > rssi_limit) {
@@ -321,16 +485,20 @@ int cmd_spectrum(int fd, char *arg)
 		}
 		uint16_t st = si_regs[STATUSRSSI] & STEREO;
 
-		if (st) {
-			dprintf(fd, " ST");
-			if (rssi > rssi_limit) {
-				int pi;
-				char ps_name[16];
-				if ((pi = get_ps_si(ps_name, si_regs, 5000)) != -1)
-					dprintf(fd, " %04X '%s'", pi, ps_name);
+		int pi = -1;
+		char ps_name[16];
+		int shown = 0;
+		int freq = si_band[band][0] + i*si_space[space];
+		if (st && rssi > rssi_limit) {
+			// PS takes up to 5 s, show the channel meanwhile
+			if (!json) {
+				cmd_station_rssi(&wb, freq, rssi, st);
+				wbuf_flush(&wb);
+				shown = 1;
 			}
+			pi = get_ps_si(ps_name, si_regs, 5000);
 		}
-		dprintf(fd, "\n");
+		cmd_station(&wb, json, freq, rssi, st, pi, ps_name, shown);
 	}
 	return 0;
 }
@@ -362,20 +530,29 @@ int cmd_seek(int fd, char *arg)
 	return 0;
 }
 
+// parses frequency as 9500, 95.00 or 95.
+int cmd_freq(char *arg, char **end)
+{
+	unsigned freq = strtol(arg, &arg, 10);
+	if (*arg == '.') {
+		unsigned decimal = strtol(arg + 1, &arg, 10);
+		if (decimal > 100)
+			decimal = 0;
+		freq = freq * 100 + decimal;
+	}
+	if (end)
+		*end = arg;
+	return freq;
+}
+
 int cmd_tune(int fd, char *arg)
 {
 	unsigned freq = DEFAULT_STATION;
 	uint16_t si_regs[16];
+	int json = cmd_json(arg);
 
-	if (arg && *arg) {
-		freq = strtol(arg, &arg, 10);
-		if (*arg == '.') {
-			unsigned decimal = strtol(arg + 1, NULL, 10);
-			if (decimal > 100)
-				decimal = 0;
-			freq = freq * 100 + decimal;
-		}
-	}
+	if (arg && *arg)
+		freq = cmd_freq(arg, NULL);
 
 	if (si_read_regs(si_regs) != 0)
 		return CLI_ENODEV;
@@ -383,8 +560,12 @@ int cmd_tune(int fd, char *arg)
 	si_read_regs(si_regs);
 	freq = si_get_freq(si_regs);
 	if (freq) {
-		dprintf(fd, "Tuned to %d.%02dMHz\n", freq/100, freq%100);
-		si_dump(fd, si_regs, "Register map:\n", 16);
+		if (json)
+			cmd_json_regs(fd, si_regs);
+		else {
+			dprintf(fd, "Tuned to %d.%02dMHz\n", freq/100, freq%100);
+			si_dump(fd, si_regs, "Register map:\n", 16);
+		}
 		return 0;
 	}
 	return -1;
@@ -417,309 +598,237 @@ int cmd_spacing(int fd, char *arg)
 	return 0;
 }
 
-// VT100 ESC codes for monitor mode
-static const char clr_all[] = { 27, '[', '2', 'J', '\0' };  // clear screen
-static const char clr_eol[] = { 27, '[', '0', 'K', '\0' };  // clear to EOL
-static const char go_top[]  = { 27, '[', '1', ';', '1', 'H','\0' }; // go top left
-static const char cur_vis[] = { 27, '[', '?', '2', '5', 'h','\0' }; // show cursor
-static const char cur_hid[] = { 27, '[', '?', '2', '5', 'l','\0' }; // hide cursor
-static const char txt_nor[] = { 27, '[', '0', 'm', '\0' }; // normal text
-static const char txt_rev[] = { 27, '[', '7', 'm', '\0' }; // reverse text
-
-static void print_rds_hdr(int fd, rds_hdr_t *phdr)
-{
-	dprintf(fd, "%04X %04X %04X %04X ", phdr->rds[0], phdr->rds[1], phdr->rds[2], phdr->rds[3]);
-	dprintf(fd, "| GT %02d%c PTY %2d TP %d | ", phdr->gt, 'A' + phdr->ver, phdr->pty, phdr->tp);
-}
-
-/* default printer for 'rds log' command */
-static void print_rds(int fd, rds_hdr_t *phdr, int log)
-{
-	print_rds_hdr(fd, phdr);
-	dprintf(fd, "%02X %04X %04X", phdr->rds[1] & 0x1F, phdr->rds[2], phdr->rds[3]);
-	dprintf(fd, "%s\n", log ? "" : clr_eol);
-}
-
-static void cmd_monitor_si(int fd, uint16_t *regs, uint16_t pr_mask, uint32_t timeout, int log)
-{
-	rds_gt00a_t rd0;
-	rds_gt01a_t rd1;
-	rds_gt02a_t rd2;
-	rds_gt03a_t rd3;
-	rds_gt04a_t rd4;
-	rds_gt05a_t rd5;
-	rds_gt08a_t rd8;
-	rds_gt10a_t rd10;
-	rds_gt14a_t rd14;
-	rds_hdr_t   rds[16];
-
-	memset(&rd0, 0, sizeof(rd0));
-	memset(&rd1, 0, sizeof(rd1));
-	memset(&rd2, 0, sizeof(rd2));
-	memset(&rd3, 0, sizeof(rd3));
-	memset(&rd5, 0, sizeof(rd5));
-	memset(&rd8, 0, sizeof(rd8));
-	memset(&rd10, 0, sizeof(rd10));
-	memset(&rd14, 0, sizeof(rd14));
-
-	uint16_t gt_mask  = 0; // mask of groups detected
-	uint16_t gta_mask = 0; // mask of A groups detected
-	uint16_t gtb_mask = 0; // mask of B groups detected
-	uint16_t rt_mask  = 0; // mask of radiotext segments processed
-	uint16_t ps_mask  = 0;
-	uint32_t endTime  = 0;
-
-	if (!log) {
-		dprintf(fd, "%s%s%s", clr_all, go_top, cur_hid);
-		dprintf(fd, "monitoring RDS, press any key to terminate...%s%s\n", clr_eol, txt_nor);
+// parses optional 'gt [0,...,15]' argument
+static uint16_t cmd_gt_mask(char **parg, uint16_t gtmask)
+{
+	char *val;
+	if (cmd_arg(*parg, "gt", &val)) {
+		gtmask = 0;
+		while(*val && isdigit(*val)) {
+			uint16_t gt = strtoul(val, &val, 10);
+			gtmask |= (1 << gt) & 0xFFFF;
+			while(*val && (*val == ',' || *val <= ' '))
+				val++;
+		}
+		*parg = val;
 	}
+	return gtmask;
+}
 
-	while(!is_stop(NULL)) {
-		if (timeout && (rt_mask == 0xFFFF) && (ps_mask == 0x0F))
-			break;
-		si_read_regs(regs);
-		if (regs[STATUSRSSI] & RDSR) {
-			rds_hdr_t hdr;
-			uint16_t gtv = RDS_GET_GT(regs[RDSB]);
-			uint8_t  ver = (regs[RDSB] >> 11) & 0x01;
-			uint8_t  gt  = (regs[RDSB] >> 12) & 0x0F;
-			hdr.gt  = gt;
-			hdr.ver = ver;
-			hdr.tp  = (regs[RDSB] >> 10) & 0x01;
-			hdr.pty = (regs[RDSB] >> 5) & 0x1F;
-			memcpy(hdr.rds, &regs[RDSA], sizeof(hdr.rds));
-			memcpy(&rds[gt], &hdr, sizeof(hdr));
-
-			gt_mask |= _BM(gt);
-			if (!ver)
-				gta_mask |= _BM(gt);
-			else
-				gtb_mask |= _BM(gt);
-
-			if (!log) {
-				dprintf(fd, "%s%s", go_top, txt_rev);
-				print_rds_hdr(fd, &hdr);
-				dprintf(fd, "monitoring RDS, press any key to terminate...%s%s\n", clr_eol, txt_nor);
-			}
-
-			// 0A: basic tuning and switching information
-			if (gtv == RDS_GT_00A) {
-				memcpy(&rd0.hdr, &hdr, sizeof(hdr));
-				rds_parse_gt00a(&regs[RDSA], &rd0);
-			}
-			// 1A: Program Item Number and slow labeling codes
-			if (gtv == RDS_GT_01A) {
-				memcpy(&rd1.hdr, &hdr, sizeof(hdr));
-				rds_parse_gt01a(&regs[RDSA], &rd1);
-			}
-			// 2A: Radiotext
-			if (gtv == RDS_GT_02A) {
-				memcpy(&rd2.hdr, &hdr, sizeof(hdr));
-				rds_parse_gt02a(&regs[RDSA], &rd2);
-			}
-			// 3A: AID for ODA
-			if (gtv == RDS_GT_03A) {
-				memcpy(&rd3.hdr, &hdr, sizeof(hdr));
-				rds_parse_gt03a(&regs[RDSA], &rd3);
-			}
-			// 4A: Clock-time and date
-			if (gtv == RDS_GT_04A) {
-				memcpy(&rd4.hdr, &hdr, sizeof(hdr));
-				rds_parse_gt04a(&regs[RDSA], &rd4);
-			}
-			// 5A: Transparent data channels or ODA
-			if (gtv == RDS_GT_05A) {
-				memcpy(&rd5.hdr, &hdr, sizeof(hdr));
-				rds_parse_gt05a(&regs[RDSA], &rd5);
-			}
-			// 8A: Traffic Message Channel
-			if (gtv == RDS_GT_08A) {
-				memcpy(&rd8.hdr, &hdr, sizeof(hdr));
-				rds_parse_gt08a(&regs[RDSA], &rd8);
-			}
-			// 10A: Program Type Name
-			if (gtv == RDS_GT_10A) {
-				memcpy(&rd10.hdr, &hdr, sizeof(hdr));
-				rds_parse_gt10a(&regs[RDSA], &rd10);
-			}
-			// 14A: Enhanced Other Networks information
-			if (gtv == RDS_GT_14A) {
-				memcpy(&rd14.hdr, &hdr, sizeof(hdr));
-				rds_parse_gt14a(&regs[RDSA], &rd14);
-			}
-
-			rpi_delay_ms(40); // Wait for the RDS bit to clear, from AN230
-			endTime += 40;
-
-			uint16_t mask = pr_mask & gta_mask;
-			if (log)
-				mask = pr_mask & _BM(gt);
-
-			if (mask & _BM(0)) {
-				ps_mask = rd0.valid;
-				print_rds_hdr(fd, &rd0.hdr);
-				dprintf(fd, "TA %d MS %c DI %X Ci %d PS '%s' AF %d %d (%d): ",
-					rd0.ta, rd0.ms, rd0.di, rd0.ci, rd0.ps, regs[RDSC] &0xFF, regs[RDSC] >> 8, rd0.naf);
-				for(int i = 0; rd0.af[i]; i++)
-					dprintf(fd, "%d ", 8750 + rd0.af[i]*10);
-				dprintf(fd, "%s\n", log ? "" : clr_eol);
-			}
-
-			if (mask & _BM(1)) {
-				print_rds_hdr(fd, &rd1.hdr);
-				dprintf(fd, "RPC %d LA %d VC %d SLC %03X ",
-					rd1.rpc, rd1.la, rd1.vc, rd1.slc);
-				if (rd1.pinc)
-					dprintf(fd, " %02d %02d:%02d", rd1.pinc >> 11,
-					(rd1.pinc >> 6) & 0x1F, rd1.pinc & 0x3F);
-				dprintf(fd, "%s\n", log ? "" : clr_eol);
-			}
+// wall clock time in ms since the Epoch
+static uint64_t cmd_epoch_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return ts.tv_sec*1000ull + ts.tv_nsec/1000000;
+}
 
-			if (mask & _BM(2)) {
-				rt_mask = rd2.valid;
-				print_rds_hdr(fd, &rd2.hdr);
-				dprintf(fd, "AB %c Si %2d ", 'A' + rd2.ab, rd2.si);
-				dprintf(fd, "RT '%s'", rd2.rt);
-				dprintf(fd, "%s\n", log ? "" : clr_eol);
-			}
+// publishes receiver state after RDSR poll, 'rds' is NULL if no group was read
+static void cmd_publish(rds_state_t *shm, rds_state_t *st, uint16_t *regs, const rds_mon_t *mon, const uint16_t *rds)
+{
+	st->updated = cmd_epoch_ms();
+	st->ngroups = mon->ngroups;
+	st->freq    = si_get_freq(regs);
+	st->rssi    = regs[STATUSRSSI] & RSSI;
+	st->stereo  = !!(regs[STATUSRSSI] & STEREO);
+	st->sync    = !!(regs[STATUSRSSI] & RDSS);
+	if (rds) {
+		st->pi  = rds[RDS_A];
+		st->pty = (rds[RDS_B] >> 5) & 0x1F;
+		st->tp  = !!(rds[RDS_B] & 0x0400);
+		st->ta  = mon->rd0.ta;
+		st->ps_valid = mon->rd0.valid;
+		st->rt_valid = mon->rd2.valid;
+		memcpy(st->ps, mon->rd0.ps, sizeof(mon->rd0.ps));
+		memcpy(st->rt, mon->rd2.rt, sizeof(mon->rd2.rt));
+	}
+	rds_shm_publish(shm, st);
+}
 
-			if (mask & _BM(3)) {
-				print_rds_hdr(fd, &rd3.hdr);
-				dprintf(fd, "AGTC %d%c Msg %04X AID %04X VC %d ",
-					rd3.agtc, rd3.ver + 'A', rd3.msg, rd3.aid, rd3.vc);
-				if (rd3.vc == 0) {
-					dprintf(fd, "LTN %d ", rd3.ltn);
-					if (rd3.afi) dprintf(fd, "AFI ");
-					if (rd3.m)	 dprintf(fd, "M ");
-					if (rd3.i)	 dprintf(fd, "I ");
-					if (rd3.n)	 dprintf(fd, "N ");
-					if (rd3.r)	 dprintf(fd, "R ");
-					if (rd3.u)	 dprintf(fd, "U ");
-				}
-				else {
-					dprintf(fd, "SID %d ", rd3.sid);
-					if (rd3.m)
-						dprintf(fd, "G %d Ta %d Tw %d Td %d", rd3.g, rd3.ta, rd3.tw, rd3.td);
-				}
-				dprintf(fd, "%s\n", log ? "" : clr_eol);
-			}
+// 'rds' command options
+typedef struct mon_opt_s
+{
+	uint16_t pr_mask;
+	uint32_t timeout;
+	int log;
+	int stat;
+	int blind;
+	int events;
+	int json;
+	uint32_t refresh; // full-screen refresh period, ms
+	cap_file_t  *cap;
+	rds_state_t *shm;
+	sinks_t     *sinks;
+} mon_opt_t;
+
+// output of cmd_monitor_si()
+typedef struct mon_out_s
+{
+	int    json;
+	wbuf_t wb; // reused for every record
+	sinks_t *sinks;
+} mon_out_t;
 
-			if (mask & _BM(4)) {
-				print_rds_hdr(fd, &rd4.hdr);
-				dprintf(fd, "%d/%02d/%02d %02d:%02d",
-					rd4.year, rd4.month, rd4.day, rd4.hour, rd4.minute);
-				if (rd4.tz_hour == 0 && rd4.tz_half == 0)
-					dprintf(fd, " UTC");
-				else
-					dprintf(fd, " TZ%c%d.%d", rd4.ts_sign ? '-' : '+',
-					rd4.tz_hour, rd4.tz_half);
-				dprintf(fd, "%s\n", log ? "" : clr_eol);
-			}
+static void cmd_out_flush(mon_out_t *out)
+{
+	if (out->sinks) {
+		sinks_write(out->sinks, out->wb.buf, out->wb.len);
+		out->wb.len = 0;
+	}
+	else
+		wbuf_flush(&out->wb);
+}
 
-			if (mask & _BM(5)) {
-				print_rds_hdr(fd, &rd5.hdr);
-				for (uint8_t i = 0; i < 32; i++) {
-					if (rd5.channel & (1u << i))
-						dprintf(fd, "TDS[%u] %04X %04X ",
-							i, rd5.tds[i][0], rd5.tds[i][1]);
-				}
-				dprintf(fd, "%s\n", log ? "" : clr_eol);
-			}
+static void cmd_print_evt(void *data, const rds_evt_t *evt)
+{
+	mon_out_t *out = (mon_out_t *)data;
+	if (out->json) {
+		jw_t jw;
+		jw_begin(&jw, &out->wb, "event");
+		rds_evt_json(&jw, evt);
+		jw_end(&jw);
+	}
+	else
+		rds_evt_print(&out->wb, evt);
+	cmd_out_flush(out);
+}
 
-			if (mask & _BM(6))
-				print_rds(fd, &rds[6], log);
-
-			if (mask & _BM(7))
-				print_rds(fd, &rds[7], log);
-
-			if (mask & _BM(8)) {
-				// check if 8A is Alert-C
-				print_rds_hdr(fd, &rd8.hdr);
-				if (rd3.agtc == 8 && rd3.ver == 0 && rd3.aid == 0xCD46) {
-					dprintf(fd, "S%d G%d CI%d ", rd8.x4, rd8.x3, rd8.x2);
-					if (rd8.x3)
-						dprintf(fd, "D%d DIR%d Ext %d Eve %d Loc %04X",
-						rd8.d, rd8.dir, rd8.ext, rd8.eve, rd8.loc);
-					else
-						dprintf(fd, "Y %04X Loc %04X", rd8.y, rd8.loc);
-				}
-				else
-					dprintf(fd, "X4 %d VC %d", rd8.x4, rd8.vc);
-				dprintf(fd, "%s\n", log ? "" : clr_eol);
-			}
+static void cmd_json_group(mon_out_t *out, uint16_t *regs, rds_mon_t *mon)
+{
+	jw_t jw;
+	jw_begin(&jw, &out->wb, "group");
+	jw_u64(&jw, "ts", cmd_epoch_ms());
+	jw_uint(&jw, "freq", si_get_freq(regs)*10);
+	jw_uint(&jw, "rssi", regs[STATUSRSSI] & RSSI);
+	rds_mon_json(&jw, mon, &regs[RDSA]);
+	jw_end(&jw);
+	cmd_out_flush(out);
+}
 
-			if (mask & _BM(9))
-				print_rds(fd, &rds[9], log);
+static void cmd_json_summary(mon_out_t *out, uint16_t *regs, rds_mon_t *mon, rds_rx_t *rx, uint32_t ms)
+{
+	jw_t jw;
+	jw_begin(&jw, &out->wb, "summary");
+	jw_uint(&jw, "freq", si_get_freq(regs)*10);
+	jw_uint(&jw, "ms", ms);
+	rds_mon_json_summary(&jw, mon);
+	jw_uint(&jw, "reads", rx->reads);
+	jw_uint(&jw, "duplicates", rx->dups);
+	jw_uint(&jw, "missed", rx->missed);
+	jw_end(&jw);
+	cmd_out_flush(out);
+}
 
-			if (mask & _BM(10)) {
-				print_rds_hdr(fd, &rd10.hdr);
-				dprintf(fd, "AB %c Ci %d PTYN '%s'", 'A' + rd10.ab, rd10.ci, rd10.ps);
-				dprintf(fd, "%s\n", log ? "" : clr_eol);
-			}
+// polls RDSR phase-locked to group arrivals or, if 'blind', with fixed delays from AN230
+static void cmd_monitor_si(int fd, uint16_t *regs, const mon_opt_t *opt)
+{
+	rds_mon_t mon;
+	rds_rx_t  rx;
+	rds_pll_t pll;
+	rds_state_t st;
+	rds_events_t ev;
+	scr_t scr;
+	mon_out_t out;
+	uint32_t endTime  = 0;
+	uint32_t timeout = opt->timeout;
+	int blind = opt->blind;
+	cap_file_t *cap = opt->cap;
+	uint16_t freq = si_get_freq(regs);
+	uint64_t start = rpi_micros();
+
+	// with '--json' groups from pr_mask are serialized instead of printed
+	rds_mon_init(&mon, opt->json ? 0 : opt->pr_mask, opt->log);
+	rds_rx_init(&rx);
+	rds_pll_init(&pll);
+	memset(&st, 0, sizeof(st));
+	out.json = opt->json;
+	out.sinks = opt->sinks;
+	wbuf_init(&out.wb, opt->sinks ? -1 : fd);
+	mon.sinks = opt->sinks;
+	if (opt->events)
+		rds_events_init(&ev, &mon, cmd_print_evt, &out);
+	rds_mon_start(fd, &mon);
+	if (!opt->log && scr_start(&scr, fd, 1, opt->refresh) == 0)
+		mon.scr = &scr;
+	if (cap)
+		cap_write_sync(cap, CAP_TUNE, freq);
 
-			if (mask & _BM(11))
-				print_rds(fd, &rds[11], log);
-
-			if (mask & _BM(12))
-				print_rds(fd, &rds[12], log);
-
-			if (mask & _BM(13))
-				print_rds(fd, &rds[13], log);
-
-			if (mask & _BM(14)) {
-				print_rds_hdr(fd, &rd14.hdr);
-				dprintf(fd, "TP %d VC %2d ", rd14.tp_on, rd14.variant);
-				dprintf(fd, "I %04X ", rd14.info);
-				dprintf(fd, "PI %04X ", rd14.pi_on);
-				dprintf(fd, "PS '%s' ", rd14.ps);
-				if (rd14.avc & _BM(13))
-					dprintf(fd, "PTY %2d TA %d ", rd14.pty >> 11, rd14.pty & 0x01);
-				if (rd14.avc & _BM(14))
-					dprintf(fd, "PIN %04X", rd14.pin);
-				dprintf(fd, "%s\n", log ? "" : clr_eol);
+	while(!is_stop(NULL)) {
+		if (timeout && rds_mon_complete(&mon))
+			break;
+		uint64_t now = rpi_micros();
+		if (blind)
+			si_read_regs(regs);
+		else
+			si_read_status(regs);
+		int rdsr = !!(regs[STATUSRSSI] & RDSR);
+		rds_rx_read(&rx, now, rdsr ? &regs[RDSA] : NULL);
+		if (rdsr) {
+			if (cap)
+				cap_write_group(cap, freq, si_get_bler(regs), &regs[RDSA]);
+			if (opt->events)
+				rds_events_group(fd, &ev, cmd_epoch_ms(), &regs[RDSA]);
+			else {
+				rds_mon_group(fd, &mon, &regs[RDSA]);
+				if (opt->json && (opt->pr_mask & (1 << (regs[RDSB] >> 12))))
+					cmd_json_group(&out, regs, &mon);
 			}
-
-			if (mask & _BM(15))
-				print_rds(fd, &rds[15], log);
+		}
+		if (opt->shm)
+			cmd_publish(opt->shm, &st, regs, &mon, rdsr ? &regs[RDSA] : NULL);
+		if (opt->sinks)
+			sinks_poll(opt->sinks);
+
+		if (blind) {
+			if (rdsr)
+				rpi_delay_ms(40); // Wait for the RDS bit to clear, from AN230
+			else
+				rpi_delay_ms(30);
 		}
 		else {
-			rpi_delay_ms(30);
-			endTime += 30;
+			uint64_t next = rds_pll_read(&pll, now, rdsr);
+			now = rpi_micros();
+			if (next > now)
+				usleep(next - now);
 		}
 
+		endTime = (rpi_micros() - start)/1000;
 		if (timeout && (endTime >= timeout))
 			break;
 	}
 
-	int freq = si_get_freq(regs);
-	dprintf(fd, "\nScanned %d.%02d ", freq/100, freq%100);
-	if (rd0.valid == 0x0F)
-		dprintf(fd, "'%s' ", rd0.ps);
-	dprintf(fd, "for %d ms\n", endTime);
-	if (rd2.valid)
-		dprintf(fd, "Radiotext: '%s'\n", rd2.rt);
-	if (!gt_mask)
-		dprintf(fd, "no RDS detected\n");
-	else {
-		dprintf(fd, "Active groups %04X:\n", gt_mask);
-		for(int i = 0; i < 16; i++) {
-			if (gta_mask & (1 << i))
-				dprintf(fd, "    %02dA %s\n", i, rds_gt_name(i, 0));
-			if (gtb_mask & (1 << i))
-				dprintf(fd, "    %02dB %s \n", i, rds_gt_name(i, 1));
+	if (mon.scr)
+		scr_stop(mon.scr);
+	if (opt->json) {
+		cmd_json_summary(&out, regs, &mon, &rx, endTime);
+		if (opt->sinks) {
+			sinks_close(opt->sinks, 1000);
+			sinks_report(fd, opt->sinks, 1);
 		}
-		dprintf(fd, "\n");
+		return;
+	}
+	rds_mon_summary(fd, &mon, si_get_freq(regs), endTime);
+	rds_rx_report(fd, &rx, opt->stat);
+	if (mon.scr && opt->stat)
+		scr_report(fd, mon.scr);
+	if (!blind)
+		rds_pll_report(fd, &pll);
+	if (opt->sinks) {
+		sinks_close(opt->sinks, 1000);
+		sinks_report(fd, opt->sinks, 0);
 	}
-	if (!log)
-		dprintf(fd, "%s", cur_vis);
 }
 
 int cmd_monitor(int fd, char *arg)
 {
-	int log = 0;
 	uint16_t si_regs[16];
-	uint16_t gtmask = 0xFFFF;
-	uint32_t timeout = DEFAULT_RDS_SCAN_TIMEOUT;
+	mon_opt_t opt;
+
+	memset(&opt, 0, sizeof(opt));
+	opt.json = cmd_json(arg);
+	opt.pr_mask = 0xFFFF;
+	opt.timeout = DEFAULT_RDS_SCAN_TIMEOUT;
+	opt.refresh = SCR_REFRESH_MS;
 
 	si_read_regs(si_regs);
 
@@ -750,29 +859,1196 @@ int cmd_monitor(int fd, char *arg)
 	}
 
 	char *val;
-	if (cmd_arg(arg, "gt", &val)) {
-		gtmask = 0;
-		while(*val && isdigit(*val)) {
-			uint16_t gt = strtoul(val, &val, 10);
-			gtmask |= (1 << gt) & 0xFFFF;
-			while(*val && (*val == ',' || *val <= ' '))
-				val++;
-		}
+	opt.pr_mask = cmd_gt_mask(&arg, opt.pr_mask);
+
+	if (cmd_arg(arg, "time", &val)) {
+		opt.timeout = strtoul(val, &val, 10)*1000; // argument - timeout in seconds
 		arg = val;
 	}
 
-	if (cmd_arg(arg, "time", &val)) {
-		timeout = strtoul(val, &val, 10)*1000; // argument - timeout in seconds
+	if (cmd_arg(arg, "log", &val)) {
+		opt.log = 1;
 		arg = val;
 	}
 
+	if (cmd_arg(arg, "refresh", &val)) {
+		opt.refresh = strtoul(val, &val, 10);
+		arg = val;
+	}
+
+	if (cmd_arg(arg, "stat", &val)) {
+		opt.stat = 1;
+		arg = val;
+	}
+
+	if (cmd_arg(arg, "blind", &val)) {
+		opt.blind = 1;
+		arg = val;
+	}
+
+	if (opt.json)
+		opt.log = 1;
+
+	// report changes only, groups are not printed
+	if (cmd_arg(arg, "events", &val)) {
+		opt.events = 1;
+		opt.log = 1;
+		opt.pr_mask = 0;
+		arg = val;
+	}
+
+	if (cmd_arg(arg, "shm", &val)) {
+		if ((opt.shm = rds_shm_create()) == NULL) {
+			dprintf(fd, "Unable to create shared memory '%s'\n", RDS_SHM_NAME);
+			return CLI_EARG;
+		}
+		arg = val;
+	}
+
+	sinks_t sinks;
+	sinks_init(&sinks);
+	while(cmd_arg(arg, "sink", &val)) {
+		char *spec = val;
+		arg = cmd_word(val);
+		if (sinks_add(&sinks, fd, spec) != 0) {
+			dprintf(fd, "Invalid sink '%s'\n", spec);
+			sinks_close(&sinks, 0);
+			rds_shm_close(opt.shm);
+			return CLI_EARG;
+		}
+		// no full-screen mode for sinks
+		opt.sinks = &sinks;
+		opt.log = 1;
+	}
+
+	cap_file_t cap;
+	if (cmd_arg(arg, "rec", &val)) {
+		if (cap_create(&cap, val) != 0) {
+			dprintf(fd, "Unable to open capture '%s'\n", val);
+			sinks_close(&sinks, 0);
+			rds_shm_close(opt.shm);
+			return CLI_EARG;
+		}
+		opt.cap = &cap;
+	}
+
+	cmd_monitor_si(fd, si_regs, &opt);
+	if (opt.cap)
+		cap_close(opt.cap);
+	rds_shm_close(opt.shm);
+	return 0;
+}
+
+// splits first word of the argument, returns the rest
+char *cmd_word(char *arg)
+{
+	while(*arg > ' ')
+		arg++;
+	if (*arg) {
+		*arg++ = '\0';
+		while(*arg && *arg <= ' ')
+			arg++;
+	}
+	return arg;
+}
+
+int cmd_replay(int fd, char *arg)
+{
+	int log = 0, fast = 0;
+	uint16_t gtmask = 0xFFFF;
+	uint64_t from = 0;
+	char *val, *name = arg;
+	cap_map_t cap;
+	rds_mon_t mon;
+
+	if (arg == NULL || *arg == '\0')
+		return CLI_EARG;
+	arg = cmd_word(arg);
+
+	if (cmd_arg(arg, "from", &val)) {
+		from = strtoull(val, &val, 10)*1000; // seconds since capture start
+		arg = val;
+	}
+	if (cmd_arg(arg, "fast", &val)) {
+		fast = 1;
+		arg = val;
+	}
+	gtmask = cmd_gt_mask(&arg, gtmask);
 	if (cmd_is(arg, "log"))
 		log = 1;
 
-	cmd_monitor_si(fd, si_regs, gtmask, timeout, log);
+	if (cap_map(&cap, name) != 0) {
+		dprintf(fd, "Unable to open capture '%s'\n", name);
+		return CLI_EARG;
+	}
+
+	int stop = 0;
+	uint16_t freq = 0;
+	uint32_t ngroups = 0;
+	uint32_t first = 0, tuned = 0, last = 0;
+	uint32_t i = from ? cap_map_seek(&cap, from) : 0;
+	uint64_t start = rpi_micros();
+
+	rds_mon_init(&mon, gtmask, log);
+	rds_mon_start(fd, &mon);
+	if (i < cap.nrec)
+		first = tuned = cap.rec[i].ms;
+	for(; i < cap.nrec; i++) {
+		const cap_rec_t *rec = cap_map_rec(&cap, i);
+		// polling stdin is not free, check it less often when replaying fast
+		if ((!fast || !(i & 0xFF)) && is_stop(&stop))
+			break;
+		if (!fast) { // keep original pace
+			uint64_t due = start + (uint64_t)(rec->ms - first)*1000;
+			uint64_t now = rpi_micros();
+			if (due > now)
+				usleep(due - now);
+		}
+		if (rec->type == CAP_TUNE) {
+			// new station, start from scratch
+			if (mon.ngroups) {
+				rds_mon_summary(fd, &mon, freq, last - tuned);
+				rds_mon_init(&mon, gtmask, log);
+				rds_mon_start(fd, &mon);
+			}
+			tuned = rec->ms;
+		}
+		freq = rec->freq;
+		if (CAP_IS_SYNC(rec))
+			continue;
+		last = rec->ms;
+		rds_mon_group(fd, &mon, rec->rds);
+		ngroups++;
+	}
+	cap_unmap(&cap);
+
+	uint64_t dt = rpi_micros() - start;
+	rds_mon_summary(fd, &mon, freq, last - tuned);
+	dprintf(fd, "Replayed %u groups in %u ms, %u groups/s\n", ngroups,
+		(uint32_t)(dt/1000), dt ? (uint32_t)(ngroups*1000000ull/dt) : 0);
+	return 0;
+}
+
+#define MAX_FILES 256
+
+int cmd_decode(int fd, char *arg)
+{
+	int jobs = 0, nfiles = 0;
+	uint16_t gtmask = 0xFFFF;
+	char *val, *files[MAX_FILES];
+
+	if (cmd_arg(arg, "jobs", &val)) {
+		jobs = strtoul(val, &val, 10);
+		arg = val;
+	}
+	gtmask = cmd_gt_mask(&arg, gtmask);
+	while(arg && *arg && *arg <= ' ')
+		arg++;
+	while(arg && *arg && nfiles < MAX_FILES) {
+		files[nfiles++] = arg;
+		arg = cmd_word(arg);
+	}
+	if (!nfiles)
+		return CLI_EARG;
+
+	arc_shard_t *shards;
+	uint64_t start = rpi_micros();
+	int nshards = arc_split(files, nfiles, &shards);
+	if (nshards < 0) {
+		dprintf(fd, "Unable to read captures\n");
+		return CLI_EARG;
+	}
+	int64_t ngroups = arc_decode(fd, shards, nshards, jobs, gtmask);
+	free(shards);
+	if (ngroups < 0)
+		return -1;
+
+	uint64_t dt = rpi_micros() - start;
+	dprintf(fd, "Decoded %lld groups in %d shards for %u ms, %u groups/s\n",
+		(long long)ngroups, nshards, (uint32_t)(dt/1000), dt ? (uint32_t)(ngroups*1000000ull/dt) : 0);
 	return 0;
 }
 
+// parses time as seconds since the Epoch or local YYYY-MM-DD[THH:MM[:SS]]
+static uint32_t cmd_time(char *arg, char **end)
+{
+	struct tm tm;
+	char *ptr;
+
+	memset(&tm, 0, sizeof(tm));
+	if ((ptr = strptime(arg, "%Y-%m-%d", &tm)) == NULL)
+		return strtoul(arg, end, 10);
+	if (*ptr == 'T' && (arg = strptime(ptr + 1, "%H:%M", &tm)) != NULL) {
+		ptr = arg;
+		if (*ptr == ':' && (arg = strptime(ptr + 1, "%S", &tm)) != NULL)
+			ptr = arg;
+	}
+	*end = ptr;
+	tm.tm_isdst = -1;
+	return mktime(&tm);
+}
+
+int cmd_query(int fd, char *arg)
+{
+	qry_t qry;
+	qry_stat_t stat;
+	int nfiles = 0;
+	char *val, *files[MAX_FILES];
+
+	qry_init(&qry);
+	while(arg && *arg) {
+		if (cmd_arg(arg, "from", &val))
+			qry.from = cmd_time(val, &arg);
+		else if (cmd_arg(arg, "to", &val))
+			qry.to = cmd_time(val, &arg);
+		else if (cmd_arg(arg, "freq", &val))
+			qry.freq = cmd_freq(val, &arg);
+		else if (cmd_arg(arg, "pi", &val))
+			qry.pi = strtoul(val, &arg, 16) & 0xFFFF;
+		else if (cmd_arg(arg, "gt", &val)) {
+			// 4A, 4B or just 4 for both versions
+			while(isdigit(*val)) {
+				uint8_t gt = strtoul(val, &val, 10) & 0x0F;
+				if (toupper(*val) == 'A' || toupper(*val) == 'B')
+					qry.gt_mask |= 1u << (gt*2 + (toupper(*val++) - 'A'));
+				else
+					qry.gt_mask |= 3u << (gt*2);
+				if (*val == ',')
+					val++;
+			}
+			arg = val;
+		}
+		else if (cmd_arg(arg, "pty", &val))
+			qry.pty = strtoul(val, &arg, 10) & 0x1F;
+		else if (cmd_arg(arg, "ta", &val))
+			qry.ta = !!strtoul(val, &arg, 10);
+		else if (cmd_arg(arg, "tp", &val))
+			qry.tp = !!strtoul(val, &arg, 10);
+		else if (cmd_arg(arg, "last", &val)) {
+			qry.mode = QRY_LAST;
+			arg = val;
+		}
+		else if (cmd_arg(arg, "count", &val)) {
+			qry.mode = QRY_COUNT;
+			arg = val;
+		}
+		else
+			break;
+		while(*arg && *arg <= ' ')
+			arg++;
+	}
+	while(arg && *arg && nfiles < MAX_FILES) {
+		files[nfiles++] = arg;
+		arg = cmd_word(arg);
+	}
+	if (!nfiles)
+		return CLI_EARG;
+
+	qry_run(fd, &qry, files, nfiles, &stat);
+	dprintf(fd, "%u matching groups, %u of %u captures skipped by index\n",
+		stat.matched, stat.skipped, stat.nfiles);
+	return 0;
+}
+
+int cmd_index(int fd, char *arg)
+{
+	int nfiles = 0;
+	char *name, *files[MAX_FILES];
+	txt_stat_t stat;
+
+	if (!arg || !*arg)
+		return CLI_EARG;
+	name = arg;
+	arg = cmd_word(arg);
+	while(arg && *arg && nfiles < MAX_FILES) {
+		files[nfiles++] = arg;
+		arg = cmd_word(arg);
+	}
+	if (!nfiles)
+		return CLI_EARG;
+
+	uint64_t start = rpi_micros();
+	if (txt_update(name, files, nfiles, &stat) != 0) {
+		dprintf(fd, "Unable to update index '%s'\n", name);
+		return -1;
+	}
+	dprintf(fd, "Added %u messages from %u captures (%u skipped) for %u ms\n",
+		stat.added, stat.nfiles - stat.skipped, stat.skipped, (uint32_t)((rpi_micros() - start)/1000));
+	dprintf(fd, "%u messages, %u words, %u bytes\n", stat.nmsg, stat.ntok, stat.size);
+	return 0;
+}
+
+int cmd_search(int fd, char *arg)
+{
+	txt_qry_t qry;
+	char *name, *val;
+
+	if (!arg || !*arg)
+		return CLI_EARG;
+	name = arg;
+	arg = cmd_word(arg);
+
+	txt_qry_init(&qry);
+	while(arg && *arg) {
+		if (cmd_arg(arg, "from", &val))
+			qry.from = cmd_time(val, &arg);
+		else if (cmd_arg(arg, "to", &val))
+			qry.to = cmd_time(val, &arg);
+		else if (cmd_arg(arg, "pi", &val))
+			qry.pi = strtoul(val, &arg, 16) & 0xFFFF;
+		else if (cmd_arg(arg, "ps", &val)) {
+			qry.kind = RDS_TEXT_PS;
+			arg = val;
+		}
+		else if (cmd_arg(arg, "rt", &val)) {
+			qry.kind = RDS_TEXT_RT;
+			arg = val;
+		}
+		else if (cmd_arg(arg, "ptyn", &val)) {
+			qry.kind = RDS_TEXT_PTYN;
+			arg = val;
+		}
+		else if (cmd_arg(arg, "sub", &val)) {
+			qry.flags |= TXT_SUBSTR;
+			arg = val;
+		}
+		else
+			break;
+		while(*arg && *arg <= ' ')
+			arg++;
+	}
+	if (!arg || !*arg)
+		return CLI_EARG;
+
+	uint64_t start = rpi_micros();
+	int n = txt_search(fd, name, &qry, arg);
+	if (n < 0)
+		return -1;
+	dprintf(fd, "%d matching messages for %u us\n", n, (uint32_t)(rpi_micros() - start));
+	return 0;
+}
+
+int cmd_gen(int fd, char *arg)
+{
+	cap_file_t cap;
+	gen_err_t err;
+	gen_station_t *st;
+	char *name, *val, *sched = NULL;
+	uint32_t ngroups = 100000, nst = 1, rate = 0, burst = 0, seed = 1;
+
+	if (!arg || !*arg)
+		return CLI_EARG;
+	name = arg;
+	arg = cmd_word(arg);
+	while(arg && *arg) {
+		if (cmd_arg(arg, "groups", &val))
+			ngroups = strtoul(val, &arg, 10);
+		else if (cmd_arg(arg, "stations", &val))
+			nst = strtoul(val, &arg, 10);
+		else if (cmd_arg(arg, "errors", &val))
+			rate = strtoul(val, &arg, 10);
+		else if (cmd_arg(arg, "burst", &val))
+			burst = strtoul(val, &arg, 10);
+		else if (cmd_arg(arg, "seed", &val))
+			seed = strtoul(val, &arg, 10);
+		else if (cmd_arg(arg, "sched", &val)) {
+			sched = val;
+			arg = cmd_word(val);
+		}
+		else
+			return CLI_EARG;
+		while(*arg && *arg <= ' ')
+			arg++;
+	}
+	if (nst == 0 || nst > 32)
+		return CLI_EARG;
+
+	st = (gen_station_t *)calloc(nst, sizeof(gen_station_t));
+	if (st == NULL)
+		return -1;
+	for(uint32_t i = 0; i < nst; i++) {
+		gen_station_init(&st[i], 0xC201 + i, gen_station_freq(i));
+		if (sched && gen_set_sched(&st[i], sched) != 0) {
+			free(st);
+			dprintf(fd, "Invalid schedule '%s'\n", sched);
+			return CLI_EARG;
+		}
+	}
+	gen_err_init(&err, seed, rate, burst);
+
+	unlink(name);
+	if (cap_create(&cap, name) != 0) {
+		free(st);
+		dprintf(fd, "Unable to create '%s'\n", name);
+		return -1;
+	}
+	setvbuf(cap.fp, NULL, _IOFBF, 1 << 20);
+
+	// stations are recorded one after another, groups are 87.6 ms apart
+	uint64_t start = rpi_micros();
+	uint64_t us = 0;
+	int ret = 0;
+	for(uint32_t i = 0; i < nst && ret == 0; i++) {
+		uint32_t n = ngroups/nst + (i < ngroups % nst);
+		cap.ms = us/1000;
+		ret = cap_write_sync(&cap, CAP_TUNE, st[i].freq);
+		for(uint32_t g = 0; g < n && ret == 0; g++, us += 87600) {
+			uint16_t rds[4];
+			cap.ms = us/1000;
+			gen_group(&st[i], cap.hdr.start + us/1000000, rds);
+			ret = cap_write_group(&cap, st[i].freq, gen_errors(&err, rds), rds);
+		}
+	}
+	uint64_t size = sizeof(cap_hdr_t) + (uint64_t)cap.nrec*sizeof(cap_rec_t);
+	cap_close(&cap);
+	free(st);
+	if (ret != 0)
+		return -1;
+
+	uint64_t dt = rpi_micros() - start;
+	dprintf(fd, "Generated %u groups, %llu bytes for %u ms, %u groups/s\n", ngroups,
+		(unsigned long long)size, (uint32_t)(dt/1000), dt ? (uint32_t)(ngroups*1000000ull/dt) : 0);
+	return 0;
+}
+
+int cmd_bench(int fd, char *arg)
+{
+	sib_opt_t opt;
+	char *val, *json = NULL;
+
+	sib_init(&opt);
+	while(arg && *arg) {
+		if (cmd_arg(arg, "reads", &val))
+			opt.reads = strtoul(val, &arg, 10);
+		else if (cmd_arg(arg, "tunes", &val))
+			opt.tunes = strtoul(val, &arg, 10);
+		else if (cmd_arg(arg, "seeks", &val))
+			opt.seeks = strtoul(val, &arg, 10);
+		else if (cmd_arg(arg, "rds", &val))
+			opt.rds_ms = strtoul(val, &arg, 10)*1000;
+		else if (cmd_arg(arg, "json", &val)) {
+			json = val;
+			arg = cmd_word(val);
+		}
+		else
+			return CLI_EARG;
+		while(*arg && *arg <= ' ')
+			arg++;
+	}
+
+	return sib_run(fd, &opt, json ? json : "bench.json");
+}
+
+// station data collected by harvester, 'ms' is time to complete or -1
+static void cmd_harv_st(jw_t *jw, wbuf_t *wb, const harv_st_t *st, int ms)
+{
+	char names[32];
+	harv_names(names, st->have);
+	if (jw) {
+		jw_uint(jw, "freq", st->freq*10);
+		jw_int(jw, "complete_ms", ms);
+		jw_str(jw, "have", names);
+		if (st->have & HARV_PI)
+			jw_hex(jw, "pi", st->pi, 4);
+		if (st->have & HARV_PTY)
+			jw_uint(jw, "pty", st->pty);
+		if (st->have & HARV_PS)
+			jw_str(jw, "ps", st->ps);
+		if (st->have & HARV_RT)
+			jw_str(jw, "rt", st->rt);
+		if (st->have & HARV_CT) {
+			char ct[32];
+			snprintf(ct, sizeof(ct), "%d-%02d-%02dT%02d:%02d", st->ct.year, st->ct.month,
+				st->ct.day, st->ct.hour, st->ct.minute);
+			jw_str(jw, "ct", ct);
+		}
+		return;
+	}
+	wbuf_printf(wb, "%d.%02d ", st->freq/100, st->freq%100);
+	if (ms < 0)
+		wbuf_printf(wb, "incomplete, have %s", names);
+	else
+		wbuf_printf(wb, "complete in %d ms", ms);
+	if (st->have & HARV_PI)
+		wbuf_printf(wb, " PI %04X", st->pi);
+	if (st->have & HARV_PTY)
+		wbuf_printf(wb, " PTY %u", st->pty);
+	if (st->have & HARV_PS)
+		wbuf_printf(wb, " PS '%s'", st->ps);
+	if (st->have & HARV_CT)
+		wbuf_printf(wb, " CT %d/%02d/%02d %02d:%02d", st->ct.year, st->ct.month,
+			st->ct.day, st->ct.hour, st->ct.minute);
+	if (st->have & HARV_RT)
+		wbuf_printf(wb, " RT '%s'", st->rt);
+}
+
+// sleeps 'ms' in short steps to stay responsive to a key press
+static int cmd_sleep(uint32_t ms)
+{
+	while(ms) {
+		uint32_t step = (ms > 100) ? 100 : ms;
+		rpi_delay_ms(step);
+		ms -= step;
+		if (is_stop(NULL))
+			return -1;
+	}
+	return 0;
+}
+
+// powers up, collects RDS, powers down and sleeps until the next window
+int cmd_duty(int fd, char *arg)
+{
+	uint16_t si_regs[16];
+	harv_st_t st;
+	wbuf_t wb;
+	jw_t jw;
+	char *val;
+	uint8_t need = HARV_PI | HARV_PS | HARV_RT;
+	uint32_t budget = 10000, period = 300, cycles = 0;
+	int json = cmd_json(arg);
+
+	if (!arg || !*arg)
+		return CLI_EARG;
+	memset(&st, 0, sizeof(st));
+	st.freq = cmd_freq(arg, &arg);
+	while(arg && *arg) {
+		while(*arg && *arg <= ' ')
+			arg++;
+		if (*arg == '\0')
+			break;
+		if (cmd_arg(arg, "need", &val)) {
+			arg = cmd_word(val);
+			if (harv_parse(val, &need) != 0)
+				return CLI_EARG;
+		}
+		else if (cmd_arg(arg, "budget", &val))
+			budget = strtoul(val, &arg, 10);
+		else if (cmd_arg(arg, "period", &val))
+			period = strtoul(val, &arg, 10);
+		else if (cmd_arg(arg, "cycles", &val))
+			cycles = strtoul(val, &arg, 10);
+		else
+			return CLI_EARG;
+	}
+	if (period == 0 || budget >= period*1000)
+		return CLI_EARG;
+
+	if (si_read_regs(si_regs) != 0)
+		return CLI_ENODEV;
+	wbuf_init(&wb, fd);
+
+	uint32_t n = 0, ncomplete = 0;
+	uint64_t on_total = 0, complete_total = 0, start = rpi_micros();
+	uint16_t powercfg = 0;
+	while(!cycles || n < cycles) {
+		uint64_t t0 = rpi_micros();
+		// first power up sets band and RDS, later ones only restore registers
+		int power;
+		if (n == 0)
+			power = si_powerup(si_regs, st.freq, SI_READY_MS, NULL);
+		else {
+			si_regs[POWERCFG] = powercfg;
+			power = si_wakeup(si_regs, SI_READY_MS);
+		}
+		if (power < 0) {
+			dprintf(fd, "Si4703 is not ready after %u ms\n", SI_READY_MS);
+			return CLI_ENODEV;
+		}
+		int ms = harv_collect(si_regs, &st, need, budget, cmd_epoch_ms()/1000);
+		powercfg = si_regs[POWERCFG];
+		si_power(si_regs, PWR_DISABLE);
+		uint32_t on = (rpi_micros() - t0)/1000;
+
+		n++;
+		on_total += on;
+		if (ms >= 0) {
+			ncomplete++;
+			complete_total += ms;
+		}
+		if (json) {
+			jw_begin(&jw, &wb, "cycle");
+			jw_u64(&jw, "ts", cmd_epoch_ms());
+			jw_uint(&jw, "cycle", n);
+			jw_uint(&jw, "on_ms", on);
+			jw_uint(&jw, "power_ms", power);
+			cmd_harv_st(&jw, &wb, &st, ms);
+			jw_end(&jw);
+		}
+		else {
+			wbuf_printf(&wb, "cycle %u on %u ms, power up %d ms, ", n, on, power);
+			cmd_harv_st(NULL, &wb, &st, ms);
+			wbuf_putc(&wb, '\n');
+		}
+		wbuf_flush(&wb);
+
+		if (cycles && n == cycles)
+			break;
+		uint64_t next = t0 + period*1000000ull;
+		uint64_t now = rpi_micros();
+		if (next > now && cmd_sleep((next - now)/1000) != 0)
+			break;
+	}
+
+	// fraction of time the tuner was powered, in 0.1%
+	uint32_t elapsed = (rpi_micros() - start)/1000;
+	uint32_t duty = elapsed ? on_total*1000/elapsed : 0;
+	if (json) {
+		jw_begin(&jw, &wb, "duty");
+		jw_uint(&jw, "cycles", n);
+		jw_uint(&jw, "complete", ncomplete);
+		jw_u64(&jw, "on_ms", n ? on_total/n : 0);
+		jw_u64(&jw, "complete_ms", ncomplete ? complete_total/ncomplete : 0);
+		jw_uint(&jw, "duty_permille", duty);
+		jw_end(&jw);
+	}
+	else
+		wbuf_printf(&wb, "%u cycles, %u complete, on %u ms and complete in %u ms on average, powered %u.%u%% of %u s\n",
+			n, ncomplete, n ? (uint32_t)(on_total/n) : 0,
+			ncomplete ? (uint32_t)(complete_total/ncomplete) : 0, duty/10, duty%10, elapsed/1000);
+	wbuf_flush(&wb);
+	return 0;
+}
+
+// age of every item in 'need', -1 if never collected
+static void cmd_harv_age(jw_t *jw, wbuf_t *wb, const harv_st_t *st, uint8_t need, uint32_t now)
+{
+	static const char *names[HARV_ITEMS] = { "pi", "pty", "ps", "rt", "ct" };
+	if (jw)
+		jw_obj(jw, "age");
+	for(int i = 0; i < HARV_ITEMS; i++) {
+		if (!(need & (1 << i)))
+			continue;
+		int age = st->seen[i] ? (int)(now - st->seen[i]) : -1;
+		if (jw)
+			jw_int(jw, names[i], age);
+		else if (age < 0)
+			wbuf_printf(wb, " %s never", names[i]);
+		else
+			wbuf_printf(wb, " %s %d s", names[i], age);
+	}
+	if (jw)
+		jw_obj_end(jw);
+}
+
+// visits stations in turn, dwelling only as long as stale items need
+int cmd_harvest(int fd, char *arg)
+{
+	uint16_t si_regs[16];
+	uint16_t freqs[HARV_MAX];
+	uint32_t nfreq = 0;
+	uint8_t need = HARV_PI | HARV_PTY | HARV_PS | HARV_RT | HARV_CT;
+	uint32_t fresh = 600, budget = 10000, rounds = 1;
+	char *val;
+	wbuf_t wb;
+	jw_t jw;
+	int json = cmd_json(arg);
+
+	while(arg && *arg) {
+		while(*arg && *arg <= ' ')
+			arg++;
+		if (*arg == '\0')
+			break;
+		if (isdigit(*arg)) {
+			// comma separated list of frequencies
+			while(isdigit(*arg) && nfreq < HARV_MAX) {
+				freqs[nfreq++] = cmd_freq(arg, &arg);
+				if (*arg == ',')
+					arg++;
+			}
+			if (*arg && *arg > ' ')
+				return CLI_EARG;
+		}
+		else if (cmd_arg(arg, "need", &val)) {
+			arg = cmd_word(val);
+			if (harv_parse(val, &need) != 0)
+				return CLI_EARG;
+		}
+		else if (cmd_arg(arg, "fresh", &val))
+			fresh = strtoul(val, &arg, 10);
+		else if (cmd_arg(arg, "budget", &val))
+			budget = strtoul(val, &arg, 10);
+		else if (cmd_arg(arg, "rounds", &val))
+			rounds = strtoul(val, &arg, 10);
+		else
+			return CLI_EARG;
+	}
+
+	harv_cache_t *hc = (harv_cache_t *)malloc(sizeof(harv_cache_t));
+	if (hc == NULL)
+		return -1;
+	harv_load(hc);
+	// without a list all cached stations are harvested
+	if (nfreq == 0) {
+		for(uint32_t i = 0; i < hc->n; i++)
+			freqs[nfreq++] = hc->st[i].freq;
+	}
+	if (nfreq == 0) {
+		free(hc);
+		dprintf(fd, "No stations to harvest\n");
+		return CLI_EARG;
+	}
+	// powered down by 'duty' or never reset
+	if (si_probe(si_regs) != SI_WARM && si_powerup(si_regs, freqs[0], SI_READY_MS, NULL) < 0) {
+		free(hc);
+		return CLI_ENODEV;
+	}
+	wbuf_init(&wb, fd);
+
+	uint32_t round = 0, visits = 0, skipped = 0, items = 0;
+	uint64_t tuner_us = 0;
+	int stopped = 0;
+	while(!stopped && (!rounds || round < rounds)) {
+		uint32_t visited = 0;
+		round++;
+		for(uint32_t i = 0; i < nfreq && !stopped; i++) {
+			harv_st_t *st = harv_find(hc, freqs[i], 1);
+			if (st == NULL)
+				break;
+			uint32_t now = cmd_epoch_ms()/1000;
+			uint8_t stale = harv_stale(st, need, now, fresh);
+			// items slower than budget are not waited for
+			uint8_t fits = harv_fits(st, stale, budget, cmd_epoch_ms());
+			if (!fits) {
+				skipped++;
+				if (json) {
+					jw_begin(&jw, &wb, "harvest");
+					jw_u64(&jw, "ts", cmd_epoch_ms());
+					jw_uint(&jw, "round", round);
+					jw_uint(&jw, "freq", st->freq*10);
+					jw_bool(&jw, "skipped", 1);
+					if (stale)
+						jw_bool(&jw, "slow", 1);
+					if (st->quiet)
+						jw_uint(&jw, "quiet", now - st->quiet);
+					cmd_harv_age(&jw, &wb, st, need, now);
+					jw_end(&jw);
+				}
+				else if (st->quiet && !stale)
+					wbuf_printf(&wb, "skip %d.%02d no RDS %u s ago\n", st->freq/100, st->freq%100, now - st->quiet);
+				else {
+					wbuf_printf(&wb, "skip %d.%02d %s:", st->freq/100, st->freq%100, stale ? "slower than budget" : "fresh");
+					cmd_harv_age(NULL, &wb, st, need, now);
+					wbuf_putc(&wb, '\n');
+				}
+				wbuf_flush(&wb);
+				continue;
+			}
+
+			uint32_t dwell = harv_dwell(st, fits, budget, cmd_epoch_ms());
+			uint64_t start = rpi_micros();
+			si_tune(si_regs, st->freq);
+			int ms = harv_collect(si_regs, st, fits, dwell, now);
+			tuner_us += rpi_micros() - start;
+			visits++;
+			visited++;
+			items += __builtin_popcount(st->have & stale);
+
+			if (json) {
+				jw_begin(&jw, &wb, "harvest");
+				jw_u64(&jw, "ts", cmd_epoch_ms());
+				jw_uint(&jw, "round", round);
+				jw_uint(&jw, "dwell_ms", dwell);
+				cmd_harv_st(&jw, &wb, st, ms);
+				jw_uint(&jw, "groups", st->groups);
+				cmd_harv_age(&jw, &wb, st, need, now);
+				jw_end(&jw);
+			}
+			else {
+				wbuf_printf(&wb, "dwell %u ms, ", dwell);
+				cmd_harv_st(NULL, &wb, st, ms);
+				wbuf_putc(&wb, '\n');
+			}
+			wbuf_flush(&wb);
+			stopped = is_stop(NULL);
+		}
+		harv_save(hc);
+		// everything is fresh, wait for something to become stale
+		if (!visited && !stopped && (!rounds || round < rounds))
+			stopped = cmd_sleep(1000);
+	}
+
+	uint32_t tuner_ms = tuner_us/1000;
+	if (json) {
+		jw_begin(&jw, &wb, "harvested");
+		jw_uint(&jw, "rounds", round);
+		jw_uint(&jw, "visits", visits);
+		jw_uint(&jw, "skipped", skipped);
+		jw_uint(&jw, "items", items);
+		jw_uint(&jw, "tuner_ms", tuner_ms);
+		jw_end(&jw);
+	}
+	else
+		wbuf_printf(&wb, "%u rounds, %u visits, %u skipped as fresh, %u items in %u ms of tuner time, %u.%u items/s\n",
+			round, visits, skipped, items, tuner_ms,
+			tuner_ms ? items*1000/tuner_ms : 0, tuner_ms ? items*10000/tuner_ms % 10 : 0);
+	wbuf_flush(&wb);
+	free(hc);
+	return 0;
+}
+
+// verify results, unconfirmed if groups arrived but PI was not confirmed
+enum { VERIFY_MATCH, VERIFY_MISMATCH, VERIFY_NORDS, VERIFY_NEW, VERIFY_UNCONFIRMED };
+static const char *verify_name[] = { "match", "mismatch", "no RDS", "new", "unconfirmed" };
+
+// checks that cached stations still have the same PI
+int cmd_verify(int fd, char *arg)
+{
+	uint16_t si_regs[16];
+	uint16_t freqs[HARV_MAX];
+	int32_t  pis[HARV_MAX]; // expected PI, -1 to take it from cache
+	uint32_t nfreq = 0, budget = 1000;
+	uint32_t results[5] = { 0, 0, 0, 0, 0 };
+	int update = 0;
+	char *val;
+	wbuf_t wb;
+	jw_t jw;
+	int json = cmd_json(arg);
+
+	while(arg && *arg) {
+		while(*arg && *arg <= ' ')
+			arg++;
+		if (*arg == '\0')
+			break;
+		if (isdigit(*arg)) {
+			// freq[=PI],...
+			while(isdigit(*arg) && nfreq < HARV_MAX) {
+				pis[nfreq] = -1;
+				freqs[nfreq] = cmd_freq(arg, &arg);
+				if (freqs[nfreq] < si_band[0][0] || freqs[nfreq] > si_band[0][1]) {
+					dprintf(fd, "%d.%02d is out of %d.%02d-%d.%02d MHz band\n", freqs[nfreq]/100, freqs[nfreq]%100,
+						si_band[0][0]/100, si_band[0][0]%100, si_band[0][1]/100, si_band[0][1]%100);
+					return CLI_EARG;
+				}
+				if (*arg == '=')
+					pis[nfreq] = strtoul(arg + 1, &arg, 16);
+				nfreq++;
+				if (*arg == ',')
+					arg++;
+			}
+			if (*arg && *arg > ' ')
+				return CLI_EARG;
+		}
+		else if (cmd_arg(arg, "budget", &val))
+			budget = strtoul(val, &arg, 10);
+		else if (cmd_arg(arg, "update", &val)) {
+			update = 1;
+			arg = val;
+		}
+		else
+			return CLI_EARG;
+	}
+
+	harv_cache_t *hc = (harv_cache_t *)malloc(sizeof(harv_cache_t));
+	if (hc == NULL)
+		return -1;
+	harv_load(hc);
+	// without a list all cached stations with known PI are verified
+	if (nfreq == 0) {
+		for(uint32_t i = 0; i < hc->n; i++) {
+			if (hc->st[i].seen[0]) {
+				pis[nfreq] = -1;
+				freqs[nfreq++] = hc->st[i].freq;
+			}
+		}
+	}
+	if (nfreq == 0) {
+		free(hc);
+		dprintf(fd, "No stations to verify\n");
+		return CLI_EARG;
+	}
+	if (si_probe(si_regs) != SI_WARM && si_powerup(si_regs, freqs[0], SI_READY_MS, NULL) < 0) {
+		free(hc);
+		return CLI_ENODEV;
+	}
+	wbuf_init(&wb, fd);
+
+	uint64_t start = rpi_micros();
+	for(uint32_t i = 0; i < nfreq && !is_stop(NULL); i++) {
+		// cache is the reference, collect into a copy
+		harv_st_t *cached = harv_find(hc, freqs[i], 0);
+		harv_st_t probe, *st = &probe;
+		if (cached)
+			memcpy(st, cached, sizeof(probe));
+		else {
+			memset(st, 0, sizeof(probe));
+			st->freq = freqs[i];
+		}
+		int32_t expected = pis[i];
+		if (expected < 0 && st->seen[0])
+			expected = st->pi;
+
+		uint64_t t0 = rpi_micros();
+		si_tune(si_regs, st->freq);
+		uint32_t tune_ms = (rpi_micros() - t0)/1000;
+		int ms = harv_collect(si_regs, st, HARV_PI, budget, cmd_epoch_ms()/1000);
+		uint32_t total = (rpi_micros() - t0)/1000;
+
+		int res = st->groups ? VERIFY_UNCONFIRMED : VERIFY_NORDS;
+		if (ms >= 0) {
+			if (expected < 0)
+				res = VERIFY_NEW;
+			else
+				res = (st->pi == expected) ? VERIFY_MATCH : VERIFY_MISMATCH;
+		}
+		results[res]++;
+		// only new stations are added, changed ones with 'update'
+		if (res == VERIFY_NEW || res == VERIFY_MATCH || update) {
+			if (cached == NULL)
+				cached = harv_find(hc, freqs[i], 1);
+			if (cached)
+				memcpy(cached, st, sizeof(probe));
+		}
+
+		if (json) {
+			jw_begin(&jw, &wb, "verify");
+			jw_uint(&jw, "freq", st->freq*10);
+			jw_str(&jw, "result", verify_name[res]);
+			if (expected >= 0)
+				jw_hex(&jw, "expected", expected, 4);
+			if (ms >= 0)
+				jw_hex(&jw, "pi", st->pi, 4);
+			if (res == VERIFY_UNCONFIRMED)
+				jw_uint(&jw, "groups", st->groups);
+			jw_uint(&jw, "tune_ms", tune_ms);
+			jw_int(&jw, "pi_ms", ms);
+			jw_uint(&jw, "ms", total);
+			jw_end(&jw);
+		}
+		else {
+			wbuf_printf(&wb, "%d.%02d %-11s", st->freq/100, st->freq%100, verify_name[res]);
+			if (ms >= 0)
+				wbuf_printf(&wb, " PI %04X", st->pi);
+			if (res == VERIFY_UNCONFIRMED)
+				wbuf_printf(&wb, " %u groups", st->groups);
+			if (res == VERIFY_MISMATCH)
+				wbuf_printf(&wb, " expected %04X", expected);
+			wbuf_printf(&wb, " in %u ms, tune %u ms", total, tune_ms);
+			if (ms >= 0)
+				wbuf_printf(&wb, ", PI %d ms", ms);
+			wbuf_putc(&wb, '\n');
+		}
+		wbuf_flush(&wb);
+	}
+	harv_save(hc);
+	free(hc);
+
+	uint32_t ms = (rpi_micros() - start)/1000;
+	if (json) {
+		jw_begin(&jw, &wb, "verified");
+		jw_uint(&jw, "match", results[VERIFY_MATCH]);
+		jw_uint(&jw, "mismatch", results[VERIFY_MISMATCH]);
+		jw_uint(&jw, "no_rds", results[VERIFY_NORDS]);
+		jw_uint(&jw, "new", results[VERIFY_NEW]);
+		jw_uint(&jw, "unconfirmed", results[VERIFY_UNCONFIRMED]);
+		jw_uint(&jw, "ms", ms);
+		jw_end(&jw);
+	}
+	else
+		wbuf_printf(&wb, "%u match, %u mismatch, %u no RDS, %u new, %u unconfirmed in %u ms\n",
+			results[VERIFY_MATCH], results[VERIFY_MISMATCH], results[VERIFY_NORDS], results[VERIFY_NEW],
+			results[VERIFY_UNCONFIRMED], ms);
+	wbuf_flush(&wb);
+	return 0;
+}
+
+int cmd_trace(int fd, char *arg)
+{
+	if (cmd_is(arg, "reset")) {
+		trace_reset();
+		return 0;
+	}
+	if (arg && *arg)
+		return CLI_EARG;
+	trace_dump(fd);
+	return 0;
+}
+
+// prints records of flight recorder file
+static void cmd_fdr_show(int fd, const si_fdr_rec_t *recs, int nrec, uint32_t last)
+{
+	int i = (last && (int)last < nrec) ? nrec - last : 0;
+	uint64_t first = nrec ? recs[0].us : 0;
+	for(; i < nrec; i++) {
+		const si_fdr_rec_t *rec = &recs[i];
+		uint32_t ms = (rec->us - first)/1000;
+		dprintf(fd, "%6u.%03u %c%c %06X %X:", ms/1000, ms%1000,
+			(rec->op & SI_FDR_WRITE) ? 'W' : 'R', (rec->op & SI_FDR_ERR) ? '!' : ' ',
+			rec->site, rec->reg);
+		for(int r = 0; r < rec->nregs; r++)
+			dprintf(fd, " %04X", rec->regs[r]);
+		dprintf(fd, "\n");
+	}
+}
+
+// decodes RDS groups read by the recorded session
+static void cmd_fdr_play(int fd, const si_fdr_rec_t *recs, int nrec, uint16_t gtmask)
+{
+	uint16_t map[16];
+	rds_mon_t mon;
+	rds_rx_t  rx;
+
+	memset(map, 0, sizeof(map));
+	rds_mon_init(&mon, gtmask, 1);
+	rds_rx_init(&rx);
+	for(int i = 0; i < nrec; i++) {
+		const si_fdr_rec_t *rec = &recs[i];
+		for(int r = 0; r < rec->nregs; r++)
+			map[(rec->reg + r) & 0x0F] = rec->regs[r];
+		if (!(rec->op & SI_FDR_READ) || (rec->op & SI_FDR_ERR) || rec->reg + rec->nregs <= RDSD)
+			continue;
+		const uint16_t *rds = (map[STATUSRSSI] & RDSR) ? &map[RDSA] : NULL;
+		if (rds_rx_read(&rx, rec->us, rds) || rds == NULL)
+			continue;
+		rds_mon_group(fd, &mon, rds);
+	}
+	rds_mon_summary(fd, &mon, si_get_freq(map), nrec ? (recs[nrec - 1].us - recs[0].us)/1000 : 0);
+	rds_rx_report(fd, &rx, 0);
+}
+
+int cmd_fdr(int fd, char *arg)
+{
+	char *val;
+	if (cmd_arg(arg, "save", &val)) {
+		const char *name = *val ? val : NULL;
+		if (si_fdr_save(name) != 0) {
+			dprintf(fd, "Unable to save '%s'\n", name ? name : "flight recorder");
+			return CLI_EARG;
+		}
+		return 0;
+	}
+
+	int show = cmd_arg(arg, "show", &val);
+	if (!show && !cmd_arg(arg, "play", &val))
+		return CLI_EARG;
+	if (*val == '\0')
+		return CLI_EARG;
+
+	char *name = val;
+	arg = cmd_word(val);
+	si_fdr_hdr_t hdr;
+	si_fdr_rec_t *recs;
+	int nrec = si_fdr_load(name, &hdr, &recs);
+	if (nrec < 0) {
+		dprintf(fd, "Unable to load '%s'\n", name);
+		return CLI_EARG;
+	}
+
+	time_t saved = hdr.time;
+	dprintf(fd, "%d records, saved %s", nrec, ctime(&saved));
+	if (show) {
+		uint32_t last = 0;
+		if (cmd_arg(arg, "last", &val))
+			last = strtoul(val, &val, 10);
+		cmd_fdr_show(fd, recs, nrec, last);
+	}
+	else
+		cmd_fdr_play(fd, recs, nrec, cmd_gt_mask(&arg, 0xFFFF));
+	free(recs);
+	return 0;
+}
+
+int cmd_status(int fd, UNUSED(char *arg))
+{
+	uint16_t si_regs[16];
+	if (si_read_regs(si_regs) != 0)
+		return CLI_ENODEV;
+
+	int freq = si_get_freq(si_regs);
+	int on = (si_regs[POWERCFG] & PWR_ENABLE) && !(si_regs[POWERCFG] & PWR_DISABLE);
+	int volume = (si_regs[SYSCONF2] & VOLUME) + ((si_regs[SYSCONF3] & VOLEXT) ? 15 : 0);
+	dprintf(fd, "power %s freq %d.%02d RSSI %d %s RDS %s volume %d\n", is_on(on),
+		freq/100, freq%100, si_regs[STATUSRSSI] & RSSI,
+		(si_regs[STATUSRSSI] & STEREO) ? "stereo" : "mono",
+		(si_regs[STATUSRSSI] & RDSS) ? "synchronized" : "none",
+		(si_regs[POWERCFG] & DMUTE) ? volume : 0);
+	return 0;
+}
+
+// prints receiver state published by 'rds ... shm', every 'ms' if given
+int cmd_state(int fd, char *arg)
+{
+	uint32_t ms = (arg && *arg) ? strtoul(arg, NULL, 10) : 0;
+	const rds_state_t *shm = rds_shm_open();
+	rds_state_t st;
+
+	if (shm == NULL)
+		return CLI_ENODEV;
+	do {
+		if (rds_shm_read(shm, &st) != 0)
+			break;
+		time_t t = st.updated/1000;
+		struct tm tm;
+		localtime_r(&t, &tm);
+		dprintf(fd, "%02d:%02d:%02d.%03u %d.%02d RSSI %2u %s",
+			tm.tm_hour, tm.tm_min, tm.tm_sec, (unsigned)(st.updated % 1000),
+			st.freq/100, st.freq%100, st.rssi, st.stereo ? "stereo" : "mono  ");
+		if (st.pi)
+			dprintf(fd, " PI %04X PTY %2u TP %u TA %u PS '%s' RT '%s'",
+				st.pi, st.pty, st.tp, st.ta, st.ps, st.rt);
+		else
+			dprintf(fd, " RDS %s", st.sync ? "synchronized" : "none");
+		dprintf(fd, "\n");
+		if (ms)
+			rpi_delay_ms(ms);
+	} while(ms && !is_stop(NULL));
+	rds_shm_close(shm);
+	return 0;
+}
+
+extern cmd_t commands[];
+
+int cmd_daemon(int fd, char *arg)
+{
+	const char *sock = rdsd_sock();
+	char *val;
+	uint32_t limit = RDSD_LIMIT;
+
+	if (arg && cmd_arg(arg, "limit", &val))
+		limit = strtoul(val, &arg, 10);
+	while(arg && *arg && *arg <= ' ')
+		arg++;
+	if (arg && *arg)
+		sock = arg;
+	if (rdsd_serve(fd, sock, commands, limit) != 0)
+		return CLI_EARG;
+	return 0;
+}
+
+#define BATCH_MAX_SIZE 65536
+
+// runs commands from file or stdin ('-') in one session
+int cmd_batch(int fd, char *arg)
+{
+	if (arg == NULL || *arg == '\0')
+		return CLI_EARG;
+	cmd_word(arg);
+
+	// read all of stdin before the first command polls keyboard for stop
+	FILE *in = strcmp(arg, "-") ? fopen(arg, "r") : stdin;
+	if (in == NULL)
+		return CLI_EARG;
+	char *script = (char *)malloc(BATCH_MAX_SIZE + 1);
+	size_t len = 0;
+	int big = 0;
+	if (script) {
+		len = fread(script, 1, BATCH_MAX_SIZE, in);
+		script[len] = '\0';
+		big = (len == BATCH_MAX_SIZE) && (fgetc(in) != EOF);
+	}
+	if (in != stdin)
+		fclose(in);
+	if (script == NULL || big) {
+		if (big)
+			dprintf(fd, "batch is longer than %u bytes\n", BATCH_MAX_SIZE);
+		free(script);
+		return CLI_EARG;
+	}
+
+	int ret = sib_batch(fd, script, commands);
+	free(script);
+	return ret;
+}
+
 int cmd_volume(int fd, char *arg)
 {
 	uint8_t volume;
@@ -48,9 +48,27 @@ int cmd_tune(int fd, char *arg);
 int cmd_monitor(int fd, char *arg);
 int cmd_volume(int fd, char *arg);
 int cmd_set(int fd, char *arg);
+int cmd_replay(int fd, char *arg);
+int cmd_decode(int fd, char *arg);
+int cmd_query(int fd, char *arg);
+int cmd_index(int fd, char *arg);
+int cmd_search(int fd, char *arg);
+int cmd_gen(int fd, char *arg);
+int cmd_bench(int fd, char *arg);
+int cmd_trace(int fd, char *arg);
+int cmd_fdr(int fd, char *arg);
+int cmd_status(int fd, char *arg);
+int cmd_daemon(int fd, char *arg);
+int cmd_state(int fd, char *arg);
+int cmd_batch(int fd, char *arg);
+int cmd_duty(int fd, char *arg);
+int cmd_harvest(int fd, char *arg);
+int cmd_verify(int fd, char *arg);
 
 int cmd_arg(char *cmd, const char *str, char **arg);
 int cmd_is(char *str, const char *is);
+char *cmd_word(char *arg);
+int cmd_freq(char *arg, char **end);
 
 extern int stop;
 int is_stop(int *stop);
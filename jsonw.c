@@ -0,0 +1,147 @@
+/*	Allocation-free NDJSON writer
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "jsonw.h"
+
+// writes separator and key of the next member
+static void jw_key(jw_t *jw, const char *key)
+{
+	uint32_t bit = 1u << jw->depth;
+	if (jw->first & bit)
+		jw->first &= ~bit;
+	else
+		wbuf_putc(jw->wb, ',');
+	if (key) {
+		wbuf_putc(jw->wb, '"');
+		wbuf_puts(jw->wb, key);
+		wbuf_puts(jw->wb, "\":");
+	}
+}
+
+static void jw_open(jw_t *jw, const char *key, char c)
+{
+	jw_key(jw, key);
+	wbuf_putc(jw->wb, c);
+	jw->depth++;
+	jw->first |= 1u << jw->depth;
+}
+
+static void jw_close(jw_t *jw, char c)
+{
+	jw->depth--;
+	wbuf_putc(jw->wb, c);
+}
+
+void jw_begin(jw_t *jw, wbuf_t *wb, const char *type)
+{
+	jw->wb = wb;
+	jw->depth = 0;
+	jw->first = 1;
+	wbuf_putc(wb, '{');
+	jw_str(jw, "type", type);
+}
+
+void jw_end(jw_t *jw)
+{
+	wbuf_putc(jw->wb, '}');
+	wbuf_putc(jw->wb, '\n');
+}
+
+void jw_obj(jw_t *jw, const char *key)
+{
+	jw_open(jw, key, '{');
+}
+
+void jw_obj_end(jw_t *jw)
+{
+	jw_close(jw, '}');
+}
+
+void jw_arr(jw_t *jw, const char *key)
+{
+	jw_open(jw, key, '[');
+}
+
+void jw_arr_end(jw_t *jw)
+{
+	jw_close(jw, ']');
+}
+
+void jw_uint(jw_t *jw, const char *key, uint32_t val)
+{
+	jw_key(jw, key);
+	wbuf_uint(jw->wb, val, 0);
+}
+
+void jw_u64(jw_t *jw, const char *key, uint64_t val)
+{
+	char tmp[20];
+	uint8_t n = 0;
+	jw_key(jw, key);
+	do {
+		tmp[n++] = '0' + val % 10;
+		val /= 10;
+	} while(val);
+	while(n)
+		wbuf_putc(jw->wb, tmp[--n]);
+}
+
+void jw_int(jw_t *jw, const char *key, int32_t val)
+{
+	jw_key(jw, key);
+	wbuf_int(jw->wb, val, 0);
+}
+
+void jw_bool(jw_t *jw, const char *key, int val)
+{
+	jw_key(jw, key);
+	wbuf_puts(jw->wb, val ? "true" : "false");
+}
+
+void jw_hex(jw_t *jw, const char *key, uint32_t val, uint8_t digits)
+{
+	jw_key(jw, key);
+	wbuf_putc(jw->wb, '"');
+	wbuf_hex(jw->wb, val, digits);
+	wbuf_putc(jw->wb, '"');
+}
+
+void jw_strn(jw_t *jw, const char *key, const char *str, uint32_t len)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	jw_key(jw, key);
+	wbuf_putc(jw->wb, '"');
+	for(uint32_t i = 0; i < len && str[i]; i++) {
+		uint8_t c = (uint8_t)str[i];
+		if (c == '"' || c == '\\') {
+			wbuf_putc(jw->wb, '\\');
+			wbuf_putc(jw->wb, c);
+		}
+		else if (c < 0x20 || c > 0x7E) {
+			wbuf_puts(jw->wb, "\\u00");
+			wbuf_putc(jw->wb, hex[c >> 4]);
+			wbuf_putc(jw->wb, hex[c & 0x0F]);
+		}
+		else
+			wbuf_putc(jw->wb, c);
+	}
+	wbuf_putc(jw->wb, '"');
+}
+
+void jw_str(jw_t *jw, const char *key, const char *str)
+{
+	jw_strn(jw, key, str, UINT32_MAX);
+}
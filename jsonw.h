@@ -0,0 +1,85 @@
+/*	Allocation-free NDJSON writer
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	Writes one JSON object per line into a wbuf_t, which can be reused
+	for every record. 'key' is NULL for array elements. Strings are
+	escaped, RDS characters above 0x7F are written as \u00XX.
+
+	'--json' schema, every record has "type" and fields below it,
+	frequencies are in kHz, PI and raw blocks are 4 digits hex strings:
+	  group    ts, freq, rssi, pi, group ("0A"), tp, pty, blocks[4] and
+	           decoded fields of the group type, see rds_mon_json()
+	  event    ts, pi, event (PI|PS|RT|PTYN|TA|PTY|AF|EON|CT), value or text
+	  summary  freq, ms, groups, reads, duplicates, missed, ps, rt, groups_seen
+	  station  freq, rssi, stereo, pi, ps (scan and spectrum)
+	  regs     freq, rssi, stereo, regs[16] (dump and tune)
+	  cycle    ts, cycle, on_ms, power_ms, freq, complete_ms, have and
+	           pi, pty, ps, rt, ct collected (duty)
+	  duty     cycles, complete, on_ms, complete_ms, duty_permille
+	  harvest  ts, round, freq, skipped (slow if stale items take longer than
+	           budget) or dwell_ms and fields of cycle, groups,
+	           quiet (s since no RDS found), age {item: s, -1 never}
+	  harvested rounds, visits, skipped, items, tuner_ms
+	  verify   freq, result (match|mismatch|no RDS|new|unconfirmed), expected,
+	           pi, groups (if unconfirmed), tune_ms, pi_ms (-1 if no PI), ms
+	  verified match, mismatch, no_rds, new, unconfirmed, ms
+*/
+
+#ifndef __JSON_WRITER_H__
+#define __JSON_WRITER_H__
+
+#include "wbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+typedef struct jw_s
+{
+	wbuf_t  *wb;
+	uint8_t  depth;
+	uint32_t first; // bit per nesting level, nothing written there yet
+} jw_t;
+
+// starts new record with its "type"
+void jw_begin(jw_t *jw, wbuf_t *wb, const char *type);
+// closes record and adds new line, buffer is not flushed
+void jw_end(jw_t *jw);
+
+void jw_obj(jw_t *jw, const char *key);
+void jw_obj_end(jw_t *jw);
+void jw_arr(jw_t *jw, const char *key);
+void jw_arr_end(jw_t *jw);
+
+void jw_uint(jw_t *jw, const char *key, uint32_t val);
+void jw_u64(jw_t *jw, const char *key, uint64_t val);
+void jw_int(jw_t *jw, const char *key, int32_t val);
+void jw_bool(jw_t *jw, const char *key, int val);
+// upper case hex string, zero padded to 'digits'
+void jw_hex(jw_t *jw, const char *key, uint32_t val, uint8_t digits);
+void jw_str(jw_t *jw, const char *key, const char *str);
+// up to 'len' characters, stops at '\0'
+void jw_strn(jw_t *jw, const char *key, const char *str, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
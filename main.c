@@ -23,21 +23,40 @@
 #include "cmd.h"
 #include "cli.h"
 #include "pi2c.h"
+#include "rdsd.h"
 #include "rpi_pin.h"
+#include "siemu.h"
+#include "sifdr.h"
 #include "si4703.h"
 
 cmd_t commands[] = {
-	{ "reset", "reset radio module", cmd_reset },
+	{ "reset", "reset [cold|learn] [verbose] (skipped if radio is already up)", cmd_reset },
 	{ "power", "power up|down", cmd_power },
-	{ "dump", "dump registers map", cmd_dump },
+	{ "dump", "dump registers map [--json]", cmd_dump },
 	{ "spacing", "spacing 50|100|200 kHz", cmd_spacing },
-	{ "scan", "scan [mode 1-5]", cmd_scan },
-	{ "spectrum", "spectrum [rssi limit]", cmd_spectrum },
+	{ "scan", "scan [mode 1-5] [--json]", cmd_scan },
+	{ "spectrum", "spectrum [rssi limit] [--json]", cmd_spectrum },
 	{ "seek", "seek up|down", cmd_seek },
-	{ "tune", "tune [freq]", cmd_tune },
+	{ "tune", "tune [freq] [--json]", cmd_tune },
 	{ "volume", "volume [0-30]", cmd_volume },
-	{ "rds", "rds [on|off|verbose] gt [0,...,15] [time sec (0 - no timeout)] [log]", cmd_monitor },
+	{ "rds", "rds [on|off|verbose] gt [0,...,15] [time sec (0 - no timeout)] [log] [refresh ms] [stat] [blind] [events] [shm] [sink spec ...] [rec file] [--json]", cmd_monitor },
 	{ "set", "set register value", cmd_set },
+	{ "replay", "replay file [from sec] [fast] [gt [0,...,15]] [log]", cmd_replay },
+	{ "decode", "decode [jobs N] [gt [0,...,15]] file ...", cmd_decode },
+	{ "query", "query [from T] [to T] [freq F] [pi P] [gt G] [pty N] [ta 0|1] [tp 0|1] [last|count] file ...", cmd_query },
+	{ "index", "index IDX file ...", cmd_index },
+	{ "search", "search IDX [from T] [to T] [pi P] [ps|rt|ptyn] [sub] text", cmd_search },
+	{ "gen", "gen file [groups N] [stations N] [errors E] [burst B] [seed S] [sched 0A,2A,...]", cmd_gen },
+	{ "bench", "bench [reads N] [tunes N] [seeks N] [rds sec] [json file]", cmd_bench },
+	{ "trace", "trace [reset]", cmd_trace },
+	{ "fdr", "fdr save [file] | show file [last N] | play file [gt [0,...,15]]", cmd_fdr },
+	{ "status", "status", cmd_status },
+	{ "state", "state [ms]", cmd_state },
+	{ "daemon", "daemon [limit sec (0 - none)] [socket]", cmd_daemon },
+	{ "duty", "duty freq [need pi,pty,ps,rt,ct] [budget ms] [period sec] [cycles n] [--json]", cmd_duty },
+	{ "harvest", "harvest [freq,...] [need pi,pty,ps,rt,ct] [fresh sec] [budget ms] [rounds n (0 - until key)] [--json]", cmd_harvest },
+	{ "verify", "verify [freq[=PI],...] [budget ms] [update] [--json]", cmd_verify },
+	{ "batch", "batch file|- (one command per line, wait [until], if rssi|pi|stereo|rds|stc)", cmd_batch },
 	{ NULL, NULL, NULL }
 };
 
@@ -47,7 +66,8 @@ int stdio_cli_handler(console_io_t *cli, void *ptr);
 
 int is_stop(int *pstop)
 {
-	int stop = cli.getch(&cli);
+	// client of the daemon is gone or out of time
+	int stop = rdsd_cancel ? 1 : cli.getch(&cli);
 	if (pstop) {
 		if (*pstop)
 			stop = *pstop;
@@ -76,6 +96,7 @@ int main(int argc, char **argv)
 	if (argc == 1) {
 		printf("Supported commands:\n");
 		printf("    cmd: run in interactive command mode\n");
+		printf("    client: client command [args] - run command in rdspi daemon\n");
 		for(uint32_t i = 0; commands[i].name != NULL; i++) {
 			printf("    %s: %s\n", commands[i].name, commands[i].help);
 		}
@@ -88,15 +109,49 @@ int main(int argc, char **argv)
 		argc--;
 	}
 
+	argbuf[0] = '\0';
+	if (argc > 2) {
+		for(int i = 2; i < argc; i++) {
+			if (i > 2)
+				strcat(argbuf, " ");
+			strcat(argbuf, argv[i]);
+		}
+		arg = argbuf;
+	}
+
+	// client does not touch hardware, daemon owns it
+	if (arg && cmd_is(argv[1], "client")) {
+		int status = 0;
+		if (rdsd_request(STDOUT_FILENO, rdsd_sock(), arg, &status) != 0) {
+			printf("Unable to connect to daemon at %s\n", rdsd_sock());
+			return 1;
+		}
+		if (status == CLI_ENOTSUP)
+			printf("Unknown command '%s'\n", arg);
+		else if (status != 0)
+			printf("Communication error\n");
+		return status ? 1 : 0;
+	}
+
 	if (!verbose)
 		cli.ofd = open("/dev/null", O_WRONLY);
 	stdio_init(&cli, stdio_cli_handler);
 	stdio_mode(STDIO_MODE_RAW);
 
+	// reads shared memory only, no need to touch hardware
+	if (!cmd_mode && cmd_is(argv[1], "state")) {
+		if (cmd_state(cli.ofd, arg) != 0)
+			dprintf(cli.ofd, "Receiver state is not published, run 'rds ... shm'\n");
+		stdio_mode(STDIO_MODE_CANON);
+		return 0;
+	}
+
 	rpi_pin_init(RPI_REV2);
-	rpi_pin_export(SI_RESET, RPI_INPUT);
 	pi2c_open(PI2C_BUS);
+	if (getenv(SI_EMU_ENV) && si_emu_attach(getenv(SI_EMU_ENV)) != 0)
+		printf("Unable to start emulator '%s'\n", getenv(SI_EMU_ENV));
 	pi2c_select(PI2C_BUS, SI4703_ADDR);
+	si_fdr_signals();
 
 	if (cmd_mode) {
 		while(!stop)
@@ -104,16 +159,6 @@ int main(int argc, char **argv)
 		goto restore;
 	}
 
-	argbuf[0] = '\0';
-	if (argc > 2) {
-		for(int i = 2; i < argc; i++) {
-			if (i > 2)
-				strcat(argbuf, " ");
-			strcat(argbuf, argv[i]);
-		}
-		arg = argbuf;
-	}
-
 	for(uint32_t i = 0; commands[i].name != NULL; i++) {
 		if (cmd_is(argv[1], commands[i].name)) {
 			if (commands[i].cmd(cli.ofd, arg) != 0)
@@ -124,6 +169,7 @@ int main(int argc, char **argv)
 
 restore:
 	rpi_pin_unexport(SI_RESET);
+	si_emu_detach();
 	pi2c_close(PI2C_BUS);
 	stdio_mode(STDIO_MODE_CANON);
 
@@ -36,6 +36,18 @@
 
 /* i2c bus file descriptors */
 static int i2c_bus[2] = { -1, -1 };
+/* emulated devices */
+static const pi2c_emu_t *i2c_emu[2];
+
+/* route reads and writes to emulated device instead of I2C bus */
+int pi2c_emulate(uint8_t bus, const pi2c_emu_t *emu)
+{
+	if (bus > PI2C_BUS1)
+		return -1;
+
+	i2c_emu[bus] = emu;
+	return 0;
+}
 
 /* open I2C bus if not opened yet and store file descriptor */
 int pi2c_open(uint8_t bus)
@@ -74,7 +86,11 @@ int pi2c_close(uint8_t bus)
 /* select I2C device for pi2c_write() calls */
 int pi2c_select(uint8_t bus, uint8_t slave)
 {
-	if ((bus > PI2C_BUS1) || (i2c_bus[bus] < 0))
+	if (bus > PI2C_BUS1)
+		return -1;
+	if (i2c_emu[bus])
+		return 0;
+	if (i2c_bus[bus] < 0)
 		return -1;
 
 	return ioctl(i2c_bus[bus], I2C_SLAVE, slave);
@@ -83,7 +99,11 @@ int pi2c_select(uint8_t bus, uint8_t slave)
 /* write to I2C device selected by pi2c_select() */
 int pi2c_write(uint8_t bus, const uint8_t *data, uint32_t len)
 {
-	if ((bus > PI2C_BUS1) || (i2c_bus[bus] < 0))
+	if (bus > PI2C_BUS1)
+		return -1;
+	if (i2c_emu[bus])
+		return i2c_emu[bus]->write(i2c_emu[bus]->dev, data, len);
+	if (i2c_bus[bus] < 0)
 		return -1;
 
 	if (write(i2c_bus[bus], data, len) != (ssize_t)len)
@@ -95,7 +115,11 @@ int pi2c_write(uint8_t bus, const uint8_t *data, uint32_t len)
 /* read I2C device selected by pi2c_select() */
 int pi2c_read(uint8_t bus, uint8_t *data, uint32_t len)
 {
-	if ((bus > PI2C_BUS1) || (i2c_bus[bus] < 0))
+	if (bus > PI2C_BUS1)
+		return -1;
+	if (i2c_emu[bus])
+		return i2c_emu[bus]->read(i2c_emu[bus]->dev, data, len);
+	if (i2c_bus[bus] < 0)
 		return -1;
 
 	if (read(i2c_bus[bus], data, len) != (ssize_t)len)
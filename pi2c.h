@@ -45,6 +45,15 @@ int pi2c_close(uint8_t bus); /*< close I2C bus */
 int pi2c_select(uint8_t bus, uint8_t slave); /*< select I2C slave */
 int pi2c_read(uint8_t bus, uint8_t *data, uint32_t len);
 int pi2c_write(uint8_t bus, const uint8_t *data, uint32_t len);
+
+/* emulated device used instead of I2C slave, for development without hardware */
+typedef struct pi2c_emu_s {
+	int (*read)(void *dev, uint8_t *data, uint32_t len);
+	int (*write)(void *dev, const uint8_t *data, uint32_t len);
+	void *dev;
+} pi2c_emu_t;
+
+int pi2c_emulate(uint8_t bus, const pi2c_emu_t *emu); /*< NULL to detach */
 #ifdef __cplusplus
 }
 #endif
@@ -20,6 +20,7 @@
 #include <string.h>
 
 #include "rds.h"
+#include "trace.h"
 
 #ifndef _BM
 #define _BM(bit) (1 << ((uint16_t)bit)) // convert bit number to bit mask
@@ -74,14 +75,15 @@ const char *rds_gt_name(uint8_t group, uint8_t version)
 	return rds_gt_names[idx];
 }
 
-static char *rds_swap16(void *ptr)
+// unpacks characters from RDS blocks, high byte first,
+// input is not modified so it can point to read only memory
+static char *rds_chars(char *pchar, const uint16_t *prds, int nblocks)
 {
-	char *p8 = (char *)ptr;
-	char tmp = p8[0];
-	p8[0] = p8[1];
-	p8[1] = tmp;
-
-	return (char *)ptr;
+	for(int i = 0; i < nblocks; i++) {
+		pchar[i*2] = prds[i] >> 8;
+		pchar[i*2 + 1] = prds[i] & 0xFF;
+	}
+	return pchar;
 }
 
 static int rds_add_af(rds_gt00a_t *dst, uint8_t *paf)
@@ -107,8 +109,9 @@ static int rds_add_af(rds_gt00a_t *dst, uint8_t *paf)
 	return 0;
 }
 
-int rds_parse_gt00a(uint16_t *prds, rds_gt00a_t *pgt)
+int rds_parse_gt00a(const uint16_t *prds, rds_gt00a_t *pgt)
 {
+	TRACE_SPAN(TRACE_GT00A);
 	uint8_t ci = (prds[RDS_B] & 0x03);
 	pgt->ta = !!(prds[RDS_B] & RDS_TA); // Traffic Announcement
 	pgt->ms = (prds[RDS_B] & RDS_MS) ? 'M' : 'S'; // Music/Speech
@@ -123,7 +126,7 @@ int rds_parse_gt00a(uint16_t *prds, rds_gt00a_t *pgt)
 	pgt->valid |= 1 << ci;
 
 	if (!(prds[RDS_B] & RDS_VER)) {
-		uint8_t *paf = (uint8_t *)rds_swap16(&prds[RDS_C]);
+		uint8_t paf[2] = { (uint8_t)(prds[RDS_C] >> 8), (uint8_t)(prds[RDS_C] & 0xFF) };
 		rds_add_af(pgt, paf);
 	}
 
@@ -133,17 +136,19 @@ int rds_parse_gt00a(uint16_t *prds, rds_gt00a_t *pgt)
 		pgt->ps[8] = '\0';
 	}
 
-	char *pchar = rds_swap16(&prds[RDS_D]);
+	char chars[2];
+	char *pchar = rds_chars(chars, &prds[RDS_D], 1);
 	for(int i = 0; i < 2; i++) {
-		if (isalnum(pchar[i]) || pchar[i] == ' ')
+		if (isalnum((uint8_t)pchar[i]) || pchar[i] == ' ')
 			pgt->ps[ci+i] = pchar[i];
 	}
 
 	return 0;
 }
 
-int rds_parse_gt01a(uint16_t *prds, rds_gt01a_t *pgt)
+int rds_parse_gt01a(const uint16_t *prds, rds_gt01a_t *pgt)
 {
+	TRACE_SPAN(TRACE_GT01A);
 	pgt->rpc  = prds[RDS_B] & 0x1F;
 	pgt->la   = !!(prds[RDS_C] & 0x8000);
 	pgt->vc   = (prds[RDS_C] >> 12) & 0x07;
@@ -152,8 +157,9 @@ int rds_parse_gt01a(uint16_t *prds, rds_gt01a_t *pgt)
 	return 0;
 }
 
-int rds_parse_gt02a(uint16_t *prds, rds_gt02a_t *pgt)
+int rds_parse_gt02a(const uint16_t *prds, rds_gt02a_t *pgt)
 {
+	TRACE_SPAN(TRACE_GT02A);
 	uint8_t ab = !!(prds[RDS_B] & RDS_AB);
 	uint8_t si = (prds[RDS_B] & 0x0F);
 	
@@ -167,8 +173,8 @@ int rds_parse_gt02a(uint16_t *prds, rds_gt02a_t *pgt)
 	pgt->valid |= 1 << si;
 	si *= 4;
 
-	char *pchar = rds_swap16(&prds[RDS_C]);
-	rds_swap16(&prds[RDS_D]);
+	char chars[4];
+	char *pchar = rds_chars(chars, &prds[RDS_C], 2);
 
 	for (int i = 0; i < 4; i++) {
 		uint8_t ch = pchar[i];
@@ -184,8 +190,85 @@ int rds_parse_gt02a(uint16_t *prds, rds_gt02a_t *pgt)
 	return 0;
 }
 
-int rds_parse_gt03a(uint16_t *prds, rds_gt03a_t *pgt)
+static int rds_rt_done(rds_rt_t *prt, uint8_t nseg)
+{
+	int len = nseg*4;
+	if (prt->end && prt->end - 1 < len)
+		len = prt->end - 1;
+	// drop padding
+	while(len > 0 && prt->rt[len - 1] == ' ')
+		len--;
+	memcpy(prt->text, prt->rt, len);
+	prt->text[len] = '\0';
+	prt->nseg  = nseg;
+	prt->have  = 0;
+	prt->cycle = 0;
+	prt->prev  = 0;
+	return 1;
+}
+
+int rds_rt_add(const uint16_t *prds, rds_rt_t *prt)
+{
+	uint8_t ab = !!(prds[RDS_B] & RDS_AB);
+	uint8_t si = (prds[RDS_B] & 0x0F);
+	int done = 0;
+
+	// text changed, start over
+	if (prt->rt[0] == '\0' || prt->ab != ab) {
+		memset(prt, 0, sizeof(rds_rt_t));
+		memset(prt->rt, ' ', 64);
+		prt->ab = ab;
+		prt->si = si;
+	}
+
+	// segment address went back, a new cycle starts
+	if (si < prt->si) {
+		uint16_t cycle = prt->cycle;
+		int same = cycle && cycle == prt->prev && !(cycle & (cycle + 1));
+		if (same) {
+			uint8_t nseg = 0;
+			for(uint16_t m = cycle; m; m >>= 1)
+				nseg++;
+			same = !memcmp(prt->rt, prt->last, nseg*4);
+			if (same)
+				done = rds_rt_done(prt, nseg);
+		}
+		if (!same) {
+			prt->prev = cycle;
+			memcpy(prt->last, prt->rt, sizeof(prt->last));
+		}
+		prt->cycle = 0;
+	}
+	prt->si = si;
+	prt->have  |= 1 << si;
+	prt->cycle |= 1 << si;
+
+	char chars[4];
+	char *pchar = rds_chars(chars, &prds[RDS_C], 2);
+	// terminator moved or removed
+	if (prt->end && (prt->end - 1)/4 == si)
+		prt->end = 0;
+	for(int i = 0; i < 4; i++) {
+		uint8_t ch = pchar[i];
+		if (ch == '\r') {
+			prt->end = si*4 + i + 1;
+			break;
+		}
+		if (isalnum(ch) || ch == ' ')
+			prt->rt[si*4 + i] = ch;
+	}
+
+	// all segments up to the terminator
+	uint8_t nseg = prt->end ? (prt->end - 1)/4 + 1 : 16;
+	uint16_t need = (nseg == 16) ? 0xFFFF : (1 << nseg) - 1;
+	if ((prt->have & need) == need)
+		return rds_rt_done(prt, nseg);
+	return done;
+}
+
+int rds_parse_gt03a(const uint16_t *prds, rds_gt03a_t *pgt)
 {
+	TRACE_SPAN(TRACE_GT03A);
 	pgt->agtc = (prds[RDS_B] >> 1) & 0x0F;
 	pgt->ver  = prds[RDS_B] & 0x01;
 	uint16_t msg = prds[RDS_C];
@@ -212,8 +295,9 @@ int rds_parse_gt03a(uint16_t *prds, rds_gt03a_t *pgt)
 	return 0;
 }
 
-int rds_parse_gt04a(uint16_t *prds, rds_gt04a_t *pgt)
+int rds_parse_gt04a(const uint16_t *prds, rds_gt04a_t *pgt)
 {
+	TRACE_SPAN(TRACE_GT04A);
 	uint8_t hour = (prds[RDS_D] >> 12) & 0x0F;
 	hour |= (prds[RDS_C] & 0x01) << 4;
 	if (hour > 23)
@@ -244,8 +328,9 @@ int rds_parse_gt04a(uint16_t *prds, rds_gt04a_t *pgt)
 	return 0;
 }
 
-int rds_parse_gt05a(uint16_t *prds, rds_gt05a_t *pgt)
+int rds_parse_gt05a(const uint16_t *prds, rds_gt05a_t *pgt)
 {
+	TRACE_SPAN(TRACE_GT05A);
 	uint8_t channel = prds[RDS_B] & 0x001F;
 	pgt->channel |= 1u << channel;
 	pgt->tds[channel][0] = prds[RDS_C];
@@ -254,8 +339,9 @@ int rds_parse_gt05a(uint16_t *prds, rds_gt05a_t *pgt)
 	return 0;
 }
 
-int rds_parse_gt08a(uint16_t *prds, rds_gt08a_t *pgt)
+int rds_parse_gt08a(const uint16_t *prds, rds_gt08a_t *pgt)
 {
+	TRACE_SPAN(TRACE_GT08A);
 	if (pgt->spn[0] == '\0') {
 		memset(pgt->spn, ' ', 8);
 		pgt->spn[8] = '\0';
@@ -278,8 +364,9 @@ int rds_parse_gt08a(uint16_t *prds, rds_gt08a_t *pgt)
 	return 0;
 }
 
-int rds_parse_gt10a(uint16_t *prds, rds_gt10a_t *pgt)
+int rds_parse_gt10a(const uint16_t *prds, rds_gt10a_t *pgt)
 {
+	TRACE_SPAN(TRACE_GT10A);
 	uint8_t ab = !!(prds[RDS_B] & RDS_AB);
 	uint8_t ci = (prds[RDS_B] & 0x01);
 
@@ -291,18 +378,23 @@ int rds_parse_gt10a(uint16_t *prds, rds_gt10a_t *pgt)
 	pgt->ab = ab;
 
 	ci *= 4;
-	char *pchar = rds_swap16(&prds[RDS_C]);
-	rds_swap16(&prds[RDS_D]);
+	char chars[4];
+	char *pchar = rds_chars(chars, &prds[RDS_C], 2);
 	for(int i = 0; i < 4; i++) {
-		if (isalnum(pchar[i]) || pchar[i] == ' ')
+		if (isalnum((uint8_t)pchar[i]) || pchar[i] == ' ')
 		pgt->ps[ci+i] = pchar[i];
 	}
 	return 0;
 }
 
-int rds_parse_gt14a(uint16_t *prds, rds_gt14a_t *pgt)
+int rds_parse_gt14a(const uint16_t *prds, rds_gt14a_t *pgt)
 {
-	char *pchar = rds_swap16(&prds[RDS_C]);
+	TRACE_SPAN(TRACE_GT14A);
+	char chars[2];
+	char *pchar = rds_chars(chars, &prds[RDS_C], 1);
+	// block C used to be byte swapped in place before it was stored,
+	// info, PTY and PIN keep that order so output does not change
+	uint16_t blkc = (uint16_t)((prds[RDS_C] << 8) | (prds[RDS_C] >> 8));
 
 	if (pgt->pi_on != prds[RDS_D]) {
 		rds_hdr_t hdr;
@@ -314,14 +406,14 @@ int rds_parse_gt14a(uint16_t *prds, rds_gt14a_t *pgt)
 
 	pgt->tp_on   = !!(prds[RDS_B] & 0x10);
 	pgt->variant = prds[RDS_B] & 0x0F;
-	pgt->info    = prds[RDS_C];
+	pgt->info    = blkc;
 	pgt->pi_on   = prds[RDS_D];
 
 	pgt->avc |= 1 << pgt->variant;
 
 	if (pgt->variant < 4) {
 		for(int i = 0; i <2; i++) {
-			if (isalnum(pchar[i]) || pchar[i] == ' ')
+			if (isalnum((uint8_t)pchar[i]) || pchar[i] == ' ')
 			pgt->ps[pgt->variant*2+i] = pchar[i];
 		}
 		return 0;
@@ -332,19 +424,19 @@ int rds_parse_gt14a(uint16_t *prds, rds_gt14a_t *pgt)
 		return 0;
 	}
 	if (pgt->variant < 10) {
-		pgt->mf[pgt->variant - 5] = prds[RDS_C];
+		pgt->mf[pgt->variant - 5] = blkc;
 		return 0;
 	}
 	if (pgt->variant == 12) {
-		pgt->li = prds[RDS_C];
+		pgt->li = blkc;
 		return 0;
 	}
 	if (pgt->variant == 13) {
-		pgt->pty = prds[RDS_C];
+		pgt->pty = blkc;
 		return 0;
 	}
 	if (pgt->variant == 14) {
-		pgt->pin = prds[RDS_C];
+		pgt->pin = blkc;
 		return 0;
 	}
 	return 0;
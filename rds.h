@@ -140,6 +140,24 @@ typedef struct rds_gt02a_s
 	char     rt[65];
 } rds_gt02a_t;
 
+// Radiotext assembler for completed texts: text is complete when all
+// segments up to 0x0D terminator (all 16 if there is none) are received,
+// or when a station not sending the terminator repeats the same segments
+// from 0 twice in a row
+typedef struct rds_rt_s
+{
+	uint8_t  ab;
+	uint8_t  si;      // last segment received
+	uint8_t  end;     // terminator position + 1, 0 if not received
+	uint8_t  nseg;    // segments of the complete text
+	uint16_t have;    // segments received since the last complete text
+	uint16_t cycle;   // segments received in the current cycle
+	uint16_t prev;    // segments received in the previous cycle
+	char     rt[65];  // text being received
+	char     last[65]; // text at the end of the previous cycle
+	char     text[65]; // complete text, padding dropped
+} rds_rt_t;
+
 typedef struct rds_gt03a_s
 {
 	rds_hdr_t hdr;
@@ -217,15 +235,17 @@ typedef struct rds_gt14a_s
 
 } rds_gt14a_t;
 
-int rds_parse_gt00a(uint16_t *prds, rds_gt00a_t *pgt);
-int rds_parse_gt01a(uint16_t *prds, rds_gt01a_t *pgt);
-int rds_parse_gt02a(uint16_t *prds, rds_gt02a_t *pgt);
-int rds_parse_gt03a(uint16_t *prds, rds_gt03a_t *pgt);
-int rds_parse_gt04a(uint16_t *prds, rds_gt04a_t *pgt);
-int rds_parse_gt05a(uint16_t *prds, rds_gt05a_t *pgt);
-int rds_parse_gt08a(uint16_t *prds, rds_gt08a_t *pgt);
-int rds_parse_gt10a(uint16_t *prds, rds_gt10a_t *pgt);
-int rds_parse_gt14a(uint16_t *prds, rds_gt14a_t *pgt);
+int rds_parse_gt00a(const uint16_t *prds, rds_gt00a_t *pgt);
+int rds_parse_gt01a(const uint16_t *prds, rds_gt01a_t *pgt);
+int rds_parse_gt02a(const uint16_t *prds, rds_gt02a_t *pgt);
+// adds 2A group to zero initialized assembler, returns 1 if prt->text is complete
+int rds_rt_add(const uint16_t *prds, rds_rt_t *prt);
+int rds_parse_gt03a(const uint16_t *prds, rds_gt03a_t *pgt);
+int rds_parse_gt04a(const uint16_t *prds, rds_gt04a_t *pgt);
+int rds_parse_gt05a(const uint16_t *prds, rds_gt05a_t *pgt);
+int rds_parse_gt08a(const uint16_t *prds, rds_gt08a_t *pgt);
+int rds_parse_gt10a(const uint16_t *prds, rds_gt10a_t *pgt);
+int rds_parse_gt14a(const uint16_t *prds, rds_gt14a_t *pgt);
 
 #ifdef __cplusplus
 }
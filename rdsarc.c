@@ -0,0 +1,356 @@
+/*	Parallel decoder of RDS capture archives
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "rdsarc.h"
+#include "rdscap.h"
+#include "rdsmon.h"
+
+// shards decoded in parallel at once, so temporary outputs do not run out fds
+#define ARC_WINDOW 256
+// decoders warm up on records before split at CAP_SYNC, long enough
+// to see slow cycles like 32 channels of 5A, splits are rare enough
+// to keep extra decoding at 1/8
+#define ARC_WARMUP    (4*CAP_SYNC_EVERY)
+#define ARC_SHARD_MIN (8*ARC_WARMUP)
+
+typedef struct arc_job_s
+{
+	arc_shard_t *shard;
+	FILE     *out;    // shard output, merged when decoded
+	int      done;
+	int      failed;  // output could not be created
+	uint16_t freq;
+	uint32_t tuned;   // time of the first record
+	uint32_t last;    // time of the last group
+	rds_mon_t mon;    // decoders state at the end of shard
+} arc_job_t;
+
+// per worker queue of jobs, owner pops from the head, thieves from the tail
+typedef struct arc_deque_s
+{
+	pthread_mutex_t lock;
+	int  head;
+	int  tail;
+	int *ids;
+} arc_deque_t;
+
+typedef struct arc_pool_s
+{
+	arc_job_t   *jobs;
+	arc_deque_t *dq;
+	int     *ids;     // storage of queues
+	int      nworkers;
+	uint16_t pr_mask;
+	pthread_mutex_t lock;
+	pthread_cond_t  done;
+} arc_pool_t;
+
+typedef struct arc_worker_s
+{
+	arc_pool_t *pool;
+	int id;
+} arc_worker_t;
+
+static int arc_add(arc_shard_t **pshards, int n, const char *name, uint32_t sync, uint32_t start, uint32_t end, uint8_t tune)
+{
+	if (end <= start)
+		return n;
+	// grow in chunks of 64 shards
+	if ((n & 0x3F) == 0) {
+		arc_shard_t *p = (arc_shard_t *)realloc(*pshards, (n + 64)*sizeof(arc_shard_t));
+		if (p == NULL)
+			return -1;
+		*pshards = p;
+	}
+	(*pshards)[n].name  = name;
+	(*pshards)[n].sync  = sync;
+	(*pshards)[n].start = start;
+	(*pshards)[n].nrec  = end - start;
+	(*pshards)[n].tune  = tune;
+	return n + 1;
+}
+
+int arc_split(char **files, int nfiles, arc_shard_t **pshards)
+{
+	int n = 0;
+	cap_map_t cap;
+
+	*pshards = NULL;
+	for(int i = 0; i < nfiles && n >= 0; i++) {
+		if (cap_map(&cap, files[i]) != 0) {
+			free(*pshards);
+			*pshards = NULL;
+			return -1;
+		}
+		// station starts at the beginning of file and at every CAP_TUNE
+		uint32_t start = 0, sync = 0, station = 0;
+		uint8_t tune = 1;
+		for(uint32_t r = 0; r < cap.nrec && n >= 0; r++) {
+			const cap_rec_t *rec = cap_map_rec(&cap, r);
+			if (rec->type == CAP_TUNE) {
+				n = arc_add(pshards, n, files[i], sync, start, r, tune);
+				start = sync = station = r;
+				tune = 1;
+			}
+			else if (rec->type == CAP_SYNC && (r - start) >= ARC_SHARD_MIN) {
+				n = arc_add(pshards, n, files[i], sync, start, r, tune);
+				start = r;
+				sync = (r - station > ARC_WARMUP) ? r - ARC_WARMUP : station;
+				tune = 0;
+			}
+		}
+		if (n >= 0)
+			n = arc_add(pshards, n, files[i], sync, start, cap.nrec, tune);
+		cap_unmap(&cap);
+	}
+	return n;
+}
+
+static void arc_decode_shard(int fd, arc_job_t *job, uint16_t pr_mask)
+{
+	cap_map_t cap;
+	rds_mon_t *mon = &job->mon;
+	arc_shard_t *shard = job->shard;
+
+	rds_mon_init(mon, 0, 1);
+	job->freq = job->tuned = job->last = 0;
+	if (cap_map(&cap, shard->name) != 0) {
+		dprintf(fd, "Unable to read capture '%s'\n", shard->name);
+		return;
+	}
+
+	uint32_t end = shard->start + shard->nrec;
+	if (end > cap.nrec)
+		end = cap.nrec;
+	if (shard->start < end)
+		job->tuned = cap_map_rec(&cap, shard->start)->ms;
+	for(uint32_t i = shard->sync; i < end; i++) {
+		const cap_rec_t *rec = cap_map_rec(&cap, i);
+		// shard split at CAP_SYNC rebuilds decoders state silently
+		if (i == shard->start) {
+			mon->pr_mask = pr_mask;
+			mon->ngroups = 0;
+		}
+		job->freq = rec->freq;
+		if (CAP_IS_SYNC(rec) || CAP_IS_BAD(rec))
+			continue;
+		if (i >= shard->start)
+			job->last = rec->ms;
+		rds_mon_group(fd, mon, rec->rds);
+	}
+	cap_unmap(&cap);
+}
+
+// merges shard into station 'st', prints summary at the end of station
+static void arc_merge(int fd, arc_job_t *st, arc_job_t *job, int end)
+{
+	if (job->shard->tune) {
+		memcpy(st, job, sizeof(arc_job_t));
+	}
+	else {
+		rds_mon_t *mon = &job->mon;
+		st->mon.ngroups  += mon->ngroups;
+		st->mon.gt_mask  |= mon->gt_mask;
+		st->mon.gta_mask |= mon->gta_mask;
+		st->mon.gtb_mask |= mon->gtb_mask;
+		if (mon->rd0.valid == 0x0F || st->mon.rd0.valid != 0x0F)
+			memcpy(&st->mon.rd0, &mon->rd0, sizeof(mon->rd0));
+		if (mon->rd2.valid)
+			memcpy(&st->mon.rd2, &mon->rd2, sizeof(mon->rd2));
+		if (mon->ngroups)
+			st->last = job->last;
+		st->freq = job->freq;
+	}
+	if (end && st->mon.ngroups)
+		rds_mon_summary(fd, &st->mon, st->freq, st->last - st->tuned);
+}
+
+static int arc_pop(arc_deque_t *dq, int steal)
+{
+	int id = -1;
+	pthread_mutex_lock(&dq->lock);
+	if (dq->head < dq->tail)
+		id = steal ? dq->ids[--dq->tail] : dq->ids[dq->head++];
+	pthread_mutex_unlock(&dq->lock);
+	return id;
+}
+
+static void *arc_worker(void *arg)
+{
+	arc_worker_t *worker = (arc_worker_t *)arg;
+	arc_pool_t *pool = worker->pool;
+
+	while(1) {
+		int id = arc_pop(&pool->dq[worker->id], 0);
+		// own queue is empty, try to steal from others
+		for(int i = 1; id < 0 && i < pool->nworkers; i++)
+			id = arc_pop(&pool->dq[(worker->id + i) % pool->nworkers], 1);
+		if (id < 0)
+			break;
+
+		// output is opened only when shard is taken
+		arc_job_t *job = &pool->jobs[id];
+		if ((job->out = tmpfile()) == NULL)
+			job->failed = 1;
+		else
+			arc_decode_shard(fileno(job->out), job, pool->pr_mask);
+
+		pthread_mutex_lock(&pool->lock);
+		job->done = 1;
+		pthread_cond_broadcast(&pool->done);
+		pthread_mutex_unlock(&pool->lock);
+	}
+	return NULL;
+}
+
+static void arc_copy(int fd, FILE *out)
+{
+	char buf[BUFSIZ];
+	ssize_t len;
+
+	lseek(fileno(out), 0, SEEK_SET);
+	while((len = read(fileno(out), buf, sizeof(buf))) > 0) {
+		if (write(fd, buf, len) != len)
+			break;
+	}
+}
+
+// decodes window of shards with pool workers, merges them in order
+static int arc_window(int fd, arc_pool_t *pool, arc_shard_t *shards, int nshards, int last, arc_job_t *st, int64_t *ngroups)
+{
+	int jobs = pool->nworkers;
+	int *ids = pool->ids;
+	int ret = 0, started = 0;
+	pthread_t tids[ARC_WINDOW];
+	arc_worker_t workers[ARC_WINDOW];
+
+	memset(pool->jobs, 0, nshards*sizeof(arc_job_t));
+	for(int i = 0; i < nshards; i++)
+		pool->jobs[i].shard = &shards[i];
+	// deal shards round-robin, so early shards are decoded first
+	// and merging can start while the rest are still in progress
+	for(int w = 0, n = 0; w < jobs; w++) {
+		pool->dq[w].ids  = &ids[n];
+		pool->dq[w].head = 0;
+		for(int i = w; i < nshards; i += jobs)
+			ids[n++] = i;
+		pool->dq[w].tail = &ids[n] - pool->dq[w].ids;
+	}
+
+	// queues of workers failed to start are stolen by others
+	for(int w = 0; w < jobs; w++) {
+		workers[w].pool = pool;
+		workers[w].id = w;
+		if (pthread_create(&tids[w], NULL, arc_worker, &workers[w]) == 0)
+			tids[started++] = tids[w];
+	}
+	if (!started)
+		arc_worker(&workers[0]);
+
+	for(int i = 0; i < nshards; i++) {
+		arc_job_t *job = &pool->jobs[i];
+		pthread_mutex_lock(&pool->lock);
+		while(!job->done)
+			pthread_cond_wait(&pool->done, &pool->lock);
+		pthread_mutex_unlock(&pool->lock);
+		if (job->failed) {
+			if (!ret)
+				dprintf(fd, "Unable to create temporary output for '%s'\n", job->shard->name);
+			ret = -1;
+		}
+		if (job->out) {
+			if (!ret) {
+				arc_copy(fd, job->out);
+				arc_merge(fd, st, job, (i + 1 < nshards) ? shards[i + 1].tune : last);
+				*ngroups += job->mon.ngroups;
+			}
+			fclose(job->out);
+		}
+	}
+
+	for(int w = 0; w < started; w++)
+		pthread_join(tids[w], NULL);
+	return ret;
+}
+
+int64_t arc_decode(int fd, arc_shard_t *shards, int nshards, int jobs, uint16_t pr_mask)
+{
+	int64_t ngroups = 0;
+	arc_job_t *st = (arc_job_t *)calloc(2, sizeof(arc_job_t));
+
+	if (st == NULL)
+		return -1;
+	if (jobs <= 0)
+		jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	if (jobs > nshards)
+		jobs = nshards;
+	if (jobs > ARC_WINDOW)
+		jobs = ARC_WINDOW;
+
+	// sequential run, no need in temporary output
+	if (jobs <= 1) {
+		for(int i = 0; i < nshards; i++) {
+			st[1].shard = &shards[i];
+			arc_decode_shard(fd, &st[1], pr_mask);
+			arc_merge(fd, st, &st[1], (i + 1 < nshards) ? shards[i + 1].tune : 1);
+			ngroups += st[1].mon.ngroups;
+		}
+		free(st);
+		return ngroups;
+	}
+
+	int window = (nshards < ARC_WINDOW) ? nshards : ARC_WINDOW;
+	arc_pool_t pool;
+	memset(&pool, 0, sizeof(pool));
+	pool.nworkers = jobs;
+	pool.pr_mask  = pr_mask;
+	pool.jobs = (arc_job_t *)calloc(window, sizeof(arc_job_t));
+	pool.dq   = (arc_deque_t *)calloc(jobs, sizeof(arc_deque_t));
+	pool.ids  = (int *)calloc(window, sizeof(int));
+	if (!pool.jobs || !pool.dq || !pool.ids) {
+		ngroups = -1;
+		goto free_all;
+	}
+
+	for(int w = 0; w < jobs; w++)
+		pthread_mutex_init(&pool.dq[w].lock, NULL);
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.done, NULL);
+
+	for(int i = 0; i < nshards && ngroups >= 0; i += window) {
+		int n = (nshards - i < window) ? nshards - i : window;
+		if (arc_window(fd, &pool, &shards[i], n, i + n == nshards, st, &ngroups) != 0)
+			ngroups = -1;
+	}
+
+	for(int w = 0; w < jobs; w++)
+		pthread_mutex_destroy(&pool.dq[w].lock);
+	pthread_mutex_destroy(&pool.lock);
+	pthread_cond_destroy(&pool.done);
+
+free_all:
+	free(pool.ids);
+	free(pool.dq);
+	free(pool.jobs);
+	free(st);
+	return ngroups;
+}
@@ -0,0 +1,63 @@
+/*	Parallel decoder of RDS capture archives
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	Captures are split into shards by file, by CAP_TUNE sync points and
+	by CAP_SYNC points of long recordings of one station. Decoders state
+	is reset at CAP_TUNE, a shard starting at CAP_SYNC rebuilds it from
+	a warm-up window of records before it, so every shard can be decoded
+	independently. Output matches decoding the station from its start
+	only when the window covers the state decoders keep: values sent
+	less often than that, like rare 14A variants or long ODA cycles,
+	may be missing from the first groups printed after the split.
+	Station summary is merged from its shards.
+*/
+
+#ifndef __RDS_ARCHIVE_H__
+#define __RDS_ARCHIVE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+typedef struct arc_shard_s
+{
+	const char *name; // capture file name
+	uint32_t sync;    // decoders state is rebuilt from this record
+	uint32_t start;   // first record
+	uint32_t nrec;    // number of records
+	uint8_t  tune;    // shard starts a station
+} arc_shard_t;
+
+// splits capture files into shards, returns number of shards or -1
+// on error, *pshards must be freed by caller
+int arc_split(char **files, int nfiles, arc_shard_t **pshards);
+
+// decodes shards using 'jobs' threads, 0 for all online CPUs,
+// writes merged ordered output to fd, returns number of decoded groups
+// or -1 if shard output cannot be created
+int64_t arc_decode(int fd, arc_shard_t *shards, int nshards, int jobs, uint16_t pr_mask);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
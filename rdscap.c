@@ -0,0 +1,239 @@
+/*	RDS groups capture file
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <time.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "rdscap.h"
+
+static int cap_valid(const cap_hdr_t *hdr)
+{
+	if (hdr->magic != CAP_MAGIC || hdr->version != CAP_VERSION)
+		return 0;
+	return hdr->rec_size == sizeof(cap_rec_t);
+}
+
+uint64_t cap_now(const cap_file_t *cap)
+{
+	struct timespec ts;
+	if (cap->ms >= 0)
+		return cap->ms;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)(ts.tv_sec - cap->hdr.start)*1000 + ts.tv_nsec/1000000;
+}
+
+int cap_create(cap_file_t *cap, const char *name)
+{
+	struct stat st;
+
+	memset(cap, 0, sizeof(cap_file_t));
+	cap->ms = -1;
+	if (stat(name, &st) == 0 && st.st_size > 0) {
+		if ((cap->fp = fopen(name, "r+b")) == NULL)
+			return -1;
+		if (fread(&cap->hdr, sizeof(cap_hdr_t), 1, cap->fp) != 1 || !cap_valid(&cap->hdr)) {
+			cap_close(cap);
+			return -1;
+		}
+		// drop partially written record, if any
+		cap->nrec = (st.st_size - sizeof(cap_hdr_t))/sizeof(cap_rec_t);
+		fseek(cap->fp, sizeof(cap_hdr_t) + cap->nrec*sizeof(cap_rec_t), SEEK_SET);
+		return 0;
+	}
+
+	if ((cap->fp = fopen(name, "w+b")) == NULL)
+		return -1;
+	cap->hdr.magic = CAP_MAGIC;
+	cap->hdr.version = CAP_VERSION;
+	cap->hdr.rec_size = sizeof(cap_rec_t);
+	cap->hdr.start = time(NULL);
+	if (fwrite(&cap->hdr, sizeof(cap_hdr_t), 1, cap->fp) != 1) {
+		cap_close(cap);
+		return -1;
+	}
+	return 0;
+}
+
+static int cap_write(cap_file_t *cap, cap_rec_t *rec)
+{
+	if (fwrite(rec, sizeof(cap_rec_t), 1, cap->fp) != 1)
+		return -1;
+	cap->nrec++;
+	return 0;
+}
+
+int cap_write_sync(cap_file_t *cap, uint8_t type, uint16_t freq)
+{
+	cap_rec_t rec;
+	// seconds and milliseconds from the same clock read, so readers
+	// can extend wrapped record time
+	uint64_t ms = cap_now(cap);
+	uint32_t now = cap->hdr.start + ms/1000;
+
+	memset(&rec, 0, sizeof(rec));
+	rec.ms = (uint32_t)ms;
+	rec.type = type;
+	rec.freq = freq;
+	rec.rds[0] = now & 0xFFFF;
+	rec.rds[1] = now >> 16;
+	return cap_write(cap, &rec);
+}
+
+int cap_write_group(cap_file_t *cap, uint16_t freq, uint8_t bler, const uint16_t *rds)
+{
+	cap_rec_t rec;
+
+	// keep sync points at fixed stride
+	if ((cap->nrec % CAP_SYNC_EVERY) == 0) {
+		if (cap_write_sync(cap, CAP_SYNC, freq) != 0)
+			return -1;
+	}
+
+	rec.ms = (uint32_t)cap_now(cap);
+	rec.type = CAP_GROUP;
+	rec.bler = bler;
+	rec.freq = freq;
+	memcpy(rec.rds, rds, sizeof(rec.rds));
+	return cap_write(cap, &rec);
+}
+
+void cap_close(cap_file_t *cap)
+{
+	if (cap->fp)
+		fclose(cap->fp);
+	cap->fp = NULL;
+}
+
+int cap_map(cap_map_t *map, const char *name)
+{
+	int fd;
+	struct stat st;
+	void *ptr;
+
+	memset(map, 0, sizeof(cap_map_t));
+	if ((fd = open(name, O_RDONLY)) < 0)
+		return -1;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(cap_hdr_t)) {
+		close(fd);
+		return -1;
+	}
+	ptr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	// mapping holds its own reference to the file
+	close(fd);
+	if (ptr == MAP_FAILED)
+		return -1;
+
+	map->size = st.st_size;
+	map->hdr  = (const cap_hdr_t *)ptr;
+	if (!cap_valid(map->hdr)) {
+		cap_unmap(map);
+		return -1;
+	}
+	map->rec  = (const cap_rec_t *)(map->hdr + 1);
+	map->nrec = (map->size - sizeof(cap_hdr_t))/sizeof(cap_rec_t);
+	madvise(ptr, map->size, MADV_SEQUENTIAL);
+	return 0;
+}
+
+void cap_unmap(cap_map_t *map)
+{
+	if (map->hdr)
+		munmap((void *)map->hdr, map->size);
+	memset(map, 0, sizeof(cap_map_t));
+}
+
+uint32_t cap_map_seek(const cap_map_t *map, uint64_t ms)
+{
+	// binary search over sync points, they are at every CAP_SYNC_EVERY record
+	uint32_t lo = 0, hi = (map->nrec + CAP_SYNC_EVERY - 1)/CAP_SYNC_EVERY;
+
+	while(hi - lo > 1) {
+		uint32_t mid = (lo + hi)/2;
+		if (cap_sync_ms(map->hdr, &map->rec[mid*CAP_SYNC_EVERY]) <= ms)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return lo*CAP_SYNC_EVERY;
+}
+
+void cap_sum_build(const cap_map_t *map, cap_sum_t *sum)
+{
+	memset(sum, 0, sizeof(cap_sum_t));
+	sum->magic = CAP_SUM_MAGIC;
+	sum->nrec  = map->nrec;
+	sum->t_min = UINT32_MAX;
+
+	for(uint32_t i = 0; i < map->nrec; i++) {
+		const cap_rec_t *rec = cap_map_rec(map, i);
+		uint32_t t = CAP_REC_TIME(map, i);
+		if (t < sum->t_min)
+			sum->t_min = t;
+		if (t > sum->t_max)
+			sum->t_max = t;
+		uint16_t ch = CAP_SUM_FREQ(rec->freq);
+		if (ch < sizeof(sum->freq)*8)
+			sum->freq[ch >> 3] |= 1 << (ch & 7);
+		if (CAP_IS_SYNC(rec) || CAP_IS_BAD(rec))
+			continue;
+
+		uint16_t b = rec->rds[1];
+		sum->pi[rec->rds[0] >> 3] |= 1 << (rec->rds[0] & 7);
+		sum->gt_mask  |= 1u << (b >> 11);
+		sum->pty_mask |= 1u << ((b >> 5) & 0x1F);
+		sum->flags |= (b & 0x0400) ? CAP_SUM_TP1 : CAP_SUM_TP0;
+		if (CAP_HAS_TA(b))
+			sum->flags |= (b & 0x0010) ? CAP_SUM_TA1 : CAP_SUM_TA0;
+	}
+	if (sum->t_min > sum->t_max)
+		sum->t_min = sum->t_max;
+}
+
+int cap_sum_load(const char *name, cap_sum_t *sum)
+{
+	FILE *fp;
+	struct stat st;
+	char idx[FILENAME_MAX];
+
+	if (stat(name, &st) != 0 || st.st_size < (off_t)sizeof(cap_hdr_t))
+		return -1;
+	uint32_t nrec = (st.st_size - sizeof(cap_hdr_t))/sizeof(cap_rec_t);
+
+	snprintf(idx, sizeof(idx), "%s.idx", name);
+	if ((fp = fopen(idx, "rb")) != NULL) {
+		size_t n = fread(sum, sizeof(cap_sum_t), 1, fp);
+		fclose(fp);
+		if (n == 1 && sum->magic == CAP_SUM_MAGIC && sum->nrec == nrec)
+			return 0;
+	}
+
+	cap_map_t map;
+	if (cap_map(&map, name) != 0)
+		return -1;
+	cap_sum_build(&map, sum);
+	cap_unmap(&map);
+
+	// archive can be read only, summary is still usable
+	if ((fp = fopen(idx, "wb")) != NULL) {
+		fwrite(sum, sizeof(cap_sum_t), 1, fp);
+		fclose(fp);
+	}
+	return 0;
+}
@@ -0,0 +1,177 @@
+/*	RDS groups capture file
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	Capture file is a 16 bytes header followed by fixed size 16 bytes
+	records. Every record with index multiple of CAP_SYNC_EVERY is a sync
+	point (CAP_SYNC or CAP_TUNE) carrying absolute time and frequency,
+	so a reader can start decoding from any of them. Record time keeps
+	only low 32 bits of milliseconds, it wraps after 49.7 days and is
+	extended to 64 bits using seconds of the sync point before it. CAP_TUNE is written
+	when the receiver is (re)tuned, decoders state is reset at CAP_TUNE.
+*/
+
+#ifndef __RDS_CAPTURE_H__
+#define __RDS_CAPTURE_H__
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+#define CAP_MAGIC      0x50414352 // 'RCAP'
+#define CAP_VERSION    1
+#define CAP_SYNC_EVERY 1024 // sync point stride, in records
+
+// record types
+#define CAP_GROUP 0 // RDS group
+#define CAP_SYNC  1 // periodic sync point
+#define CAP_TUNE  2 // sync point after tuning, resets decoders
+
+typedef struct cap_hdr_s
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t rec_size;
+	uint32_t start; // capture start time, seconds since the Epoch
+	uint32_t flags;
+} cap_hdr_t;
+
+typedef struct cap_rec_s
+{
+	uint32_t ms;     // milliseconds since capture start, low 32 bits
+	uint8_t  type;   // CAP_GROUP, CAP_SYNC, CAP_TUNE
+	uint8_t  bler;   // BLERA:BLERB:BLERC:BLERD, 2 bits each, A in bits 7:6
+	uint16_t freq;   // 9500 for 95.00 MHz
+	uint16_t rds[4]; // RDS blocks A-D, sync: rds[0] | rds[1] << 16 is time
+} cap_rec_t;
+
+typedef struct cap_file_s
+{
+	FILE     *fp;
+	cap_hdr_t hdr;
+	uint32_t  nrec; // number of records in file or read so far
+	int64_t   ms;   // time of next record for synthetic captures, -1 - wall clock
+} cap_file_t;
+
+#define CAP_IS_SYNC(prec) ((prec)->type != CAP_GROUP)
+// B, C or D block is uncorrectable (BLER 3), such groups are not decoded
+#define CAP_IS_BAD(prec) (((prec)->bler & 0x30) == 0x30 || ((prec)->bler & 0x0C) == 0x0C || \
+	((prec)->bler & 0x03) == 0x03)
+
+// open capture for appending, creates a new file if does not exist
+int  cap_create(cap_file_t *cap, const char *name);
+int  cap_write_sync(cap_file_t *cap, uint8_t type, uint16_t freq);
+int  cap_write_group(cap_file_t *cap, uint16_t freq, uint8_t bler, const uint16_t *rds);
+
+void cap_close(cap_file_t *cap);
+
+// capture mapped into memory for reading, records are accessed in place
+typedef struct cap_map_s
+{
+	const cap_hdr_t *hdr;
+	const cap_rec_t *rec; // first record
+	uint32_t nrec;        // number of records
+	size_t   size;        // size of mapping
+} cap_map_t;
+
+#define CAP_PREFETCH 16 // records to prefetch ahead, 4 cache lines
+
+// maps capture file and advises kernel about sequential access
+int  cap_map(cap_map_t *map, const char *name);
+void cap_unmap(cap_map_t *map);
+// returns last sync point at or before 'ms', uses fixed sync points stride
+uint32_t cap_map_seek(const cap_map_t *map, uint64_t ms);
+
+// returns record 'idx' prefetching records ahead for linear scans
+static inline const cap_rec_t *cap_map_rec(const cap_map_t *map, uint32_t idx)
+{
+	if (idx + CAP_PREFETCH < map->nrec)
+		__builtin_prefetch(&map->rec[idx + CAP_PREFETCH]);
+	return &map->rec[idx];
+}
+
+// milliseconds since capture start of sync point, wrapped record time
+// is moved to the nearest value matching seconds the sync point carries
+static inline uint64_t cap_sync_ms(const cap_hdr_t *hdr, const cap_rec_t *sync)
+{
+	uint32_t sec = sync->rds[0] | (uint32_t)sync->rds[1] << 16;
+	uint64_t ms = (uint64_t)(sec - hdr->start)*1000;
+	return ms + (int32_t)(sync->ms - (uint32_t)ms);
+}
+
+// milliseconds since capture start of record 'idx', extended using sync
+// point at the start of its stride
+static inline uint64_t cap_map_ms(const cap_map_t *map, uint32_t idx)
+{
+	const cap_rec_t *sync = &map->rec[idx & ~(CAP_SYNC_EVERY - 1)];
+	if (!CAP_IS_SYNC(sync)) // not written by cap_write_group()
+		return map->rec[idx].ms;
+	return cap_sync_ms(map->hdr, sync) + (uint32_t)(map->rec[idx].ms - sync->ms);
+}
+
+// seconds since the Epoch of record 'idx'
+#define CAP_REC_TIME(pmap, idx) ((pmap)->hdr->start + cap_map_ms(pmap, idx)/1000)
+
+// milliseconds since capture start
+uint64_t cap_now(const cap_file_t *cap);
+
+/*
+	Capture summary, stored next to capture as 'name.idx' and used
+	to skip captures which cannot match a query without mapping them
+*/
+#define CAP_SUM_MAGIC 0x58444952 // 'RIDX'
+#define CAP_SUM_FREQ(freq) (((freq) - 7600)/5) // 50 kHz steps from 76 MHz
+
+// seen flags
+#define CAP_SUM_TA0 0x01
+#define CAP_SUM_TA1 0x02
+#define CAP_SUM_TP0 0x04
+#define CAP_SUM_TP1 0x08
+
+typedef struct cap_sum_s
+{
+	uint32_t magic;
+	uint32_t nrec;     // records summarized, summary is stale if capture grew
+	uint32_t t_min;    // time bounds, seconds since the Epoch
+	uint32_t t_max;
+	uint32_t gt_mask;  // group types, bit number is GT*2 + version
+	uint32_t pty_mask; // program types
+	uint32_t flags;    // CAP_SUM_* flags
+	uint8_t  freq[96]; // frequencies bitmap, indexed by CAP_SUM_FREQ()
+	uint8_t  pi[8192]; // PI codes bitmap
+} cap_sum_t;
+
+#define CAP_SUM_BIT(map, bit) ((map)[(bit) >> 3] & (1 << ((bit) & 7)))
+
+// TA flag is defined for 0A, 0B and 15B groups only
+#define CAP_HAS_TA(rds_b) (((rds_b) & 0xF000) == 0 || ((rds_b) & 0xF800) == 0xF800)
+
+void cap_sum_build(const cap_map_t *map, cap_sum_t *sum);
+// loads summary of capture 'name', builds and stores it if missing or stale
+int  cap_sum_load(const char *name, cap_sum_t *sum);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
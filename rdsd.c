@@ -0,0 +1,374 @@
+/*	rdspi daemon serving commands over Unix domain socket
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <poll.h>
+#include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <grp.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+#include "cli.h"
+#include "rdsd.h"
+#include "rpi_pin.h"
+
+#define RDSD_MAX_CLIENTS 16
+#define RDSD_POLL_MS     100 // console is checked for a key that often
+
+typedef struct rdsd_client_s
+{
+	int      fd;
+	uint32_t len; // bytes in buf
+	uint8_t  buf[sizeof(rdsd_hdr_t) + RDSD_MAX_FRAME + 1];
+} rdsd_client_t;
+
+// command output forwarder, runs while command is executed
+typedef struct rdsd_fwd_s
+{
+	int      sd;      // client socket
+	int      out;     // read end of command output pipe
+	uint32_t limit;   // seconds, 0 - no limit
+	int      gone;    // client disconnected
+	int      expired; // time limit reached
+} rdsd_fwd_t;
+
+static volatile sig_atomic_t rdsd_stop;
+volatile int rdsd_cancel;
+
+static void rdsd_signal(int sig)
+{
+	rdsd_stop = sig;
+}
+
+const char *rdsd_sock(void)
+{
+	const char *sock = getenv(RDSD_ENV);
+	return sock ? sock : RDSD_SOCK;
+}
+
+static int rdsd_addr(struct sockaddr_un *addr, const char *sock)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if (strlen(sock) >= sizeof(addr->sun_path))
+		return -1;
+	strcpy(addr->sun_path, sock);
+	return 0;
+}
+
+static int rdsd_send(int sd, uint8_t type, const void *data, uint32_t len)
+{
+	rdsd_hdr_t hdr;
+	hdr.type = type;
+	hdr.rsv  = 0;
+	hdr.len  = len;
+	if (send(sd, &hdr, sizeof(hdr), MSG_NOSIGNAL | (len ? MSG_MORE : 0)) != sizeof(hdr))
+		return -1;
+	if (len && send(sd, data, len, MSG_NOSIGNAL) != (ssize_t)len)
+		return -1;
+	return 0;
+}
+
+static int rdsd_recv(int sd, void *data, uint32_t len)
+{
+	uint8_t *p = (uint8_t *)data;
+	while(len) {
+		ssize_t n = recv(sd, p, len, 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		p += n;
+		len -= n;
+	}
+	return 0;
+}
+
+// sends command output to client as it is written until the command
+// closes the pipe, cancels the command if client hangs up or time is out
+static void *rdsd_forward(void *arg)
+{
+	rdsd_fwd_t *fwd = (rdsd_fwd_t *)arg;
+	char buf[RDSD_MAX_FRAME];
+	struct pollfd polls[2];
+	uint64_t start = rpi_micros();
+
+	polls[0].fd = fwd->out;
+	polls[0].events = POLLIN;
+	// requests sent ahead stay in the socket, only hang up is watched
+	polls[1].fd = fwd->sd;
+	polls[1].events = POLLRDHUP;
+	while(1) {
+		if (poll(polls, 2, RDSD_POLL_MS) < 0 && errno != EINTR)
+			break;
+		if (polls[1].revents) {
+			fwd->gone = 1;
+			polls[1].fd = -1;
+		}
+		if (polls[0].revents) {
+			ssize_t n = read(fwd->out, buf, sizeof(buf));
+			if (n <= 0)
+				break;
+			// output of cancelled command is drained, so it never blocks
+			if (!fwd->gone && rdsd_send(fwd->sd, RDSD_OUT, buf, n) != 0)
+				fwd->gone = 1;
+		}
+		if (fwd->limit && rpi_micros() - start >= fwd->limit*1000000ull)
+			fwd->expired = 1;
+		if (fwd->gone || fwd->expired)
+			rdsd_cancel = 1;
+	}
+	return NULL;
+}
+
+// commands which would read daemon console instead of the client
+static int rdsd_allowed(const char *name, const char *arg)
+{
+	if (!strcmp(name, "daemon"))
+		return 0;
+	if (!strcmp(name, "batch") && arg && !strcmp(arg, "-"))
+		return 0;
+	return 1;
+}
+
+// runs command streaming its output to client, returns -1 if client is gone
+static int rdsd_exec(int fd, int sd, char *line, cmd_t *cmds, uint32_t limit)
+{
+	int32_t status = CLI_ENOTSUP;
+	int pipefd[2];
+	pthread_t tid;
+	rdsd_fwd_t fwd;
+	char *arg;
+
+	if (pipe(pipefd) != 0)
+		return -1;
+	memset(&fwd, 0, sizeof(fwd));
+	fwd.sd    = sd;
+	fwd.out   = pipefd[0];
+	fwd.limit = limit;
+	rdsd_cancel = 0;
+	if (pthread_create(&tid, NULL, rdsd_forward, &fwd) != 0) {
+		close(pipefd[0]);
+		close(pipefd[1]);
+		return -1;
+	}
+
+	for(uint32_t i = 0; cmds[i].name != NULL; i++) {
+		// commands reading daemon console are not supported
+		if (cmd_arg(line, cmds[i].name, &arg)) {
+			if (rdsd_allowed(cmds[i].name, arg))
+				status = cmds[i].cmd(pipefd[1], *arg ? arg : NULL);
+			break;
+		}
+	}
+	if (fwd.expired)
+		dprintf(pipefd[1], "Stopped after %u s, daemon time limit\n", limit);
+	close(pipefd[1]);
+	pthread_join(tid, NULL);
+	close(pipefd[0]);
+	rdsd_cancel = 0;
+	dprintf(fd, "%s: %d%s\n", line, status, fwd.gone ? ", client gone" : (fwd.expired ? ", time limit" : ""));
+
+	if (fwd.gone)
+		return -1;
+	return rdsd_send(sd, RDSD_END, &status, sizeof(status));
+}
+
+// reads available data, executes complete request, returns -1 to drop client
+static int rdsd_read(int fd, rdsd_client_t *cl, cmd_t *cmds, uint32_t limit)
+{
+	ssize_t n = recv(cl->fd, cl->buf + cl->len, sizeof(cl->buf) - 1 - cl->len, 0);
+	if (n <= 0)
+		return -1;
+	cl->len += n;
+
+	while(cl->len >= sizeof(rdsd_hdr_t)) {
+		rdsd_hdr_t *hdr = (rdsd_hdr_t *)cl->buf;
+		if (hdr->type != RDSD_REQ || hdr->len > RDSD_MAX_FRAME)
+			return -1;
+		uint32_t size = sizeof(rdsd_hdr_t) + hdr->len;
+		if (cl->len < size)
+			break;
+		char *line = (char *)cl->buf + sizeof(rdsd_hdr_t);
+		char last = line[hdr->len];
+		line[hdr->len] = '\0';
+		if (rdsd_exec(fd, cl->fd, line, cmds, limit) != 0)
+			return -1;
+		line[hdr->len] = last;
+		memmove(cl->buf, cl->buf + size, cl->len - size);
+		cl->len -= size;
+	}
+	return 0;
+}
+
+// sets socket mode and group from environment, umask of root would
+// leave it writable for root only
+static int rdsd_perm(int fd, const char *sock)
+{
+	mode_t mode = RDSD_MODE;
+	const char *val = getenv(RDSD_MODE_ENV);
+	if (val)
+		mode = strtoul(val, NULL, 8) & 0777;
+	if ((val = getenv(RDSD_GROUP_ENV)) != NULL) {
+		struct group *gr = getgrnam(val);
+		if (gr == NULL || chown(sock, (uid_t)-1, gr->gr_gid) != 0) {
+			dprintf(fd, "unable to set group '%s' of %s\n", val, sock);
+			return -1;
+		}
+	}
+	if (chmod(sock, mode) != 0) {
+		dprintf(fd, "unable to set mode %03o of %s\n", mode, sock);
+		return -1;
+	}
+	return 0;
+}
+
+int rdsd_serve(int fd, const char *sock, cmd_t *cmds, uint32_t limit)
+{
+	struct sockaddr_un addr;
+	rdsd_client_t *clients;
+	struct pollfd polls[RDSD_MAX_CLIENTS + 1];
+	int nclients = 0;
+
+	if (rdsd_addr(&addr, sock) != 0)
+		return -1;
+
+	int ls = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (ls < 0)
+		return -1;
+	// socket file left by killed daemon is removed, running one is kept
+	if (connect(ls, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+		dprintf(fd, "daemon is already running on %s\n", sock);
+		close(ls);
+		return -1;
+	}
+	unlink(sock);
+	if (bind(ls, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(ls, RDSD_MAX_CLIENTS) != 0) {
+		dprintf(fd, "unable to listen on %s\n", sock);
+		close(ls);
+		return -1;
+	}
+	if (rdsd_perm(fd, sock) != 0) {
+		close(ls);
+		unlink(sock);
+		return -1;
+	}
+
+	clients = (rdsd_client_t *)calloc(RDSD_MAX_CLIENTS, sizeof(rdsd_client_t));
+	if (clients == NULL) {
+		close(ls);
+		unlink(sock);
+		return -1;
+	}
+
+	struct sigaction sa, sa_int, sa_term;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = rdsd_signal;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, &sa_int);
+	sigaction(SIGTERM, &sa, &sa_term);
+
+	rdsd_stop = 0;
+	dprintf(fd, "serving on %s", sock);
+	if (limit)
+		dprintf(fd, ", commands limited to %u s", limit);
+	dprintf(fd, ", press any key to terminate...\n");
+	while(!rdsd_stop && !is_stop(NULL)) {
+		polls[0].fd = ls;
+		polls[0].events = POLLIN;
+		for(int i = 0; i < nclients; i++) {
+			polls[i + 1].fd = clients[i].fd;
+			polls[i + 1].events = POLLIN;
+		}
+
+		int n = poll(polls, nclients + 1, RDSD_POLL_MS);
+		if (n <= 0)
+			continue;
+
+		for(int i = nclients - 1; i >= 0; i--) {
+			if (!polls[i + 1].revents)
+				continue;
+			if (rdsd_read(fd, &clients[i], cmds, limit) != 0) {
+				close(clients[i].fd);
+				clients[i] = clients[--nclients];
+			}
+		}
+
+		if (polls[0].revents & POLLIN) {
+			int cs = accept(ls, NULL, NULL);
+			if (cs >= 0 && nclients < RDSD_MAX_CLIENTS) {
+				clients[nclients].fd = cs;
+				clients[nclients].len = 0;
+				nclients++;
+			}
+			else if (cs >= 0)
+				close(cs);
+		}
+	}
+
+	sigaction(SIGINT, &sa_int, NULL);
+	sigaction(SIGTERM, &sa_term, NULL);
+	for(int i = 0; i < nclients; i++)
+		close(clients[i].fd);
+	free(clients);
+	close(ls);
+	unlink(sock);
+	return 0;
+}
+
+int rdsd_request(int fd, const char *sock, const char *line, int *status)
+{
+	struct sockaddr_un addr;
+	uint32_t len = strlen(line);
+
+	if (rdsd_addr(&addr, sock) != 0 || len > RDSD_MAX_FRAME)
+		return -1;
+	int sd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sd < 0)
+		return -1;
+	if (connect(sd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+		rdsd_send(sd, RDSD_REQ, line, len) != 0) {
+		close(sd);
+		return -1;
+	}
+
+	int ret = -1;
+	char buf[RDSD_MAX_FRAME];
+	rdsd_hdr_t hdr;
+	while(rdsd_recv(sd, &hdr, sizeof(hdr)) == 0 && hdr.len <= RDSD_MAX_FRAME) {
+		if (rdsd_recv(sd, buf, hdr.len) != 0)
+			break;
+		if (hdr.type == RDSD_OUT) {
+			if (write(fd, buf, hdr.len) != (ssize_t)hdr.len)
+				break;
+		}
+		else if (hdr.type == RDSD_END && hdr.len == sizeof(int32_t)) {
+			int32_t val;
+			memcpy(&val, buf, sizeof(val));
+			*status = val;
+			ret = 0;
+			break;
+		}
+	}
+	close(sd);
+	return ret;
+}
@@ -0,0 +1,84 @@
+/*	rdspi daemon serving commands over Unix domain socket
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	Daemon owns I2C bus and Si4703, commands of all clients are executed
+	one at a time, so clients never race on the bus. Every message is a
+	frame: 4 bytes header, type, reserved byte, payload length in host
+	order, followed by payload
+
+	RDSD_REQ - client to daemon, command line as for rdspi, 'tune 95.00'
+	RDSD_OUT - daemon to client, command output as it is written, any
+	           number of frames
+	RDSD_END - daemon to client, command completed, int32_t status
+
+	Command is stopped, as by a key press, when its client disconnects or
+	it runs longer than the daemon time limit, so 'rds time 0' or 'state'
+	of one client cannot hold the radio forever.
+*/
+
+#ifndef __RDSPI_DAEMON_H__
+#define __RDSPI_DAEMON_H__
+
+#include <stdint.h>
+
+#include "cmd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+#define RDSD_ENV  "RDSPI_SOCK"      // environment variable to override socket
+#define RDSD_SOCK "/tmp/rdspi.sock" // default socket
+// daemon runs as root for GPIO and I2C, socket permissions are set
+// explicitly, so clients do not need root
+#define RDSD_MODE_ENV  "RDSPI_SOCK_MODE"  // octal socket mode
+#define RDSD_GROUP_ENV "RDSPI_SOCK_GROUP" // socket group name
+#define RDSD_MODE 0666                    // default socket mode
+#define RDSD_MAX_FRAME 4096         // max payload size
+#define RDSD_LIMIT     60           // default command time limit, seconds
+
+#define RDSD_REQ 'Q'
+#define RDSD_OUT 'O'
+#define RDSD_END 'E'
+
+typedef struct rdsd_hdr_s
+{
+	uint8_t  type;
+	uint8_t  rsv;
+	uint16_t len;
+} rdsd_hdr_t;
+
+// set while command of a client must stop, checked by is_stop()
+extern volatile int rdsd_cancel;
+
+// returns socket name from environment or default one
+const char *rdsd_sock(void);
+// serves commands until key is pressed on fd console, SIGINT or SIGTERM,
+// every command is stopped after 'limit' seconds, 0 - no limit
+int rdsd_serve(int fd, const char *sock, cmd_t *cmds, uint32_t limit);
+// sends command line to daemon, copies output to fd and command
+// return value to status, returns -1 if daemon is not available
+int rdsd_request(int fd, const char *sock, const char *line, int *status);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,229 @@
+/*	Change-only RDS events
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <time.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rdsevt.h"
+
+static const char *evt_names[] = { "PI", "PS", "RT", "PTYN", "TA", "PTY", "AF", "EON", "CT" };
+
+static void evt_report(rds_events_t *ev, uint8_t kind, uint16_t value, const char *text)
+{
+	rds_evt_t evt;
+	evt.ms    = ev->ms;
+	evt.pi    = ev->pi;
+	evt.kind  = kind;
+	evt.value = value;
+	evt.text[0] = '\0';
+	if (text) {
+		strncpy(evt.text, text, sizeof(evt.text) - 1);
+		evt.text[sizeof(evt.text) - 1] = '\0';
+	}
+	ev->on_evt(ev->data, &evt);
+}
+
+// completed texts from rds_mon_group()
+static void evt_text(void *data, uint16_t pi, uint8_t kind, const char *text)
+{
+	rds_events_t *ev = (rds_events_t *)data;
+	if (pi != ev->pi)
+		return;
+
+	if (kind == RDS_TEXT_PS && strcmp(ev->ps, text)) {
+		strcpy(ev->ps, text);
+		evt_report(ev, RDS_EVT_PS, 0, text);
+	}
+	if (kind == RDS_TEXT_RT) {
+		// text belongs to A/B flag of segments received so far
+		uint8_t ab = ev->mon->rd2.ab;
+		if (strcmp(ev->rt, text) || ab != ev->rt_ab) {
+			strcpy(ev->rt, text);
+			ev->rt_ab = ab;
+			evt_report(ev, RDS_EVT_RT, ab, text);
+		}
+	}
+	if (kind == RDS_TEXT_PTYN && strcmp(ev->ptyn, text)) {
+		strcpy(ev->ptyn, text);
+		evt_report(ev, RDS_EVT_PTYN, 0, text);
+	}
+}
+
+static void evt_station(rds_events_t *ev, uint16_t pi)
+{
+	rds_mon_t *mon = ev->mon;
+	rds_evt_cb *on_evt = ev->on_evt;
+	void *data = ev->data;
+	uint64_t ms = ev->ms;
+
+	// new station, forget everything reported for the previous one
+	memset(ev, 0, sizeof(rds_events_t));
+	ev->mon = mon;
+	ev->on_evt = on_evt;
+	ev->data = data;
+	ev->ms = ms;
+	ev->pi = pi;
+	ev->pi_new = pi;
+	ev->ta = -1;
+	ev->pty = 0xFF;
+	ev->rt_ab = 0xFF;
+}
+
+void rds_events_init(rds_events_t *ev, rds_mon_t *mon, rds_evt_cb *on_evt, void *data)
+{
+	memset(ev, 0, sizeof(rds_events_t));
+	ev->mon = mon;
+	ev->on_evt = on_evt;
+	ev->data = data;
+	ev->ta = -1;
+	ev->pty = 0xFF;
+	ev->rt_ab = 0xFF;
+	mon->on_text = evt_text;
+	mon->data = ev;
+}
+
+void rds_events_group(int fd, rds_events_t *ev, uint64_t ms, const uint16_t *prds)
+{
+	rds_mon_t *mon = ev->mon;
+	uint16_t pi = prds[RDS_A];
+	uint8_t  gt = (prds[RDS_B] >> 11) & 0x1F; // group type and version
+	uint8_t  pty = (prds[RDS_B] >> 5) & 0x1F;
+
+	ev->ms = ms;
+	if (pi != ev->pi) {
+		// texts of unconfirmed station are ignored by evt_text()
+		if (pi == ev->pi_new) {
+			evt_station(ev, pi);
+			evt_report(ev, RDS_EVT_PI, pi, NULL);
+		}
+		else {
+			ev->pi_new = pi;
+			rds_mon_group(fd, mon, prds);
+			return;
+		}
+	}
+
+	rds_mon_group(fd, mon, prds);
+
+	if (pty != ev->pty) {
+		if (pty == ev->pty_new) {
+			ev->pty = pty;
+			evt_report(ev, RDS_EVT_PTY, pty, NULL);
+		}
+	}
+	ev->pty_new = pty;
+
+	// TA is sent in 0A, 0B and 15B
+	if (gt == 0 || gt == 1 || gt == 31) {
+		int8_t ta = !!(prds[RDS_B] & RDS_TA);
+		if (ta != ev->ta) {
+			ev->ta = ta;
+			evt_report(ev, RDS_EVT_TA, ta, NULL);
+		}
+	}
+
+	if (gt == 0) {
+		for(int i = 0; i < 25 && mon->rd0.af[i]; i++) {
+			uint8_t af = mon->rd0.af[i];
+			if (!(ev->af[af/32] & (1u << (af % 32)))) {
+				ev->af[af/32] |= 1u << (af % 32);
+				evt_report(ev, RDS_EVT_AF, 8750 + af*10, NULL);
+			}
+		}
+	}
+
+	if (gt == 2*14) {
+		uint16_t on = mon->rd14.pi_on;
+		int i;
+		for(i = 0; i < ev->neon && ev->eon[i] != on; i++);
+		if (on && i == ev->neon && ev->neon < sizeof(ev->eon)/sizeof(ev->eon[0])) {
+			ev->eon[ev->neon++] = on;
+			evt_report(ev, RDS_EVT_EON, on, NULL);
+		}
+	}
+
+	if (gt == 2*4) {
+		rds_gt04a_t *rd4 = &mon->rd4;
+		uint32_t ct = ((rd4->year*13 + rd4->month)*32 + rd4->day)*1440 + rd4->hour*60 + rd4->minute;
+		if (ct != ev->ct) {
+			char text[32];
+			ev->ct = ct;
+			snprintf(text, sizeof(text), "%04u-%02u-%02uT%02u:%02u%c%02u:%02u",
+				rd4->year, rd4->month, rd4->day, rd4->hour, rd4->minute,
+				rd4->ts_sign ? '-' : '+', rd4->tz_hour, rd4->tz_half ? 30 : 0);
+			evt_report(ev, RDS_EVT_CT, 0, text);
+		}
+	}
+}
+
+void rds_evt_print(wbuf_t *wb, const rds_evt_t *evt)
+{
+	time_t t = evt->ms/1000;
+	struct tm tm;
+	localtime_r(&t, &tm);
+	wbuf_printf(wb, "%02d:%02d:%02d.%03u %04X %-4s ", tm.tm_hour, tm.tm_min, tm.tm_sec,
+		(unsigned)(evt->ms % 1000), evt->pi, evt_names[evt->kind]);
+
+	switch(evt->kind) {
+	case RDS_EVT_PI:
+	case RDS_EVT_EON:
+		wbuf_printf(wb, "%04X\n", evt->value);
+		break;
+	case RDS_EVT_RT:
+		wbuf_printf(wb, "%c '%s'\n", 'A' + evt->value, evt->text);
+		break;
+	case RDS_EVT_TA:
+	case RDS_EVT_PTY:
+		wbuf_printf(wb, "%u\n", evt->value);
+		break;
+	case RDS_EVT_AF:
+		wbuf_printf(wb, "%u.%02u\n", evt->value/100, evt->value%100);
+		break;
+	case RDS_EVT_CT:
+		wbuf_printf(wb, "%s\n", evt->text);
+		break;
+	default:
+		wbuf_printf(wb, "'%s'\n", evt->text);
+	}
+}
+
+void rds_evt_json(jw_t *jw, const rds_evt_t *evt)
+{
+	jw_u64(jw, "ts", evt->ms);
+	jw_hex(jw, "pi", evt->pi, 4);
+	jw_str(jw, "event", evt_names[evt->kind]);
+
+	switch(evt->kind) {
+	case RDS_EVT_PI:
+	case RDS_EVT_EON:
+		jw_hex(jw, "value", evt->value, 4);
+		break;
+	case RDS_EVT_RT:
+		jw_str(jw, "ab", evt->value ? "B" : "A");
+		jw_str(jw, "text", evt->text);
+		break;
+	case RDS_EVT_TA:
+	case RDS_EVT_PTY:
+		jw_uint(jw, "value", evt->value);
+		break;
+	case RDS_EVT_AF:
+		jw_uint(jw, "value", evt->value*10); // kHz
+		break;
+	default:
+		jw_str(jw, "text", evt->text);
+	}
+}
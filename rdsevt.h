@@ -0,0 +1,94 @@
+/*	Change-only RDS events
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	Groups are decoded by rds_mon_group() as usual, but instead of
+	printing every group an event is reported only when decoded state
+	changes. PI and PTY must be received twice in a row to be reported,
+	so a single damaged group does not produce a change.
+*/
+
+#ifndef __RDS_EVENTS_H__
+#define __RDS_EVENTS_H__
+
+#include "rdsmon.h"
+#include "jsonw.h"
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+// event kinds
+#define RDS_EVT_PI   0 // new station, value - PI
+#define RDS_EVT_PS   1 // text - PS
+#define RDS_EVT_RT   2 // text - Radiotext, value - A/B flag
+#define RDS_EVT_PTYN 3 // text - Program Type Name
+#define RDS_EVT_TA   4 // value - TA flag
+#define RDS_EVT_PTY  5 // value - PTY
+#define RDS_EVT_AF   6 // value - new alternative frequency, 9500 for 95.00 MHz
+#define RDS_EVT_EON  7 // value - PI of new other network
+#define RDS_EVT_CT   8 // text - clock-time as 2015-06-01T18:30+01:00
+
+typedef struct rds_evt_s
+{
+	uint64_t ms;     // ms since the Epoch
+	uint16_t pi;
+	uint8_t  kind;
+	uint16_t value;
+	char     text[65];
+} rds_evt_t;
+
+typedef void (rds_evt_cb)(void *data, const rds_evt_t *evt);
+
+typedef struct rds_events_s
+{
+	rds_mon_t  *mon;
+	rds_evt_cb *on_evt;
+	void       *data;    // on_evt callback data
+	uint64_t    ms;      // time of current group
+
+	uint16_t pi;         // reported values
+	uint16_t pi_new;     // candidates waiting for confirmation
+	uint8_t  pty;
+	uint8_t  pty_new;
+	int8_t   ta;
+	uint8_t  rt_ab;
+	char     ps[9];
+	char     rt[65];
+	char     ptyn[9];
+	uint32_t af[7];      // bitmap of reported AF codes 1-204
+	uint16_t eon[32];    // reported other networks
+	uint8_t  neon;
+	uint32_t ct;         // last reported clock-time, minutes
+} rds_events_t;
+
+// sets mon->on_text, so it cannot be used by anyone else
+void rds_events_init(rds_events_t *ev, rds_mon_t *mon, rds_evt_cb *on_evt, void *data);
+// decodes group received at 'ms' and reports changes
+void rds_events_group(int fd, rds_events_t *ev, uint64_t ms, const uint16_t *prds);
+// prints event as one line, buffer is not flushed
+void rds_evt_print(wbuf_t *wb, const rds_evt_t *evt);
+// adds event fields to '--json' record
+void rds_evt_json(jw_t *jw, const rds_evt_t *evt);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
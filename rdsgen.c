@@ -0,0 +1,289 @@
+/*	Synthetic RDS groups generator
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rdsgen.h"
+
+#define GEN_TP 0x0400 // Traffic Program bit in block B
+
+// every known group type, the ones without decoder and some B versions
+static const char *gen_sched = "0A,2A,0A,2A,0A,2A,0A,2A,1A,3A,8A,2A,0A,14A,10A,2A,"
+	"5A,0A,2A,6A,8A,2A,0B,2B,7A,9A,11A,12A,13A,15B";
+
+static const char *gen_rt[GEN_MAX_RT] = {
+	"Now playing %04X track one",
+	"Traffic news on %04X every 15 minutes",
+	"Call %04X now",
+	"Weather for today sunny and warm with light wind from the south west"
+};
+
+static uint32_t gen_rand(uint32_t *rnd)
+{
+	uint32_t x = *rnd; // xorshift32
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *rnd = x;
+}
+
+// RDS AF code of frequency, 9500 for 95.00 MHz
+static uint8_t gen_af(uint16_t freq)
+{
+	return (freq - 8750)/10;
+}
+
+uint16_t gen_station_freq(uint32_t i)
+{
+	// 206 channels of 100 kHz in 87.50-108.00 MHz band
+	return 8750 + ((6 + i*32) % 206)*10;
+}
+
+void gen_station_init(gen_station_t *st, uint16_t pi, uint16_t freq)
+{
+	memset(st, 0, sizeof(gen_station_t));
+	st->pi   = pi;
+	st->freq = freq;
+	st->pty  = PTY_ROCK;
+	st->tp   = 1;
+	st->rnd  = 0x9E3779B9u ^ pi;
+	sprintf(st->ps, "GEN %04X", pi);
+	strcpy(st->ptyn, "SYNTHRDS");
+	for(int i = 0; i < GEN_MAX_RT; i++) {
+		snprintf(st->rt[i], sizeof(st->rt[i]), gen_rt[i], pi);
+		st->nrt++;
+	}
+	st->rt_groups = 200;
+
+	st->af[st->naf++] = gen_af(freq);
+	st->af[st->naf++] = gen_af(freq < 10000 ? freq + 1000 : freq - 1000);
+	st->af[st->naf++] = gen_af(freq < 10500 ? freq + 250 : freq - 250);
+
+	st->eon_pi = pi ^ 0x0100;
+	sprintf(st->eon_ps, "EON %04X", st->eon_pi);
+	st->eon_af = gen_af(freq < 10700 ? freq + 100 : freq - 100);
+	st->tmc_loc = 0x2A00;
+	st->ct_min = ~0u;
+	gen_set_sched(st, gen_sched);
+}
+
+int gen_set_sched(gen_station_t *st, const char *sched)
+{
+	uint8_t n = 0;
+	const char *p = sched;
+
+	while(*p && n < GEN_MAX_SCHED) {
+		if (!isdigit((uint8_t)*p))
+			return -1;
+		char *end;
+		int gt = strtoul(p, &end, 10);
+		int ver = toupper((uint8_t)*end) - 'A';
+		if (gt > 15 || ver < 0 || ver > 1)
+			return -1;
+		st->sched[n++] = RDS_GT(gt, ver);
+		p = end + 1;
+		if (*p == ',')
+			p++;
+	}
+	if (n == 0)
+		return -1;
+	st->nsched = n;
+	st->pos = 0;
+	return 0;
+}
+
+static void gen_ct(gen_station_t *st, uint32_t t, uint16_t *rds)
+{
+	uint32_t mjd = t/86400 + 40587;
+	uint8_t hour = (t/3600) % 24;
+	uint8_t minute = (t/60) % 60;
+	uint8_t tz = abs(st->tz) & 0x0F;
+
+	rds[RDS_B] |= (mjd >> 15) & 0x03;
+	rds[RDS_C] = ((mjd & 0x7FFF) << 1) | (hour >> 4);
+	rds[RDS_D] = ((hour & 0x0F) << 12) | (minute << 6) | (st->tz < 0 ? 0x20 : 0) | tz;
+}
+
+void gen_group(gen_station_t *st, uint32_t t, uint16_t *rds)
+{
+	uint16_t gtv = st->sched[st->pos];
+
+	// clock-time at the start of every minute
+	if (t/60 != st->ct_min) {
+		st->ct_min = t/60;
+		gtv = RDS_GT_04A;
+	}
+	else if (++st->pos >= st->nsched)
+		st->pos = 0;
+	st->ngroups++;
+
+	uint8_t ver = !!(gtv & RDS_VER);
+	rds[RDS_A] = st->pi;
+	rds[RDS_B] = gtv | (st->tp ? GEN_TP : 0) | RDS_PTY(st->pty);
+	rds[RDS_C] = ver ? st->pi : (uint16_t)gen_rand(&st->rnd);
+	rds[RDS_D] = gen_rand(&st->rnd);
+
+	switch(gtv >> 11) {
+	case 0:  // 0A: PS and AF
+	case 1:  // 0B: PS, block C repeats PI
+	case 31: // 15B: fast tuning, block D repeats block B
+		rds[RDS_B] |= (st->ta ? RDS_TA : 0) | RDS_MS | st->ps_ci;
+		rds[RDS_D] = (st->ps[st->ps_ci*2] << 8) | (uint8_t)st->ps[st->ps_ci*2 + 1];
+		if (gtv == RDS_GT(15, 1))
+			rds[RDS_D] = rds[RDS_B];
+		else if (!ver && st->ps_ci == 0)
+			rds[RDS_C] = ((224 + st->naf) << 8) | (st->naf ? st->af[0] : 205);
+		else if (!ver && st->naf < 2)
+			rds[RDS_C] = (205 << 8) | 205;
+		else if (!ver) {
+			// AF method A: number of AFs and the first one, then pairs
+			uint8_t i = 1 + (st->af_idx++ % (st->naf/2))*2;
+			rds[RDS_C] = (st->af[i] << 8) | (i + 1 < st->naf ? st->af[i + 1] : 205);
+		}
+		st->ps_ci = (st->ps_ci + 1) & 0x03;
+		break;
+	case 2: // 1A: slow labelling, program item number
+		rds[RDS_B] &= ~0x1F;
+		rds[RDS_C] = 0x00E1;
+		rds[RDS_D] = ((t/86400 % 31 + 1) << 11) | ((t/3600 % 24) << 6) | (t/60 % 60);
+		break;
+	case 4: { // 2A: Radiotext
+		const char *rt = st->rt[st->rt_idx];
+		uint8_t len = strlen(rt);
+		uint8_t nseg = (len < 64) ? (len + 4)/4 : 16;
+		char seg[4];
+		for(int i = 0; i < 4; i++) {
+			int n = st->rt_si*4 + i;
+			seg[i] = (n < len) ? rt[n] : ((n == len) ? '\r' : ' ');
+		}
+		rds[RDS_B] |= (st->rt_ab ? RDS_AB : 0) | st->rt_si;
+		rds[RDS_C] = ((uint8_t)seg[0] << 8) | (uint8_t)seg[1];
+		rds[RDS_D] = ((uint8_t)seg[2] << 8) | (uint8_t)seg[3];
+		if (++st->rt_si >= nseg)
+			st->rt_si = 0;
+		// change text at segment 0 only, so every text is sent completely
+		if (st->rt_si == 0 && st->nrt > 1 && st->ngroups - st->rt_start >= st->rt_groups) {
+			st->rt_idx = (st->rt_idx + 1) % st->nrt;
+			st->rt_ab ^= 1;
+			st->rt_start = st->ngroups;
+		}
+		break;
+	}
+	case 5: { // 2B: 32 characters Radiotext
+		uint8_t si = st->ngroups & 0x0F;
+		const char *rt = st->rt[st->rt_idx];
+		uint8_t len = strlen(rt);
+		rds[RDS_B] |= (st->rt_ab ? RDS_AB : 0) | si;
+		rds[RDS_D] = ((si*2 < len ? (uint8_t)rt[si*2] : ' ') << 8) | (si*2 + 1 < len ? (uint8_t)rt[si*2 + 1] : ' ');
+		break;
+	}
+	case 6: // 3A: open data application, RDS-TMC in 8A
+		rds[RDS_B] = (rds[RDS_B] & ~0x1F) | RDS_GT_08A >> 11;
+		rds[RDS_C] = (1 << 6) | 0x10;
+		rds[RDS_D] = 0xCD46;
+		break;
+	case 8: // 4A: clock-time and date
+		rds[RDS_B] &= ~0x1F;
+		gen_ct(st, t, rds);
+		break;
+	case 10: // 5A: transparent data channels
+		rds[RDS_B] = (rds[RDS_B] & ~0x1F) | (st->tdc++ & 0x1F);
+		break;
+	case 16: // 8A: TMC, single group user messages and system tuning information
+		rds[RDS_B] &= ~0x1F;
+		if ((st->tmc & 0x07) == 0x07)
+			rds[RDS_B] |= 0x10 | 0x04;
+		else {
+			rds[RDS_B] |= 0x08 | (st->tmc & 0x07);
+			rds[RDS_C] = 0x8000 | ((st->tmc & 1) << 14) | (1 << 11) | (101 + st->tmc % 50);
+			rds[RDS_D] = st->tmc_loc + (st->tmc & 0x0F);
+		}
+		st->tmc++;
+		break;
+	case 20: // 10A: program type name
+		rds[RDS_B] |= st->ptyn_ci;
+		rds[RDS_C] = (st->ptyn[st->ptyn_ci*4] << 8) | (uint8_t)st->ptyn[st->ptyn_ci*4 + 1];
+		rds[RDS_D] = (st->ptyn[st->ptyn_ci*4 + 2] << 8) | (uint8_t)st->ptyn[st->ptyn_ci*4 + 3];
+		st->ptyn_ci ^= 1;
+		break;
+	case 28: { // 14A: enhanced other networks
+		static const uint8_t var[] = { 0, 1, 2, 3, 4, 13 };
+		uint8_t v = var[st->eon_var++ % sizeof(var)];
+		rds[RDS_B] = (rds[RDS_B] & ~0x1F) | 0x10 | v;
+		if (v < 4)
+			rds[RDS_C] = (st->eon_ps[v*2] << 8) | (uint8_t)st->eon_ps[v*2 + 1];
+		else if (v == 4)
+			rds[RDS_C] = (gen_af(st->freq) << 8) | st->eon_af;
+		else
+			rds[RDS_C] = RDS_PTY(st->pty) << 6; // per spec, see rdsgen.h
+		rds[RDS_D] = st->eon_pi;
+		break;
+	}
+	default: // no encoder, random payload
+		rds[RDS_B] |= gen_rand(&st->rnd) & 0x1F;
+		break;
+	}
+}
+
+void gen_err_init(gen_err_t *err, uint32_t seed, uint32_t rate, uint32_t burst)
+{
+	memset(err, 0, sizeof(gen_err_t));
+	err->rnd = seed ? seed : 1;
+	if (rate > 1000)
+		rate = 1000;
+	if (burst == 0) {
+		err->p_err = rate*65536/1000;
+		return;
+	}
+
+	// 10% of errors outside of bursts, every second block damaged in a burst
+	double r = rate/1000.0, g = r/10, b = 0.5;
+	if (r > b)
+		b = r;
+	double f = (b > g) ? (r - g)/(b - g) : 1;
+	double leave = 1.0/burst;
+	double enter = (f < 1) ? f*leave/(1 - f) : 1;
+	err->p_err   = g*65536;
+	err->p_burst = b*65536;
+	err->p_enter = (enter > 1 ? 1 : enter)*65536;
+	err->p_leave = leave*65536;
+}
+
+uint8_t gen_errors(gen_err_t *err, uint16_t *rds)
+{
+	uint8_t bler = 0;
+
+	if (err->burst)
+		err->burst = (gen_rand(&err->rnd) & 0xFFFF) >= err->p_leave;
+	else
+		err->burst = (gen_rand(&err->rnd) & 0xFFFF) < err->p_enter;
+
+	uint32_t p = err->burst ? err->p_burst : err->p_err;
+	for(int i = 0; i < 4; i++) {
+		uint32_t x = gen_rand(&err->rnd);
+		if ((x & 0xFFFF) >= p)
+			continue;
+		// 1: 1-2 errors corrected, 2: 3-5 errors corrected, 3: uncorrectable
+		uint8_t code = 1 + (x >> 16) % 3;
+		if (code == 3)
+			rds[i] ^= (x >> 8) | 1;
+		bler |= code << (6 - i*2);
+	}
+	return bler;
+}
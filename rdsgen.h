@@ -0,0 +1,117 @@
+/*	Synthetic RDS groups generator
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	Encoder builds groups the way RDS standard lays them out, so they feed
+	rds_parse_gt* decoders. It is not an exact inverse: rds_parse_gt14a
+	keeps block C byte swapped for info, PTY and PIN, so 14A variant 13
+	PTY sent here as PTY << 6 is not what the decoder prints back.
+	Every station sends groups from its schedule in a loop, clock-time 4A is inserted at the
+	start of every minute. Group types without encoder (6A, 7A, 9A, ...)
+	carry PI, group type, PTY and pseudo-random payload, so decoders can
+	be exercised on groups they do not know.
+*/
+
+#ifndef __RDS_GEN_H__
+#define __RDS_GEN_H__
+
+#include "rds.h"
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+#define GEN_MAX_RT    4
+#define GEN_MAX_SCHED 32
+
+typedef struct gen_station_s
+{
+	uint16_t pi;
+	uint16_t freq;     // 9500 for 95.00 MHz
+	uint8_t  pty;
+	uint8_t  tp;
+	uint8_t  ta;
+	int8_t   tz;       // local time offset in half hours
+	char     ps[9];
+	char     ptyn[9];
+	char     rt[GEN_MAX_RT][65];
+	uint8_t  nrt;
+	uint32_t rt_groups; // groups between Radiotext changes
+	uint8_t  af[25];    // alternative frequencies, RDS codes
+	uint8_t  naf;
+	uint16_t eon_pi;    // other network, 0 - none
+	char     eon_ps[9];
+	uint8_t  eon_af;
+	uint16_t tmc_loc;   // TMC location code
+	uint16_t sched[GEN_MAX_SCHED]; // group types as RDS_GT()
+	uint8_t  nsched;
+
+	// encoder state
+	uint32_t ngroups;
+	uint32_t rnd;
+	uint8_t  pos;
+	uint8_t  ps_ci;
+	uint8_t  af_idx;
+	uint8_t  rt_idx;
+	uint8_t  rt_si;
+	uint8_t  rt_ab;
+	uint32_t rt_start; // group the current Radiotext started at
+	uint8_t  ptyn_ci;
+	uint8_t  eon_var;
+	uint8_t  tdc;
+	uint8_t  tmc;
+	uint32_t ct_min;   // last minute clock-time was sent at
+} gen_station_t;
+
+// frequency of i-th generated station, 88.10 MHz and every 3.2 MHz up,
+// wrapped to stay inside 87.50-108.00 MHz, unique for up to 103 stations
+uint16_t gen_station_freq(uint32_t i);
+// initializes station with default PS, Radiotexts, AF list and schedule
+void gen_station_init(gen_station_t *st, uint16_t pi, uint16_t freq);
+// sets schedule as comma separated list of group types like 0A,2A,0B
+int  gen_set_sched(gen_station_t *st, const char *sched);
+// encodes next group sent at time 't', seconds since the Epoch
+void gen_group(gen_station_t *st, uint32_t t, uint16_t *rds);
+
+/*
+	Two state (Gilbert-Elliott) block error model: in every state a block
+	has its own error probability, bursts start and end with given
+	probabilities. Errors are reported as Si4703 BLER codes, blocks with
+	code 3 (uncorrectable) get random bits flipped.
+*/
+typedef struct gen_err_s
+{
+	uint32_t p_err;   // block error probability in good state, 1/65536 units
+	uint32_t p_burst; // error probability in a burst
+	uint32_t p_enter; // probability to start a burst, per group
+	uint32_t p_leave; // probability to leave a burst, per group
+	uint8_t  burst;
+	uint32_t rnd;
+} gen_err_t;
+
+// rate - block errors per 1000 blocks, burst - mean burst length in groups
+void gen_err_init(gen_err_t *err, uint32_t seed, uint32_t rate, uint32_t burst);
+// damages group, returns BLER as si_get_bler()
+uint8_t gen_errors(gen_err_t *err, uint16_t *rds);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,480 @@
+/*	RDS groups decoder and printer for Si4703 based RDS scanner
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <string.h>
+
+#include "rds.h"
+#include "rdsmon.h"
+#include "wbuf.h"
+
+#ifndef _BM
+#define _BM(bit) (1 << ((uint16_t)bit)) // convert bit number to bit mask
+#endif
+
+// VT100 ESC codes for monitor mode
+static const char clr_all[] = { 27, '[', '2', 'J', '\0' };  // clear screen
+static const char clr_eol[] = { 27, '[', '0', 'K', '\0' };  // clear to EOL
+static const char go_top[]  = { 27, '[', '1', ';', '1', 'H','\0' }; // go top left
+static const char cur_vis[] = { 27, '[', '?', '2', '5', 'h','\0' }; // show cursor
+static const char cur_hid[] = { 27, '[', '?', '2', '5', 'l','\0' }; // hide cursor
+static const char txt_nor[] = { 27, '[', '0', 'm', '\0' }; // normal text
+static const char txt_rev[] = { 27, '[', '7', 'm', '\0' }; // reverse text
+
+static void print_rds_hdr(wbuf_t *wb, rds_hdr_t *phdr)
+{
+	for(int i = 0; i < 4; i++) {
+		wbuf_hex(wb, phdr->rds[i], 4);
+		wbuf_putc(wb, ' ');
+	}
+	wbuf_puts(wb, "| GT ");
+	wbuf_putc(wb, '0' + phdr->gt/10);
+	wbuf_putc(wb, '0' + phdr->gt%10);
+	wbuf_putc(wb, 'A' + phdr->ver);
+	wbuf_puts(wb, " PTY ");
+	wbuf_uint(wb, phdr->pty, 2);
+	wbuf_puts(wb, " TP ");
+	wbuf_putc(wb, '0' + phdr->tp);
+	wbuf_puts(wb, " | ");
+}
+
+static void print_eol(wbuf_t *wb, int log)
+{
+	if (!log)
+		wbuf_puts(wb, clr_eol);
+	wbuf_putc(wb, '\n');
+}
+
+/* default printer for 'rds log' command */
+static void print_rds(wbuf_t *wb, rds_hdr_t *phdr, int log)
+{
+	print_rds_hdr(wb, phdr);
+	wbuf_hex(wb, phdr->rds[1] & 0x1F, 2);
+	wbuf_putc(wb, ' ');
+	wbuf_hex(wb, phdr->rds[2], 4);
+	wbuf_putc(wb, ' ');
+	wbuf_hex(wb, phdr->rds[3], 4);
+	print_eol(wb, log);
+}
+
+void rds_mon_init(rds_mon_t *mon, uint16_t pr_mask, int log)
+{
+	memset(mon, 0, sizeof(rds_mon_t));
+	mon->pr_mask = pr_mask;
+	mon->log = log;
+}
+
+void rds_mon_start(int fd, rds_mon_t *mon)
+{
+	if (!mon->log) {
+		dprintf(fd, "%s%s%s", clr_all, go_top, cur_hid);
+		dprintf(fd, "monitoring RDS, press any key to terminate...%s%s\n", clr_eol, txt_nor);
+	}
+}
+
+int rds_mon_complete(rds_mon_t *mon)
+{
+	return (mon->rt_mask == 0xFFFF) && (mon->ps_mask == 0x0F);
+}
+
+static void rds_mon_text(rds_mon_t *mon, uint16_t pi, uint8_t kind, const char *text, int len)
+{
+	char buf[65];
+	// drop padding
+	while(len > 0 && text[len - 1] == ' ')
+		len--;
+	if (len <= 0)
+		return;
+	memcpy(buf, text, len);
+	buf[len] = '\0';
+	mon->on_text(mon->data, pi, kind, buf);
+}
+
+void rds_mon_group(int fd, rds_mon_t *mon, const uint16_t *prds)
+{
+	int log = mon->log;
+	int raw = log || mon->scr; // no VT100 codes
+	rds_hdr_t hdr;
+	wbuf_t wb; // whole group is written at once
+	uint16_t gtv = RDS_GET_GT(prds[RDS_B]);
+	uint8_t  ver = (prds[RDS_B] >> 11) & 0x01;
+	uint8_t  gt  = (prds[RDS_B] >> 12) & 0x0F;
+	hdr.gt  = gt;
+	hdr.ver = ver;
+	hdr.tp  = (prds[RDS_B] >> 10) & 0x01;
+	hdr.pty = (prds[RDS_B] >> 5) & 0x1F;
+	memcpy(hdr.rds, prds, sizeof(hdr.rds));
+	memcpy(&mon->rds[gt], &hdr, sizeof(hdr));
+
+	mon->ngroups++;
+	mon->gt_mask |= _BM(gt);
+	if (!ver)
+		mon->gta_mask |= _BM(gt);
+	else
+		mon->gtb_mask |= _BM(gt);
+
+	// screen frame or record must fit the buffer, it is never written to fd
+	wbuf_init(&wb, (mon->scr || mon->sinks) ? -1 : fd);
+	if (!log) {
+		if (!raw) {
+			wbuf_puts(&wb, go_top);
+			wbuf_puts(&wb, txt_rev);
+		}
+		print_rds_hdr(&wb, &hdr);
+		wbuf_puts(&wb, "monitoring RDS, press any key to terminate...");
+		if (!raw) {
+			wbuf_puts(&wb, clr_eol);
+			wbuf_puts(&wb, txt_nor);
+		}
+		wbuf_putc(&wb, '\n');
+	}
+
+	// 0A: basic tuning and switching information
+	if (gtv == RDS_GT_00A) {
+		memcpy(&mon->rd0.hdr, &hdr, sizeof(hdr));
+		rds_parse_gt00a(prds, &mon->rd0);
+		// completion is tracked whether the group is printed or not
+		mon->ps_mask = mon->rd0.valid;
+		mon->ps_seg |= _BM(mon->rd0.ci);
+		if (mon->on_text && mon->ps_seg == 0x0F) {
+			rds_mon_text(mon, prds[RDS_A], RDS_TEXT_PS, mon->rd0.ps, 8);
+			mon->ps_seg = 0;
+		}
+	}
+	// 1A: Program Item Number and slow labeling codes
+	if (gtv == RDS_GT_01A) {
+		memcpy(&mon->rd1.hdr, &hdr, sizeof(hdr));
+		rds_parse_gt01a(prds, &mon->rd1);
+	}
+	// 2A: Radiotext
+	if (gtv == RDS_GT_02A) {
+		memcpy(&mon->rd2.hdr, &hdr, sizeof(hdr));
+		rds_parse_gt02a(prds, &mon->rd2);
+		mon->rt_mask = mon->rd2.valid;
+		if (rds_rt_add(prds, &mon->rt)) {
+			// short text ends at terminator, never fills all segments
+			mon->rt_mask = 0xFFFF;
+			if (mon->on_text)
+				rds_mon_text(mon, prds[RDS_A], RDS_TEXT_RT, mon->rt.text, strlen(mon->rt.text));
+		}
+	}
+	// 3A: AID for ODA
+	if (gtv == RDS_GT_03A) {
+		memcpy(&mon->rd3.hdr, &hdr, sizeof(hdr));
+		rds_parse_gt03a(prds, &mon->rd3);
+	}
+	// 4A: Clock-time and date
+	if (gtv == RDS_GT_04A) {
+		memcpy(&mon->rd4.hdr, &hdr, sizeof(hdr));
+		rds_parse_gt04a(prds, &mon->rd4);
+	}
+	// 5A: Transparent data channels or ODA
+	if (gtv == RDS_GT_05A) {
+		memcpy(&mon->rd5.hdr, &hdr, sizeof(hdr));
+		rds_parse_gt05a(prds, &mon->rd5);
+	}
+	// 8A: Traffic Message Channel
+	if (gtv == RDS_GT_08A) {
+		memcpy(&mon->rd8.hdr, &hdr, sizeof(hdr));
+		rds_parse_gt08a(prds, &mon->rd8);
+	}
+	// 10A: Program Type Name
+	if (gtv == RDS_GT_10A) {
+		if (mon->rd10.ab != !!(prds[RDS_B] & RDS_AB))
+			mon->ptyn_seg = 0;
+		memcpy(&mon->rd10.hdr, &hdr, sizeof(hdr));
+		rds_parse_gt10a(prds, &mon->rd10);
+		mon->ptyn_seg |= _BM(mon->rd10.ci);
+		if (mon->on_text && mon->ptyn_seg == 0x03) {
+			rds_mon_text(mon, prds[RDS_A], RDS_TEXT_PTYN, mon->rd10.ps, 8);
+			mon->ptyn_seg = 0;
+		}
+	}
+	// 14A: Enhanced Other Networks information
+	if (gtv == RDS_GT_14A) {
+		memcpy(&mon->rd14.hdr, &hdr, sizeof(hdr));
+		rds_parse_gt14a(prds, &mon->rd14);
+	}
+
+	uint16_t mask = mon->pr_mask & mon->gta_mask;
+	if (log)
+		mask = mon->pr_mask & _BM(gt);
+
+	if (mask & _BM(0)) {
+		rds_gt00a_t *rd0 = &mon->rd0;
+		print_rds_hdr(&wb, &rd0->hdr);
+		wbuf_printf(&wb, "TA %d MS %c DI %X Ci %d PS '%s' AF %d %d (%d): ",
+			rd0->ta, rd0->ms, rd0->di, rd0->ci, rd0->ps, prds[RDS_C] >> 8, prds[RDS_C] & 0xFF, rd0->naf);
+		for(int i = 0; rd0->af[i]; i++)
+			wbuf_printf(&wb, "%d ", 8750 + rd0->af[i]*10);
+		print_eol(&wb, raw);
+	}
+
+	if (mask & _BM(1)) {
+		rds_gt01a_t *rd1 = &mon->rd1;
+		print_rds_hdr(&wb, &rd1->hdr);
+		wbuf_printf(&wb, "RPC %d LA %d VC %d SLC %03X ",
+			rd1->rpc, rd1->la, rd1->vc, rd1->slc);
+		if (rd1->pinc)
+			wbuf_printf(&wb, " %02d %02d:%02d", rd1->pinc >> 11,
+			(rd1->pinc >> 6) & 0x1F, rd1->pinc & 0x3F);
+		print_eol(&wb, raw);
+	}
+
+	if (mask & _BM(2)) {
+		rds_gt02a_t *rd2 = &mon->rd2;
+		print_rds_hdr(&wb, &rd2->hdr);
+		wbuf_printf(&wb, "AB %c Si %2d ", 'A' + rd2->ab, rd2->si);
+		wbuf_printf(&wb, "RT '%s'", rd2->rt);
+		print_eol(&wb, raw);
+	}
+
+	if (mask & _BM(3)) {
+		rds_gt03a_t *rd3 = &mon->rd3;
+		print_rds_hdr(&wb, &rd3->hdr);
+		wbuf_printf(&wb, "AGTC %d%c Msg %04X AID %04X VC %d ",
+			rd3->agtc, rd3->ver + 'A', rd3->msg, rd3->aid, rd3->vc);
+		if (rd3->vc == 0) {
+			wbuf_printf(&wb, "LTN %d ", rd3->ltn);
+			if (rd3->afi) wbuf_printf(&wb, "AFI ");
+			if (rd3->m)	  wbuf_printf(&wb, "M ");
+			if (rd3->i)	  wbuf_printf(&wb, "I ");
+			if (rd3->n)	  wbuf_printf(&wb, "N ");
+			if (rd3->r)	  wbuf_printf(&wb, "R ");
+			if (rd3->u)	  wbuf_printf(&wb, "U ");
+		}
+		else {
+			wbuf_printf(&wb, "SID %d ", rd3->sid);
+			if (rd3->m)
+				wbuf_printf(&wb, "G %d Ta %d Tw %d Td %d", rd3->g, rd3->ta, rd3->tw, rd3->td);
+		}
+		print_eol(&wb, raw);
+	}
+
+	if (mask & _BM(4)) {
+		rds_gt04a_t *rd4 = &mon->rd4;
+		print_rds_hdr(&wb, &rd4->hdr);
+		wbuf_printf(&wb, "%d/%02d/%02d %02d:%02d",
+			rd4->year, rd4->month, rd4->day, rd4->hour, rd4->minute);
+		if (rd4->tz_hour == 0 && rd4->tz_half == 0)
+			wbuf_printf(&wb, " UTC");
+		else
+			wbuf_printf(&wb, " TZ%c%d.%d", rd4->ts_sign ? '-' : '+',
+			rd4->tz_hour, rd4->tz_half);
+		print_eol(&wb, raw);
+	}
+
+	if (mask & _BM(5)) {
+		rds_gt05a_t *rd5 = &mon->rd5;
+		print_rds_hdr(&wb, &rd5->hdr);
+		for (uint8_t i = 0; i < 32; i++) {
+			if (rd5->channel & (1u << i))
+				wbuf_printf(&wb, "TDS[%u] %04X %04X ",
+					i, rd5->tds[i][0], rd5->tds[i][1]);
+		}
+		print_eol(&wb, raw);
+	}
+
+	if (mask & _BM(6))
+		print_rds(&wb, &mon->rds[6], raw);
+
+	if (mask & _BM(7))
+		print_rds(&wb, &mon->rds[7], raw);
+
+	if (mask & _BM(8)) {
+		rds_gt03a_t *rd3 = &mon->rd3;
+		rds_gt08a_t *rd8 = &mon->rd8;
+		// check if 8A is Alert-C
+		print_rds_hdr(&wb, &rd8->hdr);
+		if (rd3->agtc == 8 && rd3->ver == 0 && rd3->aid == 0xCD46) {
+			wbuf_printf(&wb, "S%d G%d CI%d ", rd8->x4, rd8->x3, rd8->x2);
+			if (rd8->x3)
+				wbuf_printf(&wb, "D%d DIR%d Ext %d Eve %d Loc %04X",
+				rd8->d, rd8->dir, rd8->ext, rd8->eve, rd8->loc);
+			else
+				wbuf_printf(&wb, "Y %04X Loc %04X", rd8->y, rd8->loc);
+		}
+		else
+			wbuf_printf(&wb, "X4 %d VC %d", rd8->x4, rd8->vc);
+		print_eol(&wb, raw);
+	}
+
+	if (mask & _BM(9))
+		print_rds(&wb, &mon->rds[9], raw);
+
+	if (mask & _BM(10)) {
+		rds_gt10a_t *rd10 = &mon->rd10;
+		print_rds_hdr(&wb, &rd10->hdr);
+		wbuf_printf(&wb, "AB %c Ci %d PTYN '%s'", 'A' + rd10->ab, rd10->ci, rd10->ps);
+		print_eol(&wb, raw);
+	}
+
+	if (mask & _BM(11))
+		print_rds(&wb, &mon->rds[11], raw);
+
+	if (mask & _BM(12))
+		print_rds(&wb, &mon->rds[12], raw);
+
+	if (mask & _BM(13))
+		print_rds(&wb, &mon->rds[13], raw);
+
+	if (mask & _BM(14)) {
+		rds_gt14a_t *rd14 = &mon->rd14;
+		print_rds_hdr(&wb, &rd14->hdr);
+		wbuf_printf(&wb, "TP %d VC %2d ", rd14->tp_on, rd14->variant);
+		wbuf_printf(&wb, "I %04X ", rd14->info);
+		wbuf_printf(&wb, "PI %04X ", rd14->pi_on);
+		wbuf_printf(&wb, "PS '%s' ", rd14->ps);
+		if (rd14->avc & _BM(13))
+			wbuf_printf(&wb, "PTY %2d TA %d ", rd14->pty >> 11, rd14->pty & 0x01);
+		if (rd14->avc & _BM(14))
+			wbuf_printf(&wb, "PIN %04X", rd14->pin);
+		print_eol(&wb, raw);
+	}
+
+	if (mask & _BM(15))
+		print_rds(&wb, &mon->rds[15], raw);
+	if (mon->scr)
+		scr_frame(mon->scr, wb.buf, wb.len);
+	else if (mon->sinks) {
+		if (wb.len)
+			sinks_write(mon->sinks, wb.buf, wb.len);
+	}
+	else
+		wbuf_flush(&wb);
+}
+
+void rds_mon_summary(int fd, rds_mon_t *mon, int freq, uint32_t ms)
+{
+	dprintf(fd, "\nScanned %d.%02d ", freq/100, freq%100);
+	if (mon->rd0.valid == 0x0F)
+		dprintf(fd, "'%s' ", mon->rd0.ps);
+	dprintf(fd, "for %d ms\n", ms);
+	if (mon->rd2.valid)
+		dprintf(fd, "Radiotext: '%s'\n", mon->rd2.rt);
+	if (!mon->gt_mask)
+		dprintf(fd, "no RDS detected\n");
+	else {
+		dprintf(fd, "Active groups %04X:\n", mon->gt_mask);
+		for(int i = 0; i < 16; i++) {
+			if (mon->gta_mask & (1 << i))
+				dprintf(fd, "    %02dA %s\n", i, rds_gt_name(i, 0));
+			if (mon->gtb_mask & (1 << i))
+				dprintf(fd, "    %02dB %s \n", i, rds_gt_name(i, 1));
+		}
+		dprintf(fd, "\n");
+	}
+	if (!mon->log)
+		dprintf(fd, "%s", cur_vis);
+}
+
+void rds_mon_json(jw_t *jw, rds_mon_t *mon, const uint16_t *prds)
+{
+	uint8_t ver = (prds[RDS_B] >> 11) & 0x01;
+	uint8_t gt  = (prds[RDS_B] >> 12) & 0x0F;
+	char group[4] = { (char)('0' + gt/10), (char)('0' + gt%10), (char)('A' + ver), '\0' };
+
+	jw_hex(jw, "pi", prds[RDS_A], 4);
+	jw_str(jw, "group", gt < 10 ? group + 1 : group);
+	jw_uint(jw, "tp", (prds[RDS_B] >> 10) & 0x01);
+	jw_uint(jw, "pty", (prds[RDS_B] >> 5) & 0x1F);
+	jw_arr(jw, "blocks");
+	for(int i = 0; i < 4; i++)
+		jw_hex(jw, NULL, prds[i], 4);
+	jw_arr_end(jw);
+
+	// only A versions are decoded by rds_mon_group()
+	if (ver)
+		return;
+	if (gt == 0) {
+		rds_gt00a_t *rd0 = &mon->rd0;
+		jw_uint(jw, "ta", rd0->ta);
+		jw_strn(jw, "ms", (const char *)&rd0->ms, 1);
+		jw_uint(jw, "di", rd0->di);
+		jw_uint(jw, "ci", rd0->ci);
+		jw_str(jw, "ps", rd0->ps);
+		jw_bool(jw, "ps_valid", rd0->valid == 0x0F);
+		jw_arr(jw, "af");
+		for(int i = 0; i < 25 && rd0->af[i]; i++)
+			jw_uint(jw, NULL, 87500 + rd0->af[i]*100);
+		jw_arr_end(jw);
+	}
+	if (gt == 1) {
+		rds_gt01a_t *rd1 = &mon->rd1;
+		jw_uint(jw, "la", rd1->la);
+		jw_uint(jw, "vc", rd1->vc);
+		jw_hex(jw, "slc", rd1->slc, 3);
+		if (rd1->pinc)
+			jw_hex(jw, "pin", rd1->pinc, 4);
+	}
+	if (gt == 2) {
+		rds_gt02a_t *rd2 = &mon->rd2;
+		jw_str(jw, "ab", rd2->ab ? "B" : "A");
+		jw_uint(jw, "seg", rd2->si);
+		jw_str(jw, "rt", rd2->rt);
+		jw_bool(jw, "rt_valid", rd2->valid == 0xFFFF);
+	}
+	if (gt == 3) {
+		rds_gt03a_t *rd3 = &mon->rd3;
+		jw_uint(jw, "agtc", rd3->agtc);
+		jw_str(jw, "agtv", rd3->ver ? "B" : "A");
+		jw_hex(jw, "aid", rd3->aid, 4);
+		jw_hex(jw, "msg", rd3->msg, 4);
+	}
+	if (gt == 4) {
+		rds_gt04a_t *rd4 = &mon->rd4;
+		int tz = (rd4->tz_hour*60 + (rd4->tz_half ? 30 : 0))*(rd4->ts_sign ? -1 : 1);
+		jw_uint(jw, "year", rd4->year);
+		jw_uint(jw, "month", rd4->month);
+		jw_uint(jw, "day", rd4->day);
+		jw_uint(jw, "hour", rd4->hour);
+		jw_uint(jw, "minute", rd4->minute);
+		jw_int(jw, "tz_min", tz);
+	}
+	if (gt == 10) {
+		rds_gt10a_t *rd10 = &mon->rd10;
+		jw_str(jw, "ab", rd10->ab ? "B" : "A");
+		jw_uint(jw, "seg", rd10->ci);
+		jw_str(jw, "ptyn", rd10->ps);
+	}
+	if (gt == 14) {
+		rds_gt14a_t *rd14 = &mon->rd14;
+		jw_hex(jw, "on_pi", rd14->pi_on, 4);
+		jw_uint(jw, "on_tp", rd14->tp_on);
+		jw_uint(jw, "variant", rd14->variant);
+		jw_hex(jw, "info", rd14->info, 4);
+		jw_str(jw, "on_ps", rd14->ps);
+	}
+}
+
+void rds_mon_json_summary(jw_t *jw, rds_mon_t *mon)
+{
+	jw_uint(jw, "groups", mon->ngroups);
+	if (mon->rd0.valid == 0x0F)
+		jw_str(jw, "ps", mon->rd0.ps);
+	if (mon->rd2.valid)
+		jw_str(jw, "rt", mon->rd2.rt);
+	jw_arr(jw, "groups_seen");
+	for(int i = 0; i < 16; i++) {
+		char group[4] = { (char)('0' + i/10), (char)('0' + i%10), 'A', '\0' };
+		if (mon->gta_mask & (1 << i))
+			jw_str(jw, NULL, i < 10 ? group + 1 : group);
+		group[2] = 'B';
+		if (mon->gtb_mask & (1 << i))
+			jw_str(jw, NULL, i < 10 ? group + 1 : group);
+	}
+	jw_arr_end(jw);
+}
@@ -0,0 +1,88 @@
+/*	RDS groups decoder and printer for Si4703 based RDS scanner
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __RDS_MONITOR_H__
+#define __RDS_MONITOR_H__
+
+#include "rds.h"
+#include "jsonw.h"
+#include "sinks.h"
+#include "vtscr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+// kinds of texts reported to rds_text_cb
+#define RDS_TEXT_PS   0
+#define RDS_TEXT_RT   1
+#define RDS_TEXT_PTYN 2
+
+// called when PS, Radiotext or PTYN is received completely
+typedef void (rds_text_cb)(void *data, uint16_t pi, uint8_t kind, const char *text);
+
+// decoders state shared by live 'rds' monitor and captures replay
+typedef struct rds_mon_s
+{
+	rds_gt00a_t rd0;
+	rds_gt01a_t rd1;
+	rds_gt02a_t rd2;
+	rds_gt03a_t rd3;
+	rds_gt04a_t rd4;
+	rds_gt05a_t rd5;
+	rds_gt08a_t rd8;
+	rds_gt10a_t rd10;
+	rds_gt14a_t rd14;
+	rds_hdr_t   rds[16];
+
+	int      log;      // scroll output instead of one-liners
+	uint16_t pr_mask;  // mask of groups to print
+	uint16_t gt_mask;  // mask of groups detected
+	uint16_t gta_mask; // mask of A groups detected
+	uint16_t gtb_mask; // mask of B groups detected
+	uint16_t rt_mask;  // mask of radiotext segments, 0xFFFF once text is complete
+	uint16_t ps_mask;  // mask of PS segments processed
+	uint32_t ngroups;  // number of groups decoded
+
+	rds_text_cb *on_text;
+	void    *data;     // on_text callback data
+	uint16_t ps_seg;   // text segments received since last on_text call
+	uint16_t ptyn_seg;
+	rds_rt_t rt;       // Radiotext for on_text and completion
+	scr_t   *scr;      // if set, screen frames are posted here instead of fd
+	sinks_t *sinks;    // if set, log lines are written here instead of fd
+} rds_mon_t;
+
+void rds_mon_init(rds_mon_t *mon, uint16_t pr_mask, int log);
+// prints screen header in one-liners mode
+void rds_mon_start(int fd, rds_mon_t *mon);
+// decodes and prints RDS group
+void rds_mon_group(int fd, rds_mon_t *mon, const uint16_t *prds);
+// both PS and full Radiotext received, printed or not
+int  rds_mon_complete(rds_mon_t *mon);
+void rds_mon_summary(int fd, rds_mon_t *mon, int freq, uint32_t ms);
+// adds fields of the group just decoded by rds_mon_group() to '--json' record
+void rds_mon_json(jw_t *jw, rds_mon_t *mon, const uint16_t *prds);
+void rds_mon_json_summary(jw_t *jw, rds_mon_t *mon);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,168 @@
+/*	Queries over RDS capture archives
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <time.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rdscap.h"
+#include "rdsmon.h"
+#include "rdsqry.h"
+
+void qry_init(qry_t *qry)
+{
+	memset(qry, 0, sizeof(qry_t));
+	qry->pi  = -1;
+	qry->pty = -1;
+	qry->ta  = -1;
+	qry->tp  = -1;
+}
+
+// returns 1 if capture cannot contain matching groups
+static int qry_skip(const qry_t *qry, const cap_sum_t *sum)
+{
+	if (qry->from && sum->t_max < qry->from)
+		return 1;
+	if (qry->to && sum->t_min > qry->to)
+		return 1;
+	if (qry->freq) {
+		uint16_t ch = CAP_SUM_FREQ(qry->freq);
+		if (ch >= sizeof(sum->freq)*8 || !CAP_SUM_BIT(sum->freq, ch))
+			return 1;
+	}
+	if (qry->pi >= 0 && !CAP_SUM_BIT(sum->pi, qry->pi))
+		return 1;
+	if (qry->gt_mask && !(sum->gt_mask & qry->gt_mask))
+		return 1;
+	if (qry->pty >= 0 && !(sum->pty_mask & (1u << qry->pty)))
+		return 1;
+	if (qry->ta >= 0 && !(sum->flags & (qry->ta ? CAP_SUM_TA1 : CAP_SUM_TA0)))
+		return 1;
+	if (qry->tp >= 0 && !(sum->flags & (qry->tp ? CAP_SUM_TP1 : CAP_SUM_TP0)))
+		return 1;
+	return 0;
+}
+
+static int qry_match(const qry_t *qry, const cap_map_t *map, uint32_t idx)
+{
+	const cap_rec_t *rec = cap_map_rec(map, idx);
+	if (CAP_IS_SYNC(rec) || CAP_IS_BAD(rec))
+		return 0;
+	uint32_t t = CAP_REC_TIME(map, idx);
+	if (qry->from && t < qry->from)
+		return 0;
+	if (qry->to && t > qry->to)
+		return 0;
+	if (qry->freq && rec->freq != qry->freq)
+		return 0;
+
+	uint16_t b = rec->rds[1];
+	if (qry->pi >= 0 && rec->rds[0] != qry->pi)
+		return 0;
+	if (qry->gt_mask && !(qry->gt_mask & (1u << (b >> 11))))
+		return 0;
+	if (qry->pty >= 0 && ((b >> 5) & 0x1F) != qry->pty)
+		return 0;
+	if (qry->ta >= 0 && (!CAP_HAS_TA(b) || !!(b & 0x0010) != qry->ta))
+		return 0;
+	if (qry->tp >= 0 && !!(b & 0x0400) != qry->tp)
+		return 0;
+	return 1;
+}
+
+// decodes capture printing matching groups or only record 'only' if not negative,
+// groups are decoded from the last retune so printed state is complete
+static uint32_t qry_print(int fd, const qry_t *qry, const char *name, int64_t only)
+{
+	cap_map_t cap;
+	rds_mon_t mon;
+	uint32_t nmatch = 0;
+
+	if (cap_map(&cap, name) != 0)
+		return 0;
+
+	rds_mon_init(&mon, 0, 1);
+	for(uint32_t i = 0; i < cap.nrec; i++) {
+		const cap_rec_t *rec = cap_map_rec(&cap, i);
+		if (rec->type == CAP_TUNE)
+			rds_mon_init(&mon, 0, 1);
+		if (CAP_IS_SYNC(rec) || CAP_IS_BAD(rec))
+			continue;
+
+		int match = (only < 0) ? qry_match(qry, &cap, i) : (i == only);
+		mon.pr_mask = match ? 0xFFFF : 0;
+		if (match) {
+			char buf[32];
+			struct tm tm;
+			time_t t = CAP_REC_TIME(&cap, i);
+			strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", localtime_r(&t, &tm));
+			dprintf(fd, "%s %3d.%02d ", buf, rec->freq/100, rec->freq%100);
+			nmatch++;
+		}
+		rds_mon_group(fd, &mon, rec->rds);
+		if (i == only)
+			break;
+	}
+	cap_unmap(&cap);
+	return nmatch;
+}
+
+int qry_run(int fd, const qry_t *qry, char **files, int nfiles, qry_stat_t *stat)
+{
+	cap_sum_t sum;
+	int last_file = -1;
+	uint32_t last_rec = 0;
+	uint64_t last_time = 0;
+
+	memset(stat, 0, sizeof(qry_stat_t));
+	for(int f = 0; f < nfiles; f++) {
+		stat->nfiles++;
+		if (cap_sum_load(files[f], &sum) != 0) {
+			dprintf(fd, "Unable to read capture '%s'\n", files[f]);
+			continue;
+		}
+		if (qry_skip(qry, &sum)) {
+			stat->skipped++;
+			continue;
+		}
+
+		if (qry->mode == QRY_ALL) {
+			stat->matched += qry_print(fd, qry, files[f], -1);
+			continue;
+		}
+
+		// count or find the latest match without decoding
+		cap_map_t cap;
+		if (cap_map(&cap, files[f]) != 0)
+			continue;
+		for(uint32_t i = 0; i < cap.nrec; i++) {
+			if (!qry_match(qry, &cap, i))
+				continue;
+			stat->matched++;
+			uint64_t t = (uint64_t)cap.hdr->start*1000 + cap_map_ms(&cap, i);
+			if (last_file < 0 || t >= last_time) {
+				last_file = f;
+				last_rec  = i;
+				last_time = t;
+			}
+		}
+		cap_unmap(&cap);
+	}
+
+	if (qry->mode == QRY_LAST && last_file >= 0)
+		qry_print(fd, qry, files[last_file], last_rec);
+	return 0;
+}
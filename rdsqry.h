@@ -0,0 +1,62 @@
+/*	Queries over RDS capture archives
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __RDS_QUERY_H__
+#define __RDS_QUERY_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+// query output modes
+#define QRY_ALL   0 // print all matching groups
+#define QRY_LAST  1 // print the latest matching group only
+#define QRY_COUNT 2 // count matching groups
+
+typedef struct qry_s
+{
+	uint32_t from;    // time range, seconds since the Epoch
+	uint32_t to;
+	uint16_t freq;    // 0 - any frequency
+	int32_t  pi;      // -1 - any PI
+	uint32_t gt_mask; // group types, bit number is GT*2 + version, 0 - any
+	int8_t   pty;     // -1 - any PTY
+	int8_t   ta;      // -1 - any TA
+	int8_t   tp;      // -1 - any TP
+	int      mode;    // QRY_ALL, QRY_LAST, QRY_COUNT
+} qry_t;
+
+void qry_init(qry_t *qry);
+
+typedef struct qry_stat_s
+{
+	uint32_t nfiles;  // captures queried
+	uint32_t skipped; // captures skipped by summary
+	uint32_t matched; // matching groups
+} qry_stat_t;
+
+int qry_run(int fd, const qry_t *qry, char **files, int nfiles, qry_stat_t *stat);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,154 @@
+/*	RDS groups reception statistics
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <string.h>
+
+#include "rdsrx.h"
+
+#define RDS_RX_BAR 40 // width of the longest histogram bar
+
+#define RDS_PLL_BLIND_US  30000 // polling interval when not locked
+#define RDS_PLL_GUARD_US  1000  // read after expected arrival
+#define RDS_PLL_STEP_US   2000  // re-read interval for late groups
+#define RDS_PLL_WINDOW_US 8000  // group later than that is lost
+#define RDS_PLL_CREEP_US  50    // per group, covers 500 ppm of drift
+#define RDS_PLL_LOST      3     // lost groups in a row to unlock
+
+void rds_rx_init(rds_rx_t *rx)
+{
+	memset(rx, 0, sizeof(rds_rx_t));
+}
+
+int rds_rx_read(rds_rx_t *rx, uint64_t us, const uint16_t *rds)
+{
+	if (!rx->reads++)
+		rx->start = us;
+	rx->end = us;
+	if (rds == NULL)
+		return 0;
+
+	if (rx->groups) {
+		uint64_t gap = us - rx->last;
+		if (gap < RDS_GROUP_US/2 && memcmp(rds, rx->rds, sizeof(rx->rds)) == 0) {
+			rx->dups++;
+			return 1;
+		}
+		// read time jitter is less than half of the period
+		uint32_t periods = (gap + RDS_GROUP_US/2)/RDS_GROUP_US;
+		if (periods > 1)
+			rx->missed += periods - 1;
+		uint32_t bin = gap/(RDS_RX_BIN_MS*1000);
+		rx->hist[(bin < RDS_RX_BINS) ? bin : RDS_RX_BINS - 1]++;
+	}
+
+	rx->groups++;
+	rx->last = us;
+	memcpy(rx->rds, rds, sizeof(rx->rds));
+	return 0;
+}
+
+uint32_t rds_rx_expected(const rds_rx_t *rx)
+{
+	if (!rx->groups)
+		return 0;
+	return rx->groups + rx->missed;
+}
+
+void rds_rx_report(int fd, const rds_rx_t *rx, int hist)
+{
+	uint32_t expected = rds_rx_expected(rx);
+	uint32_t lost = expected ? rx->missed*1000ull/expected : 0;
+	uint32_t ms = (rx->end - rx->start)/1000;
+	uint32_t rate = ms ? rx->reads*10000ull/ms : 0;
+
+	dprintf(fd, "RDS reads %u (%u.%u/s), groups %u, duplicates %u, missed %u (%u.%u%%)\n",
+		rx->reads, rate/10, rate%10, rx->groups, rx->dups, rx->missed, lost/10, lost%10);
+	if (!hist || rx->groups < 2)
+		return;
+
+	uint32_t max = 0;
+	for(int i = 0; i < RDS_RX_BINS; i++) {
+		if (rx->hist[i] > max)
+			max = rx->hist[i];
+	}
+	dprintf(fd, "Gaps between groups, ms:\n");
+	for(int i = 0; i < RDS_RX_BINS; i++) {
+		if (!rx->hist[i])
+			continue;
+		char bar[RDS_RX_BAR + 1];
+		uint32_t len = rx->hist[i]*RDS_RX_BAR/max;
+		memset(bar, '#', len ? len : 1);
+		bar[len ? len : 1] = '\0';
+		if (i < RDS_RX_BINS - 1)
+			dprintf(fd, "%4d-%-4d %6u %s\n", i*RDS_RX_BIN_MS, (i + 1)*RDS_RX_BIN_MS - 1, rx->hist[i], bar);
+		else
+			dprintf(fd, "%4d+    %6u %s\n", i*RDS_RX_BIN_MS, rx->hist[i], bar);
+	}
+}
+
+void rds_pll_init(rds_pll_t *pll)
+{
+	memset(pll, 0, sizeof(rds_pll_t));
+}
+
+uint64_t rds_pll_read(rds_pll_t *pll, uint64_t us, int rdsr)
+{
+	uint64_t gap = us - pll->prev;
+	int first = !pll->prev;
+	int hit = pll->hit;
+
+	pll->prev = us;
+	pll->hit  = rdsr;
+
+	if (rdsr) {
+		uint64_t arrived;
+		if (!hit && !first && gap <= RDS_PLL_STEP_US*2)
+			arrived = us - gap/2; // re-read caught it
+		else if (pll->due)
+			arrived = (us < pll->due) ? us : pll->due;
+		else // as early as possible, re-reads will narrow it
+			arrived = us - ((first || gap > RDS_PLL_BLIND_US) ? RDS_PLL_BLIND_US : gap);
+
+		if (!pll->due)
+			pll->locks++;
+		pll->lost = 0;
+		pll->due  = arrived + RDS_GROUP_US - RDS_PLL_CREEP_US;
+		pll->win  = us - arrived + RDS_PLL_WINDOW_US;
+		return pll->due + RDS_PLL_GUARD_US;
+	}
+
+	if (!pll->due)
+		return us + RDS_PLL_BLIND_US;
+	if (us < pll->due + pll->win) {
+		pll->retries++;
+		return us + RDS_PLL_STEP_US;
+	}
+
+	// keep the phase, group could be dropped because of errors
+	if (++pll->lost >= RDS_PLL_LOST) {
+		pll->due = 0;
+		return us + RDS_PLL_BLIND_US;
+	}
+	pll->due += RDS_GROUP_US;
+	pll->win  = RDS_PLL_WINDOW_US;
+	return pll->due + RDS_PLL_GUARD_US;
+}
+
+void rds_pll_report(int fd, const rds_pll_t *pll)
+{
+	dprintf(fd, "RDS polling locked %u times, %u re-reads\n", pll->locks, pll->retries);
+}
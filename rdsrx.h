@@ -0,0 +1,91 @@
+/*	RDS groups reception statistics
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	RDS is sent at 1187.5 bit/s, so a 104 bits group arrives every 87.6 ms.
+	Polling RDSR can read the same latched group twice or skip a group.
+	Identical blocks read within half of group period, before the next
+	group can arrive even with polling jitter, are counted as duplicate.
+	Groups missed between two reads are inferred from the arrival gap
+	rounded to whole group periods.
+
+	Without RDS interrupt wired polling can still be phase-locked to group
+	arrivals: rds_pll_t schedules reads just after the expected RDSR
+	assertion, creeping a little earlier every group to follow clocks
+	drift. A read which finds no group is repeated every 2 ms for a short
+	window, narrowing the arrival time, after three lost groups in a row
+	polling falls back to blind reads until the next group is seen.
+*/
+
+#ifndef __RDS_RX_H__
+#define __RDS_RX_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+#define RDS_GROUP_US 87579 // 104 bits at 1187.5 bit/s
+#define RDS_RX_BIN_MS 10   // histogram bin width
+#define RDS_RX_BINS   32   // last bin counts all longer gaps
+
+typedef struct rds_rx_s
+{
+	uint64_t start;    // time of first read, us
+	uint64_t end;      // time of last read, us
+	uint64_t last;     // arrival time of last new group, us
+	uint16_t rds[4];   // last group blocks
+	uint32_t reads;    // number of RDSR polls
+	uint32_t groups;   // new groups read
+	uint32_t dups;     // same group read again
+	uint32_t missed;   // groups inferred lost between reads
+	uint32_t hist[RDS_RX_BINS]; // gaps between new groups
+} rds_rx_t;
+
+typedef struct rds_pll_s
+{
+	uint64_t prev;    // time of previous read
+	uint64_t due;     // expected arrival of next group, 0 - not locked
+	uint32_t win;     // how late the group can be before it is lost
+	uint8_t  hit;     // previous read found a group
+	uint8_t  lost;    // groups lost in a row
+	uint32_t locks;   // number of times lock was acquired
+	uint32_t retries; // reads repeated because group was late
+} rds_pll_t;
+
+void rds_rx_init(rds_rx_t *rx);
+// accounts RDSR poll at time 'us', 'rds' is NULL if RDSR was not set,
+// returns 1 if group is a duplicate of the previous one
+int  rds_rx_read(rds_rx_t *rx, uint64_t us, const uint16_t *rds);
+// groups sent since the first one received, read or missed
+uint32_t rds_rx_expected(const rds_rx_t *rx);
+// prints counters and histogram if 'hist' is set
+void rds_rx_report(int fd, const rds_rx_t *rx, int hist);
+
+void rds_pll_init(rds_pll_t *pll);
+// accounts read made at time 'us', returns time of the next read
+uint64_t rds_pll_read(rds_pll_t *pll, uint64_t us, int rdsr);
+void rds_pll_report(int fd, const rds_pll_t *pll);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,105 @@
+/*	Receiver state published in shared memory
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "rdsshm.h"
+
+#define RDS_SHM_VERSION 1
+#define RDS_SHM_RETRIES 1000000
+
+// first field copied by publish, the header before is owned by the block
+#define RDS_SHM_DATA offsetof(rds_state_t, updated)
+
+rds_state_t *rds_shm_create(void)
+{
+	int fd = shm_open(RDS_SHM_NAME, O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+		return NULL;
+	if (ftruncate(fd, sizeof(rds_state_t)) != 0) {
+		close(fd);
+		return NULL;
+	}
+	void *p = mmap(NULL, sizeof(rds_state_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+		return NULL;
+
+	rds_state_t *shm = (rds_state_t *)p;
+	// keep sequence of the previous writer, readers may be in the middle of a copy
+	uint32_t seq = __atomic_load_n(&shm->seq, __ATOMIC_RELAXED);
+	__atomic_store_n(&shm->seq, seq | 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memset((char *)shm + RDS_SHM_DATA, 0, sizeof(rds_state_t) - RDS_SHM_DATA);
+	shm->magic   = RDS_SHM_MAGIC;
+	shm->version = RDS_SHM_VERSION;
+	shm->size    = sizeof(rds_state_t);
+	shm->pid     = getpid();
+	__atomic_store_n(&shm->seq, (seq | 1) + 1, __ATOMIC_RELEASE);
+	return shm;
+}
+
+void rds_shm_publish(rds_state_t *shm, const rds_state_t *st)
+{
+	uint32_t seq = shm->seq;
+	__atomic_store_n(&shm->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy((char *)shm + RDS_SHM_DATA, (const char *)st + RDS_SHM_DATA, sizeof(rds_state_t) - RDS_SHM_DATA);
+	__atomic_store_n(&shm->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+const rds_state_t *rds_shm_open(void)
+{
+	int fd = shm_open(RDS_SHM_NAME, O_RDONLY, 0);
+	if (fd < 0)
+		return NULL;
+	void *p = mmap(NULL, sizeof(rds_state_t), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+		return NULL;
+	const rds_state_t *shm = (const rds_state_t *)p;
+	if (shm->magic != RDS_SHM_MAGIC || shm->version != RDS_SHM_VERSION) {
+		munmap(p, sizeof(rds_state_t));
+		return NULL;
+	}
+	return shm;
+}
+
+int rds_shm_read(const rds_state_t *shm, rds_state_t *snap)
+{
+	for(uint32_t i = 0; i < RDS_SHM_RETRIES; i++) {
+		uint32_t seq = __atomic_load_n(&shm->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1)
+			continue;
+		memcpy(snap, shm, sizeof(rds_state_t));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&shm->seq, __ATOMIC_RELAXED) == seq) {
+			snap->seq = seq;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+void rds_shm_close(const rds_state_t *shm)
+{
+	if (shm)
+		munmap((void *)shm, sizeof(rds_state_t));
+}
@@ -0,0 +1,79 @@
+/*	Receiver state published in shared memory
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	'rds ... shm' publishes current state in POSIX shared memory object
+	/rdspi (/dev/shm/rdspi) after every RDSR poll. Block is guarded by a
+	sequence lock: writer makes 'seq' odd while updating, readers copy
+	the block and retry if 'seq' was odd or changed meanwhile. Readers
+	need no syscalls and never delay the writer. Layout is fixed, new
+	fields are added at the end and increase 'size'.
+*/
+
+#ifndef __RDS_SHM_H__
+#define __RDS_SHM_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+#define RDS_SHM_NAME  "/rdspi"
+#define RDS_SHM_MAGIC 0x4D485352 // 'RSHM'
+
+typedef struct rds_state_s
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t size;     // of this structure
+	uint32_t seq;      // odd while being updated
+	uint32_t pid;      // of publishing process
+	uint64_t updated;  // ms since the Epoch
+	uint32_t ngroups;  // groups received on current frequency
+	uint16_t freq;     // 9500 for 95.00 MHz
+	uint8_t  rssi;
+	uint8_t  stereo;
+	uint8_t  sync;     // RDS synchronized
+	uint8_t  pty;
+	uint8_t  tp;
+	uint8_t  ta;
+	uint16_t pi;       // 0 - not received yet
+	uint16_t rt_valid; // mask of received Radiotext segments
+	uint8_t  ps_valid; // mask of received PS segments
+	uint8_t  rsv[3];
+	char     ps[12];
+	char     rt[68];
+} rds_state_t;
+
+// creates and maps state block for publishing, returns NULL on error
+rds_state_t *rds_shm_create(void);
+// copies 'st' into shared block, header fields of 'st' are ignored
+void rds_shm_publish(rds_state_t *shm, const rds_state_t *st);
+// maps existing block read-only, returns NULL if not published
+const rds_state_t *rds_shm_open(void);
+// takes consistent snapshot, returns -1 if writer holds the lock for too long
+int  rds_shm_read(const rds_state_t *shm, rds_state_t *snap);
+void rds_shm_close(const rds_state_t *shm);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,728 @@
+/*	Full-text index of recorded Radiotext, PS and PTYN
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <time.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "rdscap.h"
+#include "rdsmon.h"
+#include "rdstxt.h"
+
+#define TXT_TOK_MIN 2  // shorter words are not indexed
+#define TXT_TOK_MAX 32
+
+typedef struct txt_list_s
+{
+	uint32_t name;  // offset in names
+	uint32_t n;
+	uint32_t cap;
+	uint32_t *ids;
+} txt_list_t;
+
+// hash table of strings kept in a blob, entries are string ids + 1
+typedef struct txt_ht_s
+{
+	uint32_t *ids;
+	uint32_t size;  // power of 2
+	uint32_t n;
+} txt_ht_t;
+
+typedef struct txt_idx_s
+{
+	txt_hdr_t  hdr;
+	txt_msg_t *msg;
+	uint32_t   msg_cap;
+
+	char      *text;     // unique texts
+	uint32_t   text_cap;
+	uint32_t  *text_off; // offsets of unique texts
+	uint32_t   text_cap_off;
+	txt_ht_t   texts;
+
+	txt_list_t *tok;
+	uint32_t   tok_cap;
+	char      *names;
+	uint32_t   names_cap;
+	txt_ht_t   toks;
+
+	uint32_t  *last;     // last message per PI and kind, id + 1
+	int        unsorted; // message added out of time order
+
+	txt_file_t *file;
+	uint32_t   file_cap;
+	char      *fnames;
+	uint32_t   fnames_cap;
+
+	// currently decoded group
+	uint32_t   rec;
+	uint32_t   from;     // first record not indexed by previous updates
+	uint32_t   now;
+	uint16_t   freq;
+	uint32_t   added;
+} txt_idx_t;
+
+static const char *txt_kind[] = { "PS", "RT", "PTYN" };
+
+static int txt_grow(void *pbuf, uint32_t *cap, uint32_t need, size_t size)
+{
+	if (need <= *cap)
+		return 0;
+	uint32_t n = *cap ? *cap : 64;
+	while(n < need)
+		n *= 2;
+	void *p = realloc(*(void **)pbuf, n*size);
+	if (p == NULL)
+		return -1;
+	*(void **)pbuf = p;
+	*cap = n;
+	return 0;
+}
+
+static uint32_t txt_hash(const char *s)
+{
+	uint32_t h = 2166136261u; // FNV-1a
+	while(*s)
+		h = (h ^ (uint8_t)*s++)*16777619u;
+	return h;
+}
+
+static const char *txt_key(const txt_idx_t *idx, const txt_ht_t *ht, uint32_t id)
+{
+	if (ht == &idx->texts)
+		return idx->text + idx->text_off[id];
+	return idx->names + idx->tok[id].name;
+}
+
+// returns slot of the string or the empty slot where it should be inserted
+static uint32_t *txt_ht_find(const txt_idx_t *idx, const txt_ht_t *ht, const char *s, uint32_t h)
+{
+	uint32_t i = h & (ht->size - 1);
+	while(ht->ids[i] && strcmp(txt_key(idx, ht, ht->ids[i] - 1), s))
+		i = (i + 1) & (ht->size - 1);
+	return &ht->ids[i];
+}
+
+static int txt_ht_grow(txt_idx_t *idx, txt_ht_t *ht)
+{
+	if (ht->size && ht->n*2 < ht->size)
+		return 0;
+
+	txt_ht_t old = *ht;
+	ht->size = old.size ? old.size*2 : 1024;
+	ht->ids  = (uint32_t *)calloc(ht->size, sizeof(uint32_t));
+	if (ht->ids == NULL) {
+		*ht = old;
+		return -1;
+	}
+	for(uint32_t i = 0; i < old.size; i++) {
+		if (old.ids[i]) {
+			const char *key = txt_key(idx, ht, old.ids[i] - 1);
+			*txt_ht_find(idx, ht, key, txt_hash(key)) = old.ids[i];
+		}
+	}
+	free(old.ids);
+	return 0;
+}
+
+// returns offset of the text, identical texts are stored once
+static int64_t txt_add_text(txt_idx_t *idx, const char *s)
+{
+	if (txt_ht_grow(idx, &idx->texts) != 0)
+		return -1;
+	uint32_t *slot = txt_ht_find(idx, &idx->texts, s, txt_hash(s));
+	if (*slot)
+		return idx->text_off[*slot - 1];
+
+	uint32_t len = strlen(s) + 1;
+	uint32_t off = idx->hdr.text_size;
+	if (txt_grow(&idx->text, &idx->text_cap, off + len, 1) ||
+		txt_grow(&idx->text_off, &idx->text_cap_off, idx->texts.n + 1, sizeof(uint32_t)))
+		return -1;
+	memcpy(idx->text + off, s, len);
+	idx->hdr.text_size += len;
+	idx->text_off[idx->texts.n++] = off;
+	*slot = idx->texts.n;
+	return off;
+}
+
+static int txt_add_token(txt_idx_t *idx, const char *s, uint32_t id)
+{
+	if (txt_ht_grow(idx, &idx->toks) != 0)
+		return -1;
+	uint32_t *slot = txt_ht_find(idx, &idx->toks, s, txt_hash(s));
+	if (*slot == 0) {
+		uint32_t len = strlen(s) + 1;
+		if (txt_grow(&idx->names, &idx->names_cap, idx->hdr.names_size + len, 1) ||
+			txt_grow(&idx->tok, &idx->tok_cap, idx->hdr.ntok + 1, sizeof(txt_list_t)))
+			return -1;
+		txt_list_t *tok = &idx->tok[idx->hdr.ntok];
+		memset(tok, 0, sizeof(txt_list_t));
+		tok->name = idx->hdr.names_size;
+		memcpy(idx->names + tok->name, s, len);
+		idx->hdr.names_size += len;
+		*slot = ++idx->hdr.ntok;
+		idx->toks.n++;
+	}
+
+	txt_list_t *tok = &idx->tok[*slot - 1];
+	// word repeated in the same message
+	if (tok->n && tok->ids[tok->n - 1] == id)
+		return 0;
+	if (txt_grow(&tok->ids, &tok->cap, tok->n + 1, sizeof(uint32_t)))
+		return -1;
+	tok->ids[tok->n++] = id;
+	return 0;
+}
+
+// splits text to lower case words, returns pointer past the word or NULL
+static const char *txt_word(const char *s, char *word)
+{
+	while(*s && !isalnum((uint8_t)*s) && (uint8_t)*s < 0x80)
+		s++;
+	if (*s == '\0')
+		return NULL;
+	int len = 0;
+	for(; *s && (isalnum((uint8_t)*s) || (uint8_t)*s >= 0x80); s++) {
+		if (len < TXT_TOK_MAX - 1)
+			word[len++] = tolower((uint8_t)*s);
+	}
+	word[len] = '\0';
+	return s;
+}
+
+static int txt_tokenize(txt_idx_t *idx, uint32_t id)
+{
+	char word[TXT_TOK_MAX];
+	const char *s = idx->text + idx->msg[id].text;
+	while((s = txt_word(s, word)) != NULL) {
+		if (strlen(word) >= TXT_TOK_MIN && txt_add_token(idx, word, id) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+static int txt_add_msg(txt_idx_t *idx, const txt_msg_t *msg)
+{
+	uint32_t id = idx->hdr.nmsg;
+	if (txt_grow(&idx->msg, &idx->msg_cap, id + 1, sizeof(txt_msg_t)))
+		return -1;
+	idx->msg[id] = *msg;
+	if (id && msg->time < idx->msg[id - 1].time)
+		idx->unsorted = 1;
+	idx->hdr.nmsg++;
+	idx->last[msg->pi*4 + msg->kind] = id + 1;
+	return txt_tokenize(idx, id);
+}
+
+static void txt_on_text(void *data, uint16_t pi, uint8_t kind, const char *text)
+{
+	txt_idx_t *idx = (txt_idx_t *)data;
+	// already indexed by previous update
+	if (idx->rec < idx->from)
+		return;
+
+	int64_t off = txt_add_text(idx, text);
+	if (off < 0)
+		return;
+	uint32_t last = idx->last[pi*4 + kind];
+	if (last && idx->msg[last - 1].text == off)
+		return;
+
+	txt_msg_t msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.time = idx->now;
+	msg.pi   = pi;
+	msg.freq = idx->freq;
+	msg.kind = kind;
+	msg.len  = strlen(text);
+	msg.text = off;
+	if (txt_add_msg(idx, &msg) == 0)
+		idx->added++;
+}
+
+// maps index file, returns NULL if it does not exist or is not valid
+static const txt_hdr_t *txt_map(const char *name, size_t *psize)
+{
+	struct stat st;
+	int fd = open(name, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(txt_hdr_t)) {
+		close(fd);
+		return NULL;
+	}
+	void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+		return NULL;
+
+	const txt_hdr_t *hdr = (const txt_hdr_t *)p;
+	uint64_t size = sizeof(txt_hdr_t) + (uint64_t)hdr->nmsg*sizeof(txt_msg_t) +
+		(uint64_t)hdr->ntok*sizeof(txt_tok_t) + (uint64_t)hdr->nfile*sizeof(txt_file_t) +
+		hdr->names_size + hdr->post_size + hdr->text_size + hdr->fnames_size;
+	if (hdr->magic != TXT_MAGIC || hdr->version != TXT_VERSION || size != (uint64_t)st.st_size) {
+		munmap(p, st.st_size);
+		return NULL;
+	}
+	*psize = st.st_size;
+	return hdr;
+}
+
+#define TXT_MSG(hdr)   ((const txt_msg_t *)((hdr) + 1))
+#define TXT_TOK(hdr)   ((const txt_tok_t *)(TXT_MSG(hdr) + (hdr)->nmsg))
+#define TXT_FILE(hdr)  ((const txt_file_t *)(TXT_TOK(hdr) + (hdr)->ntok))
+#define TXT_NAMES(hdr) ((const char *)(TXT_FILE(hdr) + (hdr)->nfile))
+#define TXT_POST(hdr)  ((const uint8_t *)(TXT_NAMES(hdr) + (hdr)->names_size))
+#define TXT_TEXT(hdr)  ((const char *)(TXT_POST(hdr) + (hdr)->post_size))
+#define TXT_FNAMES(hdr) (TXT_TEXT(hdr) + (hdr)->text_size)
+
+// returns indexed capture 'name', adds it if not found
+static txt_file_t *txt_add_file(txt_idx_t *idx, const char *name)
+{
+	for(uint32_t i = 0; i < idx->hdr.nfile; i++) {
+		if (!strcmp(idx->fnames + idx->file[i].name, name))
+			return &idx->file[i];
+	}
+	uint32_t len = strlen(name) + 1;
+	if (txt_grow(&idx->fnames, &idx->fnames_cap, idx->hdr.fnames_size + len, 1) ||
+		txt_grow(&idx->file, &idx->file_cap, idx->hdr.nfile + 1, sizeof(txt_file_t)))
+		return NULL;
+	txt_file_t *file = &idx->file[idx->hdr.nfile++];
+	file->name  = idx->hdr.fnames_size;
+	file->nrec  = 0;
+	file->start = 0;
+	memcpy(idx->fnames + file->name, name, len);
+	idx->hdr.fnames_size += len;
+	return file;
+}
+
+// loads messages and texts of existing index and rebuilds posting lists
+static int txt_load(txt_idx_t *idx, const char *name)
+{
+	size_t size;
+	const txt_hdr_t *hdr = txt_map(name, &size);
+	if (hdr == NULL)
+		return access(name, F_OK) == 0 ? -1 : 0;
+
+	int ret = 0;
+	const char *text = TXT_TEXT(hdr);
+	// texts are added in the same order, so offsets are preserved
+	for(uint32_t off = 0; off < hdr->text_size && ret == 0; off += strlen(text + off) + 1) {
+		if (txt_add_text(idx, text + off) != off)
+			ret = -1;
+	}
+	for(uint32_t i = 0; i < hdr->nmsg && ret == 0; i++)
+		ret = txt_add_msg(idx, &TXT_MSG(hdr)[i]);
+	for(uint32_t i = 0; i < hdr->nfile && ret == 0; i++) {
+		txt_file_t *file = txt_add_file(idx, TXT_FNAMES(hdr) + TXT_FILE(hdr)[i].name);
+		if (file == NULL)
+			ret = -1;
+		else {
+			file->nrec  = TXT_FILE(hdr)[i].nrec;
+			file->start = TXT_FILE(hdr)[i].start;
+		}
+	}
+	munmap((void *)hdr, size);
+	return ret;
+}
+
+static txt_idx_t *txt_sort_idx;
+
+static int txt_cmp_tok(const void *a, const void *b)
+{
+	const txt_idx_t *idx = txt_sort_idx;
+	return strcmp(idx->names + idx->tok[*(const uint32_t *)a].name,
+		idx->names + idx->tok[*(const uint32_t *)b].name);
+}
+
+static int txt_cmp_msg(const void *a, const void *b)
+{
+	const txt_idx_t *idx = txt_sort_idx;
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+	uint32_t tx = idx->msg[x].time, ty = idx->msg[y].time;
+	if (tx != ty)
+		return (tx > ty) - (tx < ty);
+	return (x > y) - (x < y);
+}
+
+// puts messages added out of time order in place and rebuilds posting lists
+static int txt_sort(txt_idx_t *idx)
+{
+	uint32_t nmsg = idx->hdr.nmsg;
+	uint32_t *order = (uint32_t *)malloc((nmsg + 1)*sizeof(uint32_t));
+	txt_msg_t *msg = (txt_msg_t *)malloc((nmsg + 1)*sizeof(txt_msg_t));
+	if (!order || !msg) {
+		free(msg);
+		free(order);
+		return -1;
+	}
+	for(uint32_t i = 0; i < nmsg; i++)
+		order[i] = i;
+	txt_sort_idx = idx;
+	qsort(order, nmsg, sizeof(uint32_t), txt_cmp_msg);
+	for(uint32_t i = 0; i < nmsg; i++)
+		msg[i] = idx->msg[order[i]];
+	memcpy(idx->msg, msg, nmsg*sizeof(txt_msg_t));
+	free(msg);
+	free(order);
+
+	int ret = 0;
+	for(uint32_t i = 0; i < idx->hdr.ntok; i++)
+		idx->tok[i].n = 0;
+	for(uint32_t i = 0; i < nmsg && ret == 0; i++)
+		ret = txt_tokenize(idx, i);
+	idx->unsorted = 0;
+	return ret;
+}
+
+static uint32_t txt_varint(uint8_t *p, uint32_t val)
+{
+	uint32_t n = 0;
+	for(; val >= 0x80; val >>= 7)
+		p[n++] = (val & 0x7F) | 0x80;
+	p[n++] = val;
+	return n;
+}
+
+static int txt_write(txt_idx_t *idx, const char *name)
+{
+	int ret = -1;
+	uint32_t ntok = idx->hdr.ntok;
+	uint32_t npost = 0;
+	for(uint32_t i = 0; i < ntok; i++)
+		npost += idx->tok[i].n;
+
+	uint32_t *order = (uint32_t *)malloc((ntok + 1)*sizeof(uint32_t));
+	txt_tok_t *dict = (txt_tok_t *)malloc((ntok + 1)*sizeof(txt_tok_t));
+	char *names = (char *)malloc(idx->hdr.names_size + 1);
+	uint8_t *post = (uint8_t *)malloc((uint64_t)npost*5 + 1);
+	char *tmp = (char *)malloc(strlen(name) + 5);
+	FILE *fout = NULL;
+	if (!order || !dict || !names || !post || !tmp)
+		goto free_all;
+	if (idx->unsorted && txt_sort(idx) != 0)
+		goto free_all;
+
+	for(uint32_t i = 0; i < ntok; i++)
+		order[i] = i;
+	txt_sort_idx = idx;
+	qsort(order, ntok, sizeof(uint32_t), txt_cmp_tok);
+
+	idx->hdr.names_size = 0;
+	idx->hdr.post_size  = 0;
+	for(uint32_t i = 0; i < ntok; i++) {
+		txt_list_t *tok = &idx->tok[order[i]];
+		const char *s = idx->names + tok->name;
+		uint32_t len = strlen(s) + 1;
+
+		dict[i].name  = idx->hdr.names_size;
+		dict[i].post  = idx->hdr.post_size;
+		dict[i].npost = tok->n;
+		memcpy(names + idx->hdr.names_size, s, len);
+		idx->hdr.names_size += len;
+		for(uint32_t n = 0, prev = 0; n < tok->n; prev = tok->ids[n++])
+			idx->hdr.post_size += txt_varint(post + idx->hdr.post_size, tok->ids[n] - prev);
+	}
+
+	sprintf(tmp, "%s.tmp", name);
+	if ((fout = fopen(tmp, "wb")) == NULL)
+		goto free_all;
+	idx->hdr.magic   = TXT_MAGIC;
+	idx->hdr.version = TXT_VERSION;
+	if (fwrite(&idx->hdr, sizeof(txt_hdr_t), 1, fout) == 1 &&
+		fwrite(idx->msg, sizeof(txt_msg_t), idx->hdr.nmsg, fout) == idx->hdr.nmsg &&
+		fwrite(dict, sizeof(txt_tok_t), ntok, fout) == ntok &&
+		fwrite(idx->file, sizeof(txt_file_t), idx->hdr.nfile, fout) == idx->hdr.nfile &&
+		fwrite(names, 1, idx->hdr.names_size, fout) == idx->hdr.names_size &&
+		fwrite(post, 1, idx->hdr.post_size, fout) == idx->hdr.post_size &&
+		fwrite(idx->text, 1, idx->hdr.text_size, fout) == idx->hdr.text_size &&
+		fwrite(idx->fnames, 1, idx->hdr.fnames_size, fout) == idx->hdr.fnames_size)
+		ret = 0;
+	if (fclose(fout) != 0)
+		ret = -1;
+	// replace old index only when the new one is complete
+	if (ret == 0)
+		ret = rename(tmp, name);
+	if (ret != 0)
+		unlink(tmp);
+
+free_all:
+	free(tmp);
+	free(post);
+	free(names);
+	free(dict);
+	free(order);
+	return ret;
+}
+
+static void txt_free(txt_idx_t *idx)
+{
+	for(uint32_t i = 0; i < idx->hdr.ntok; i++)
+		free(idx->tok[i].ids);
+	free(idx->tok);
+	free(idx->names);
+	free(idx->toks.ids);
+	free(idx->text_off);
+	free(idx->text);
+	free(idx->texts.ids);
+	free(idx->msg);
+	free(idx->last);
+	free(idx->fnames);
+	free(idx->file);
+}
+
+// indexes capture from record 'from', decoding starts from the retune before
+// it, so texts completed after 'from' are complete
+static void txt_index_capture(txt_idx_t *idx, const cap_map_t *cap, uint32_t from)
+{
+	rds_mon_t mon;
+	uint32_t start = from;
+
+	if (from >= cap->nrec)
+		return;
+	while(start > 0 && cap->rec[start].type != CAP_TUNE)
+		start--;
+	idx->from = from;
+	for(uint32_t i = start; i < cap->nrec; i++) {
+		const cap_rec_t *rec = cap_map_rec(cap, i);
+		if (i == start || rec->type == CAP_TUNE) {
+			rds_mon_init(&mon, 0, 1);
+			mon.on_text = txt_on_text;
+			mon.data = idx;
+		}
+		if (CAP_IS_SYNC(rec) || CAP_IS_BAD(rec))
+			continue;
+		idx->rec  = i;
+		idx->now  = CAP_REC_TIME(cap, i);
+		idx->freq = rec->freq;
+		rds_mon_group(-1, &mon, rec->rds);
+	}
+}
+
+int txt_update(const char *name, char **files, int nfiles, txt_stat_t *stat)
+{
+	int ret = -1;
+	txt_idx_t idx;
+
+	memset(stat, 0, sizeof(txt_stat_t));
+	memset(&idx, 0, sizeof(idx));
+	idx.last = (uint32_t *)calloc(65536*4, sizeof(uint32_t));
+	if (idx.last == NULL || txt_load(&idx, name) != 0)
+		goto free_all;
+
+	for(int f = 0; f < nfiles; f++) {
+		cap_map_t cap;
+		char path[PATH_MAX];
+
+		stat->nfiles++;
+		if (cap_map(&cap, files[f]) != 0)
+			goto free_all;
+		// the same capture can be passed by different relative paths
+		txt_file_t *file = txt_add_file(&idx, realpath(files[f], path) ? path : files[f]);
+		if (file == NULL) {
+			cap_unmap(&cap);
+			goto free_all;
+		}
+		// shorter than indexed or started at another time, capture was replaced
+		if (cap.nrec < file->nrec || cap.hdr->start != file->start)
+			file->nrec = 0;
+		if (cap.nrec == 0 || cap.nrec == file->nrec)
+			stat->skipped++;
+		else {
+			txt_index_capture(&idx, &cap, file->nrec);
+			file->nrec  = cap.nrec;
+			file->start = cap.hdr->start;
+		}
+		cap_unmap(&cap);
+	}
+
+	ret = txt_write(&idx, name);
+	stat->added = idx.added;
+	stat->nmsg  = idx.hdr.nmsg;
+	stat->ntok  = idx.hdr.ntok;
+	stat->size  = sizeof(txt_hdr_t) + idx.hdr.nmsg*sizeof(txt_msg_t) + idx.hdr.ntok*sizeof(txt_tok_t) +
+		idx.hdr.nfile*sizeof(txt_file_t) + idx.hdr.names_size + idx.hdr.post_size + idx.hdr.text_size +
+		idx.hdr.fnames_size;
+
+free_all:
+	txt_free(&idx);
+	return ret;
+}
+
+void txt_qry_init(txt_qry_t *qry)
+{
+	memset(qry, 0, sizeof(txt_qry_t));
+	qry->pi   = -1;
+	qry->kind = -1;
+}
+
+// returns posting list size of the word or -1 if not indexed
+static int64_t txt_find(const txt_hdr_t *hdr, const char *word, uint32_t **pids)
+{
+	const txt_tok_t *tok = TXT_TOK(hdr);
+	uint32_t lo = 0, hi = hdr->ntok;
+
+	while(lo < hi) {
+		uint32_t mid = (lo + hi)/2;
+		int cmp = strcmp(TXT_NAMES(hdr) + tok[mid].name, word);
+		if (cmp == 0) {
+			const uint8_t *p = TXT_POST(hdr) + tok[mid].post;
+			uint32_t *ids = (uint32_t *)malloc((tok[mid].npost + 1)*sizeof(uint32_t));
+			if (ids == NULL)
+				return -1;
+			for(uint32_t n = 0, id = 0; n < tok[mid].npost; n++) {
+				uint32_t delta = 0;
+				for(int shift = 0; ; shift += 7) {
+					delta |= (uint32_t)(*p & 0x7F) << shift;
+					if (!(*p++ & 0x80))
+						break;
+				}
+				id += delta;
+				ids[n] = id;
+			}
+			*pids = ids;
+			return tok[mid].npost;
+		}
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return -1;
+}
+
+// intersects ids with sorted list, returns new size of ids
+static uint32_t txt_and(uint32_t *ids, uint32_t n, const uint32_t *list, uint32_t nlist)
+{
+	uint32_t i = 0, j = 0, k = 0;
+	while(i < n && j < nlist) {
+		if (ids[i] < list[j])
+			i++;
+		else if (ids[i] > list[j])
+			j++;
+		else {
+			ids[k++] = ids[i++];
+			j++;
+		}
+	}
+	return k;
+}
+
+// messages containing any of sorted text offsets
+static int64_t txt_substr(const txt_hdr_t *hdr, const char *words, uint32_t **pids)
+{
+	uint32_t noff = 0, cap = 0, nids = 0;
+	uint32_t *off = NULL, *ids = NULL;
+	const char *text = TXT_TEXT(hdr);
+
+	for(uint32_t i = 0; i < hdr->text_size; i += strlen(text + i) + 1) {
+		if (strcasestr(text + i, words)) {
+			if (txt_grow(&off, &cap, noff + 1, sizeof(uint32_t))) {
+				free(off);
+				return -1;
+			}
+			off[noff++] = i;
+		}
+	}
+	ids = (uint32_t *)malloc((hdr->nmsg + 1)*sizeof(uint32_t));
+	if (ids == NULL) {
+		free(off);
+		return -1;
+	}
+	for(uint32_t i = 0; i < hdr->nmsg && noff; i++) {
+		uint32_t t = TXT_MSG(hdr)[i].text;
+		uint32_t lo = 0, hi = noff;
+		while(lo < hi) {
+			uint32_t mid = (lo + hi)/2;
+			if (off[mid] < t)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo < noff && off[lo] == t)
+			ids[nids++] = i;
+	}
+	free(off);
+	*pids = ids;
+	return nids;
+}
+
+int txt_search(int fd, const char *name, const txt_qry_t *qry, const char *words)
+{
+	size_t size;
+	const txt_hdr_t *hdr = txt_map(name, &size);
+	if (hdr == NULL) {
+		dprintf(fd, "Unable to read index '%s'\n", name);
+		return -1;
+	}
+
+	int64_t n = 0;
+	uint32_t *ids = NULL;
+	if (qry->flags & TXT_SUBSTR)
+		n = txt_substr(hdr, words, &ids);
+	else {
+		char word[TXT_TOK_MAX];
+		const char *s = words;
+		while(n >= 0 && (s = txt_word(s, word)) != NULL) {
+			// not indexed, as in txt_tokenize()
+			if (strlen(word) < TXT_TOK_MIN)
+				continue;
+			uint32_t *list;
+			int64_t nlist = txt_find(hdr, word, &list);
+			if (nlist < 0) {
+				n = 0;
+				break;
+			}
+			if (ids == NULL) {
+				ids = list;
+				n = nlist;
+				continue;
+			}
+			n = txt_and(ids, n, list, nlist);
+			free(list);
+		}
+	}
+
+	int nmatch = 0;
+	for(int64_t i = 0; i < n; i++) {
+		const txt_msg_t *msg = &TXT_MSG(hdr)[ids[i]];
+		if (qry->pi >= 0 && msg->pi != qry->pi)
+			continue;
+		if (qry->kind >= 0 && msg->kind != qry->kind)
+			continue;
+		if ((qry->from && msg->time < qry->from) || (qry->to && msg->time > qry->to))
+			continue;
+
+		char buf[32];
+		struct tm tm;
+		time_t t = msg->time;
+		strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", localtime_r(&t, &tm));
+		dprintf(fd, "%s %3d.%02d %04X %-4s %s\n", buf, msg->freq/100, msg->freq%100,
+			msg->pi, txt_kind[msg->kind], TXT_TEXT(hdr) + msg->text);
+		nmatch++;
+	}
+	free(ids);
+	munmap((void *)hdr, size);
+	return nmatch;
+}
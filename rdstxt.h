@@ -0,0 +1,126 @@
+/*	Full-text index of recorded Radiotext, PS and PTYN
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	Index keeps only text changes: a message is added when a completed
+	PS, Radiotext or PTYN differs from the previous one of the same kind
+	sent by the same PI. Identical texts are stored once. Index file is
+
+	txt_hdr_t  header
+	txt_msg_t  msg[nmsg]    messages in time order
+	txt_tok_t  tok[ntok]    lower case tokens sorted by name
+	txt_file_t file[nfile]  captures indexed
+	char       names[]      zero terminated token names
+	uint8_t    post[]       posting lists, varint encoded message id deltas
+	char       text[]       zero terminated unique texts
+	char       fnames[]     zero terminated capture paths
+
+	Posting lists are derived data, so an update loads messages and texts,
+	adds new ones and rewrites the whole file. Every capture is remembered
+	by its path and number of records indexed, so a capture which grew is
+	indexed from where the previous update stopped and captures can be
+	added in any order.
+*/
+
+#ifndef __RDS_TEXT_H__
+#define __RDS_TEXT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+#define TXT_MAGIC   0x54585452 // 'RTXT'
+#define TXT_VERSION 2
+
+typedef struct txt_hdr_s
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t rsv;
+	uint32_t nmsg;
+	uint32_t ntok;
+	uint32_t names_size;
+	uint32_t post_size;
+	uint32_t text_size;
+	uint32_t nfile;
+	uint32_t fnames_size;
+} txt_hdr_t;
+
+typedef struct txt_msg_s
+{
+	uint32_t time;  // seconds since the Epoch
+	uint16_t pi;
+	uint16_t freq;
+	uint8_t  kind;  // RDS_TEXT_PS, RDS_TEXT_RT, RDS_TEXT_PTYN
+	uint8_t  len;
+	uint16_t rsv;
+	uint32_t text;  // offset in text[]
+} txt_msg_t;
+
+typedef struct txt_tok_s
+{
+	uint32_t name;  // offset in names[]
+	uint32_t post;  // offset in post[]
+	uint32_t npost; // number of messages
+} txt_tok_t;
+
+typedef struct txt_file_s
+{
+	uint32_t name;  // offset in fnames[]
+	uint32_t nrec;  // records indexed
+	uint32_t start; // capture start time, changes if capture is replaced
+} txt_file_t;
+
+typedef struct txt_stat_s
+{
+	uint32_t nfiles;   // captures processed
+	uint32_t skipped;  // captures skipped as already indexed
+	uint32_t added;    // new messages
+	uint32_t nmsg;     // messages in the index
+	uint32_t ntok;     // tokens in the index
+	uint32_t size;     // index file size
+} txt_stat_t;
+
+// adds text changes from captures to index 'name', creates it if needed
+int txt_update(const char *name, char **files, int nfiles, txt_stat_t *stat);
+
+// search flags
+#define TXT_SUBSTR 0x01 // match substring instead of words
+
+typedef struct txt_qry_s
+{
+	int32_t  pi;     // -1 - any PI
+	int8_t   kind;   // -1 - any kind
+	uint8_t  flags;
+	uint32_t from;   // time range, seconds since the Epoch
+	uint32_t to;
+} txt_qry_t;
+
+void txt_qry_init(txt_qry_t *qry);
+// prints messages containing all words (or substring), returns number of matches
+int  txt_search(int fd, const char *name, const txt_qry_t *qry, const char *words);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
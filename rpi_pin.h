@@ -19,6 +19,7 @@
 #define __RPI_IRQ_H__
 
 #include <stdint.h>
+#include <time.h>
 #include <unistd.h>
 
 #ifdef __cplusplus
@@ -62,6 +63,14 @@ static inline int rpi_pin_poll_clear(int fd)
 
 #define rpi_delay_ms(x) usleep((x)*1000u)
 
+// monotonic time in microseconds
+static inline uint64_t rpi_micros(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000u + ts.tv_nsec/1000;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -44,6 +44,9 @@ RBDS Standard:
 #include "rds.h"
 #include "pi2c.h"
 #include "si4703.h"
+#include "sifdr.h"
+#include "trace.h"
+#include "wbuf.h"
 #include "rpi_pin.h"
 
 struct si4703_state {
@@ -133,10 +136,14 @@ int si_set_state(uint16_t *regs, const char *name, uint16_t val)
 
 int si_read_regs(uint16_t *regs)
 {
+	TRACE_SPAN(TRACE_READ_REGS);
 	uint8_t buf[32];
 
-	if (pi2c_read(PI2C_BUS, buf, 32) < 0)
+	if (pi2c_read(PI2C_BUS, buf, 32) < 0) {
+		si_fdr_record(SI_FDR_READ | SI_FDR_ERR, 0, 0, NULL, __builtin_return_address(0));
+		si_fdr_error();
 		return -1;
+	}
 
 	// Si4703 sends back registers as 10, 11, 12, 13, 14, 15, 0, ...
 	// so we need to shuffle our buffer a bit
@@ -145,6 +152,25 @@ int si_read_regs(uint16_t *regs)
 		regs[x] = buf[i] << 8;
 		regs[x] |= buf[i+1];
 	}
+	si_fdr_record(SI_FDR_READ, 0, 16, regs, __builtin_return_address(0));
+	return 0;
+}
+
+// reads only status, channel and RDS registers 0x0A-0x0F
+int si_read_status(uint16_t *regs)
+{
+	TRACE_SPAN(TRACE_READ_STATUS);
+	uint8_t buf[12];
+
+	if (pi2c_read(PI2C_BUS, buf, 12) < 0) {
+		si_fdr_record(SI_FDR_READ | SI_FDR_ERR, STATUSRSSI, 0, NULL, __builtin_return_address(0));
+		si_fdr_error();
+		return -1;
+	}
+
+	for(int i = 0; i < 6; i++)
+		regs[STATUSRSSI + i] = (buf[i*2] << 8) | buf[i*2 + 1];
+	si_fdr_record(SI_FDR_READ, STATUSRSSI, 6, &regs[STATUSRSSI], __builtin_return_address(0));
 	return 0;
 }
 
@@ -166,80 +192,88 @@ static int _get_freq(uint16_t *regs, uint16_t reg)
 	return freq;
 }
 
-static const char *si_parse_reg(uint16_t *regs, uint8_t reg)
+static void si_parse_reg(wbuf_t *wb, uint16_t *regs, uint8_t reg)
 {
-	static char buf[256];
 	uint16_t bits = regs[reg];
 
 	if (reg == CHIPID) {
-		sprintf(buf, ": REV %X DEV %s FIRMWARE %d", (bits >> 10) & 0x3F,
+		wbuf_printf(wb, ": REV %X DEV %s FIRMWARE %d", (bits >> 10) & 0x3F,
 			((bits >> 6) & 0x0F) == 9 ? "Si4703" : "Si4702", bits & 0x3F);
-		return buf;
+		return;
 	}
 	if (reg == POWERCFG) {
-		sprintf(buf, ": DSMUTE %d DMUTE %d MONO %d RDSM %d SKMODE %d SEEKUP %d SEEK %d DISABLE %d ENABLE %d", 
+		wbuf_printf(wb, ": DSMUTE %d DMUTE %d MONO %d RDSM %d SKMODE %d SEEKUP %d SEEK %d DISABLE %d ENABLE %d", 
 			bit_set(bits, DSMUTE), bit_set(bits, DMUTE), bit_set(bits, MONO), bit_set(bits, RDSM),
 			bit_set(bits, SKMODE), bit_set(bits, SEEKUP), bit_set(bits, SEEK),
 			bit_set(bits, PWR_DISABLE), bit_set(bits, PWR_ENABLE));
-		return buf;
+		return;
 	}
 	if (reg == CHANNEL) {
 		int freq =  _get_freq(regs, regs[CHANNEL]);
-		sprintf(buf, ": TUNE %d CHAN %d (%d.%02dMHz)", bit_set(bits, TUNE), bits & 0x3FF, freq/100, freq%100);
-		return buf;
+		wbuf_printf(wb, ": TUNE %d CHAN %d (%d.%02dMHz)", bit_set(bits, TUNE), bits & 0x3FF, freq/100, freq%100);
+		return;
 	}
 	if (reg == SYSCONF1) {
-		sprintf(buf, ": RDSIEN %d STCIEN %d RDS %d DE %d AGCD %d BLNDADJ %d GPIO3 %d GPIO2 %d GPIO %d",
+		wbuf_printf(wb, ": RDSIEN %d STCIEN %d RDS %d DE %d AGCD %d BLNDADJ %d GPIO3 %d GPIO2 %d GPIO %d",
 			bit_set(bits, RDSIEN), bit_set(bits, STCIEN), bit_set(bits, RDS),
 			bit_set(bits, DE), bit_set(bits, AGCD), (bits >> 6) & 0x03,
 			(bits >> 4) & 0x03, (bits >> 2) & 0x03, bits & 0x3);
-		return buf;
+		return;
 	}
 	if (reg == SYSCONF2) {
-		sprintf(buf, ": SEEKTH %d BAND %d SPACE %d VOLUME %d",
+		wbuf_printf(wb, ": SEEKTH %d BAND %d SPACE %d VOLUME %d",
 			(bits >> 8) & 0xFF,	(bits >> 6) & 0x03, (bits >> 4) & 0x03, bits & 0x0F);
-		return buf;
+		return;
 	}
 	if (reg == SYSCONF3) {
-		sprintf(buf, ": SMUTER %d SMUTEA %d RDSPRF %d VOLEXT %d SKSNR %d SKCNT %d", (bits >> 14) & 0x03, 
+		wbuf_printf(wb, ": SMUTER %d SMUTEA %d RDSPRF %d VOLEXT %d SKSNR %d SKCNT %d", (bits >> 14) & 0x03, 
 			(bits >> 12) & 0x03, bit_set(bits, RDSPRF), bit_set(bits, VOLEXT), (bits >> 4) & 0x0F, bits & 0x0F);
-		return buf;
+		return;
 	}
 	if (reg == TEST1) {
-		sprintf(buf, ": XOSCEN %d AHIZEN %d", bit_set(bits, XOSCEN), bit_set(bits, AHIZEN));
-		return buf;
+		wbuf_printf(wb, ": XOSCEN %d AHIZEN %d", bit_set(bits, XOSCEN), bit_set(bits, AHIZEN));
+		return;
 	}
 	if (reg == STATUSRSSI) {
-		sprintf(buf, ": RDSR %d STC %d SF/BL %d AFCRL %d RDSS %d BLERA %d ST %d RSSI %d",
+		wbuf_printf(wb, ": RDSR %d STC %d SF/BL %d AFCRL %d RDSS %d BLERA %d ST %d RSSI %d",
 			bit_set(bits, RDSR), bit_set(bits, STC), bit_set(bits, SFBL), bit_set(bits, AFCRL),
 			bit_set(bits, RDSS), (bits >> 9) & 0x03, (bits >> 8) & 0x01, bits & 0xFF);
-		return buf;
+		return;
 	}
 	if (reg == READCHAN) {
 		int freq = _get_freq(regs, regs[READCHAN]);
-		sprintf(buf, ": BLERB %d BLERC %d BLERD %d READCHAN %d (%d.%02dMHz)",
+		wbuf_printf(wb, ": BLERB %d BLERC %d BLERD %d READCHAN %d (%d.%02dMHz)",
 			(bits >> 14) & 0x03, (bits >> 12) & 0x03, (bits >> 10) & 0x03, bits & 0x3FF, freq/100, freq%100);
-		return buf;
+		return;
 	}
-	return "";
 }
 
 void si_dump(int fd, uint16_t *regs, const char *title, uint16_t span)
 {
-	if (title)
-		dprintf(fd, "%s", title);
 	uint8_t start = (span >> 8) & 0xFF;
 	uint8_t num = span & 0xFF;
 	if (start > 15)
 		return;
 	if ((start + num) > 16)
 		return;
-	for(uint8_t i = 0; i < num; i++)
-		dprintf(fd, "%X %04X%s\n", i, regs[start + i], si_parse_reg(regs, start + i));
+
+	wbuf_t wb;
+	wbuf_init(&wb, fd);
+	if (title)
+		wbuf_puts(&wb, title);
+	for(uint8_t i = 0; i < num; i++) {
+		wbuf_hex(&wb, i, 1);
+		wbuf_putc(&wb, ' ');
+		wbuf_hex(&wb, regs[start + i], 4);
+		si_parse_reg(&wb, regs, start + i);
+		wbuf_putc(&wb, '\n');
+	}
+	wbuf_flush(&wb);
 }
 
 int si_update(uint16_t *regs)
 {
+	TRACE_SPAN(TRACE_UPDATE);
 	int i = 0, ret = 0;
 	uint8_t buf[32];
 	
@@ -250,11 +284,30 @@ int si_update(uint16_t *regs)
 	}
 
 	ret = pi2c_write(PI2C_BUS, buf, i);
+	si_fdr_record(SI_FDR_WRITE | (ret ? SI_FDR_ERR : 0), POWERCFG, 6, &regs[POWERCFG], __builtin_return_address(0));
+	if (ret)
+		si_fdr_error();
 	return ret;
 }
 
+// polls with back-off 1, 2, 4, 8, 8... ms until 'mask' is set in STATUSRSSI
+static int si_poll_status(uint16_t *regs, uint16_t mask, uint32_t timeout)
+{
+	uint32_t step = 1;
+	uint64_t start = rpi_micros();
+	while((rpi_micros() - start) < timeout*1000ull) {
+		rpi_delay_ms(step);
+		if (si_read_status(regs) == 0 && (regs[STATUSRSSI] & mask))
+			return (rpi_micros() - start)/1000;
+		if (step < 8)
+			step <<= 1;
+	}
+	return -1;
+}
+
 void si_set_channel(uint16_t *regs, int chan)
 {
+	TRACE_SPAN(TRACE_SET_CHANNEL);
 	int band = (regs[SYSCONF2] >> 6) & 0x03;
 	int space = (regs[SYSCONF2] >> 4) & 0x03;
 	int nchan = (si_band[band][1] - si_band[band][0])/si_space[space];
@@ -266,26 +319,22 @@ void si_set_channel(uint16_t *regs, int chan)
 	regs[CHANNEL] |= TUNE;
 	si_update(regs);
 
-	rpi_delay_ms(10);
-
 	// poll to see if STC is set
-	int i = 0;
-	while(i++ < 100) {
-		si_read_regs(regs);
-		if (regs[STATUSRSSI] & STC) break;
-		rpi_delay_ms(10);
-	}
+	if (si_poll_status(regs, STC, 1000) < 0)
+		si_fdr_error(); // STC is stuck
 
 	regs[CHANNEL] &= ~TUNE;
 	si_update(regs);
 
 	// wait for the si4703 to clear the STC as well
-	i = 0;
-	while(i++ < 100) {
-		si_read_regs(regs);
+	int i = 0;
+	while(i++ < 1000) {
+		si_read_status(regs);
 		if (!(regs[STATUSRSSI] & STC)) break;
-		rpi_delay_ms(10);
+		rpi_delay_ms(1);
 	}
+	if (i > 1000)
+		si_fdr_error();
 }
 
 // freq: 9500 for 95.00 MHz
@@ -343,8 +392,16 @@ int si_get_freq(uint16_t *regs)
 	return _get_freq(regs, regs[READCHAN]);
 }
 
+uint8_t si_get_bler(uint16_t *regs)
+{
+	uint8_t bler = ((regs[STATUSRSSI] & BLERA) >> 9) << 6;
+	bler |= (regs[READCHAN] & (BLERB | BLERC | BLERD)) >> 10;
+	return bler;
+}
+
 int si_seek(uint16_t *regs, int dir)
 {
+	TRACE_SPAN(TRACE_SEEK);
 	si_read_regs(regs);
 
 	int channel = regs[READCHAN] & RCHAN; // current channel
@@ -363,6 +420,8 @@ int si_seek(uint16_t *regs, int dir)
 		if((regs[STATUSRSSI] & STC) != 0) break; //Tuning complete!
 		rpi_delay_ms(10);
 	}
+	if (i > 500)
+		si_fdr_error(); // STC is stuck
 
 	si_read_regs(regs);
 	int valueSFBL = regs[STATUSRSSI] & SFBL; //Store the value of SFBL
@@ -376,6 +435,8 @@ int si_seek(uint16_t *regs, int dir)
 		if( (regs[STATUSRSSI] & STC) == 0) break; //Tuning complete!
 		rpi_delay_ms(10);
 	}
+	if (i > 500)
+		si_fdr_error();
 
 	if (channel == (regs[READCHAN] & RCHAN))
 		return 0;
@@ -384,38 +445,150 @@ int si_seek(uint16_t *regs, int dir)
 	return si_get_freq(regs);
 }
 
-void si_power(uint16_t *regs, uint16_t mode)
+// seek settings as recommended in AN230, Table 23. Summary of Seek Settings
+static const uint16_t si_seek_modes[5][2] = {
+	{ 0x1900, 0x0000 },
+	{ 0x1900, 0x0048 },
+	{ 0x0C00, 0x0048 },
+	{ 0x0C00, 0x007F },
+	{ 0x0000, 0x004F }
+};
+
+void si_set_seek_mode(uint16_t *regs, uint8_t mode)
 {
-	if (mode == PWR_ENABLE) {
-		// set only ENABLE bit, leaving device muted
-		regs[POWERCFG] = PWR_ENABLE;
-		// by default we allow wrap by not setting SKMODE
-		// regs[POWERCFG] |= SKMODE; 
-		regs[SYSCONF1] |= RDS; // enable RDS
-
-		// set mono/stereo blend adjust to default 0 or 31-49 RSSI
-		regs[SYSCONF1] &= ~BLNDADJ;
-		// set different BLDADJ if needed
-		// x00=31-49, x40=37-55, x80=19-37,xC0=25-43 RSSI
-		//	regs[SYSCONF1] |= 0x0080;
-		// enable RDS High-Performance Mode
-		regs[SYSCONF3] |= RDSPRF;
-		regs[SYSCONF1] |= DE; // set 50us De-Emphasis for Europe, skip for USA
-		// select general Europe/USA 87.5 - 108 MHz band
-		regs[SYSCONF2] = BAND0 | SPACE100; // 100kHz channel spacing for Europe
-
-		// apply recommended seek settings for "most stations"
-		regs[SYSCONF2] &= ~SEEKTH;
-		regs[SYSCONF2] |= 0x0C00; // SEEKTH 12
-		regs[SYSCONF3] &= 0xFF00;
-		regs[SYSCONF3] |= 0x004F; // SKSNR 4, SKCNT 15
+	if (mode < 1 || mode > 5)
+		return;
+	regs[SYSCONF2] &= 0x00FF;
+	regs[SYSCONF3] &= 0xFF00;
+	regs[SYSCONF2] |= si_seek_modes[mode - 1][0];
+	regs[SYSCONF3] |= si_seek_modes[mode - 1][1];
+}
+
+// settings applied on power up, si_probe() looks for them
+static void si_power_cfg(uint16_t *regs)
+{
+	// set only ENABLE bit, leaving device muted
+	regs[POWERCFG] = PWR_ENABLE;
+	// by default we allow wrap by not setting SKMODE
+	// regs[POWERCFG] |= SKMODE; 
+	regs[SYSCONF1] |= RDS; // enable RDS
+
+	// set mono/stereo blend adjust to default 0 or 31-49 RSSI
+	regs[SYSCONF1] &= ~BLNDADJ;
+	// set different BLDADJ if needed
+	// x00=31-49, x40=37-55, x80=19-37,xC0=25-43 RSSI
+	//	regs[SYSCONF1] |= 0x0080;
+	// enable RDS High-Performance Mode
+	regs[SYSCONF3] |= RDSPRF;
+	regs[SYSCONF1] |= DE; // set 50us De-Emphasis for Europe, skip for USA
+	// select general Europe/USA 87.5 - 108 MHz band
+	regs[SYSCONF2] = BAND0 | SPACE100; // 100kHz channel spacing for Europe
+
+	// apply recommended seek settings for "most stations"
+	regs[SYSCONF2] &= ~SEEKTH;
+	regs[SYSCONF2] |= 0x0C00; // SEEKTH 12
+	regs[SYSCONF3] &= 0xFF00;
+	regs[SYSCONF3] |= 0x004F; // SKSNR 4, SKCNT 15
+}
+
+int si_probe(uint16_t *regs)
+{
+	if (si_read_regs(regs) != 0 || regs[DEVICEID] != SI_DEVICEID)
+		return -1;
+	if (!(regs[TEST1] & XOSCEN))
+		return SI_COLD;
+	if ((regs[POWERCFG] & (PWR_DISABLE | PWR_ENABLE)) != PWR_ENABLE)
+		return SI_COLD;
+	// our band and RDS settings, volume and seek settings may differ
+	if ((regs[SYSCONF2] & (BAND | SPACING)) != (BAND0 | SPACE100) ||
+		!(regs[SYSCONF1] & RDS) || !(regs[SYSCONF3] & RDSPRF))
+		return SI_COLD;
+	return SI_WARM;
+}
+
+// powers up with 'cfg' settings or current ones and tunes to 'chan'
+static int si_power_tune(uint16_t *regs, uint16_t chan, int cfg, uint32_t timeout, uint32_t *last)
+{
+	uint32_t pause = 2;
+	uint64_t start = rpi_micros();
+	do {
+		// power up and tune in one write, repeated until the chip takes it
+		if (cfg)
+			si_power_cfg(regs);
+		else
+			regs[POWERCFG] = (regs[POWERCFG] & ~PWR_DISABLE) | PWR_ENABLE;
+		regs[CHANNEL] = (regs[CHANNEL] & ~CHAN) | chan | TUNE;
+		int ms = -1;
+		if (si_update(regs) == 0)
+			ms = si_poll_status(regs, STC, SI_TUNE_MS*3/2); // with some slack for polling step
+		regs[CHANNEL] &= ~TUNE;
+		si_update(regs);
+		if (ms >= 0) {
+			if (last)
+				*last = ms;
+			// STC must be cleared before the next tune or seek
+			for(int i = 0; i < 50 && (regs[STATUSRSSI] & STC); i++) {
+				rpi_delay_ms(1);
+				si_read_status(regs);
+			}
+			return (rpi_micros() - start)/1000;
+		}
+		rpi_delay_ms(pause);
+		if (pause < 32)
+			pause <<= 1;
+	} while((rpi_micros() - start) < timeout*1000ull);
+	return -1;
+}
+
+int si_powerup(uint16_t *regs, int freq, uint32_t timeout, uint32_t *last)
+{
+	int band = BAND0 >> 6, space = SPACE100 >> 4;
+	if (freq < si_band[band][0]) freq = si_band[band][0];
+	if (freq > si_band[band][1]) freq = si_band[band][1];
+	uint16_t chan = (freq - si_band[band][0])/si_space[space];
+
+	return si_power_tune(regs, chan, 1, timeout, last);
+}
+
+int si_wakeup(uint16_t *regs, uint32_t timeout)
+{
+	return si_power_tune(regs, regs[CHANNEL] & CHAN, 0, timeout, NULL);
+}
+
+int si_wait_rssi(uint16_t *regs, uint32_t timeout)
+{
+	if (si_read_status(regs) == 0 && (regs[STATUSRSSI] & RSSI))
+		return 0;
+	return si_poll_status(regs, RSSI, timeout);
+}
+
+int si_wait_stable(uint16_t *regs, uint32_t timeout)
+{
+	int prev = -1;
+	uint64_t start = rpi_micros();
+	while((rpi_micros() - start) < timeout*1000ull) {
+		rpi_delay_ms(SI_POLL_MS);
+		if (si_read_status(regs) != 0)
+			continue;
+		int rssi = regs[STATUSRSSI] & RSSI;
+		// railed AFC means the reference is still off
+		if (regs[STATUSRSSI] & AFCRL)
+			rssi = -1;
+		else if (rssi && prev > 0 && rssi - prev <= 1 && prev - rssi <= 1)
+			return (rpi_micros() - start)/1000;
+		prev = rssi;
 	}
-	else {
-		// power down condition
-		regs[POWERCFG] = PWR_DISABLE | PWR_ENABLE;
+	return -1;
+}
+
+int si_power(uint16_t *regs, uint16_t mode)
+{
+	if (mode == PWR_ENABLE) {
+		// ready when it tunes back to the current channel
+		return si_powerup(regs, si_get_freq(regs), SI_READY_MS, NULL);
 	}
 
-	si_update(regs);
-	// recommended powerup time
-	rpi_delay_ms(110);
+	// power down condition, nothing to wait for
+	regs[POWERCFG] = PWR_DISABLE | PWR_ENABLE;
+	return si_update(regs);
 }
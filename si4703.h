@@ -136,13 +136,41 @@ extern "C" {
 #define RDSD       0x0F
 
 int  si_read_regs(uint16_t *regs);
+int  si_read_status(uint16_t *regs);
 int  si_update(uint16_t *regs);
 void si_dump(int fd, uint16_t *regs, const char *title, uint16_t span);
-void si_power(uint16_t *regs, uint16_t mode);
+// power up returns time it took in ms, -1 if device was not ready
+int  si_power(uint16_t *regs, uint16_t mode);
+
+#define SI_DEVICEID 0x1242 // manufacturer 0x242, part 1
+#define SI_TUNE_MS  60     // datasheet tune time
+#define SI_READY_MS 1000   // power up and first tune
+#define SI_POLL_MS  10     // si_wait_stable() poll interval
+// si_probe() results
+#define SI_COLD 0 // needs reset, oscillator start and power up
+#define SI_WARM 1 // powered up with si_power() settings
+// reads registers, -1 if device does not answer
+int  si_probe(uint16_t *regs);
+// powers up and tunes to 'freq' repeating with back-off until STC is set,
+// returns time it took in ms or -1 if device was not ready in 'timeout' ms,
+// 'last' is set to the time of successful attempt
+int  si_powerup(uint16_t *regs, int freq, uint32_t timeout, uint32_t *last);
+// powers up with settings and channel kept in 'regs' since power down,
+// returns time it took in ms or -1
+int  si_wakeup(uint16_t *regs, uint32_t timeout);
+// polls until RSSI is not 0, returns time in ms or -1
+int  si_wait_rssi(uint16_t *regs, uint32_t timeout);
+// polls until AFC is not railed and RSSI reads the same +-1 twice in a row,
+// sign of stable crystal after tune, returns time in ms or -1
+int  si_wait_stable(uint16_t *regs, uint32_t timeout);
 void si_set_volume(uint16_t *regs, int volume);
 
 int  si_get_freq(uint16_t *regs);
+// BLERA:BLERB:BLERC:BLERD, 2 bits each, BLERA in bits 7:6
+uint8_t si_get_bler(uint16_t *regs);
 int  si_seek(uint16_t *regs, int dir);
+// mode 1-5 as in AN230, Table 23
+void si_set_seek_mode(uint16_t *regs, uint8_t mode);
 void si_set_channel(uint16_t *regs, int chan);
 void si_tune(uint16_t *regs, int freq);
 
@@ -0,0 +1,253 @@
+/*	Batch of commands in one device session
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cli.h"
+#include "jsonw.h"
+#include "sibatch.h"
+#include "rdsd.h"
+#include "si4703.h"
+#include "rpi_pin.h"
+
+#define SIB_WAIT_MS  5000 // default 'wait until' timeout
+#define SIB_PI_MS    500  // how long 'pi' waits for a group
+#define SIB_POLL_MS  10
+#define SIB_OUT_MAX  16384 // captured output per step
+
+// evaluates condition, returns 1 or 0, -1 if it cannot be parsed
+static int sib_cond(char **parg)
+{
+	uint16_t regs[16];
+	char *arg = *parg;
+	int neg = 0;
+
+	if (*arg == '!') {
+		neg = 1;
+		arg++;
+	}
+	if (si_read_status(regs) != 0)
+		return -1;
+
+	int val = -1;
+	char *end;
+	if (cmd_arg(arg, "stereo", &end))
+		val = !!(regs[STATUSRSSI] & STEREO);
+	else if (cmd_arg(arg, "rds", &end))
+		val = !!(regs[STATUSRSSI] & RDSS);
+	else if (cmd_arg(arg, "stc", &end))
+		val = !!(regs[STATUSRSSI] & STC);
+	if (val != -1) {
+		*parg = end;
+		return val ^ neg;
+	}
+
+	int pi = 0;
+	if (cmd_arg(arg, "rssi", &arg))
+		val = regs[STATUSRSSI] & RSSI;
+	else if (cmd_arg(arg, "pi", &arg)) {
+		pi = 1;
+		uint64_t start = rpi_micros();
+		while(!(regs[STATUSRSSI] & RDSR) && (rpi_micros() - start) < SIB_PI_MS*1000ull) {
+			rpi_delay_ms(SIB_POLL_MS);
+			si_read_status(regs);
+		}
+		val = (regs[STATUSRSSI] & RDSR) ? regs[RDSA] : -1;
+	}
+	else
+		return -1;
+
+	const char *ops[] = { "<=", ">=", "==", "!=", "<", ">" };
+	int op;
+	for(op = 0; op < 6; op++) {
+		if (cmd_arg(arg, ops[op], &arg))
+			break;
+	}
+	if (op == 6)
+		return -1;
+	int ref = strtol(arg, &end, pi ? 16 : 10);
+	if (end == arg)
+		return -1;
+	while(*end && *end <= ' ')
+		end++;
+	*parg = end;
+
+	int res = 0;
+	switch(op) {
+	case 0: res = val <= ref; break;
+	case 1: res = val >= ref; break;
+	case 2: res = val == ref; break;
+	case 3: res = val != ref; break;
+	case 4: res = val < ref; break;
+	case 5: res = val > ref; break;
+	}
+	// no RDS is neither less nor more than any PI
+	if (pi && val == -1)
+		res = (op == 3);
+	return res ^ neg;
+}
+
+// 'wait MS' or 'wait until COND [timeout MS]'
+static int sib_wait(char *arg)
+{
+	char *val;
+	if (!cmd_arg(arg, "until", &val)) {
+		uint32_t ms = strtoul(arg, NULL, 10);
+		// in small steps, daemon may cancel the script
+		while(ms && !rdsd_cancel) {
+			uint32_t step = (ms < SIB_POLL_MS) ? ms : SIB_POLL_MS;
+			rpi_delay_ms(step);
+			ms -= step;
+		}
+		return 0;
+	}
+
+	uint32_t timeout = SIB_WAIT_MS;
+	uint64_t start = rpi_micros();
+	while(1) {
+		char *cond = val;
+		int res = sib_cond(&cond);
+		if (res < 0)
+			return CLI_EARG;
+		if (cmd_arg(cond, "timeout", &cond))
+			timeout = strtoul(cond, NULL, 10);
+		if (res)
+			return 0;
+		if (rdsd_cancel || (rpi_micros() - start) >= timeout*1000ull)
+			return -1;
+		rpi_delay_ms(SIB_POLL_MS);
+	}
+}
+
+static int sib_exec(int out, char *line, cmd_t *cmds)
+{
+	char *arg;
+	for(uint32_t i = 0; cmds[i].name != NULL; i++) {
+		if (!cmd_arg(line, cmds[i].name, &arg))
+			continue;
+		// commands which take over the session
+		if (!strcmp(cmds[i].name, "daemon") || !strcmp(cmds[i].name, "batch"))
+			return CLI_ENOTSUP;
+		return cmds[i].cmd(out, *arg ? arg : NULL);
+	}
+	return CLI_ENOTSUP;
+}
+
+int sib_batch(int fd, char *script, cmd_t *cmds)
+{
+	wbuf_t wb;
+	jw_t jw;
+	uint32_t steps = 0, failed = 0, nline = 0;
+	uint64_t start = rpi_micros();
+	int ret = 0;
+
+	// output of every command is collected here
+	FILE *tmp = tmpfile();
+	char *obuf = (char *)malloc(SIB_OUT_MAX);
+	if (tmp == NULL || obuf == NULL) {
+		if (tmp)
+			fclose(tmp);
+		free(obuf);
+		return -1;
+	}
+	int out = fileno(tmp);
+	wbuf_init(&wb, fd);
+
+	for(char *line = script, *next; line && *line && !ret && !rdsd_cancel; line = next) {
+		nline++;
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+		for(char *p = line + strlen(line); p > line && p[-1] <= ' '; p--)
+			p[-1] = '\0';
+		while(*line && *line <= ' ')
+			line++;
+		if (*line == '\0' || *line == '#')
+			continue;
+
+		// commands split their arguments in place, keep the line for the result
+		char text[256];
+		snprintf(text, sizeof(text), "%s", line);
+
+		char *cmd = line, *val;
+		int optional = 0;
+		if (*cmd == '-') {
+			optional = 1;
+			cmd++;
+		}
+
+		int status = 0, skipped = 0;
+		uint64_t us = rpi_micros();
+		if (ftruncate(out, 0) != 0 || lseek(out, 0, SEEK_SET) != 0)
+			break;
+
+		if (cmd_is(cmd, "stop"))
+			ret = 1;
+		else if (cmd_arg(cmd, "wait", &val))
+			status = sib_wait(val);
+		else if (cmd_arg(cmd, "if", &val)) {
+			int res = sib_cond(&val);
+			if (res < 0)
+				status = CLI_EARG;
+			else if (!res)
+				skipped = 1;
+			else if (cmd_is(val, "stop"))
+				ret = 1;
+			else
+				status = sib_exec(out, val, cmds);
+		}
+		else
+			status = sib_exec(out, cmd, cmds);
+		us = rpi_micros() - us;
+
+		steps++;
+		jw_begin(&jw, &wb, "step");
+		jw_uint(&jw, "line", nline);
+		jw_str(&jw, "cmd", text);
+		jw_int(&jw, "status", status);
+		if (skipped)
+			jw_bool(&jw, "skipped", 1);
+		jw_u64(&jw, "us", us);
+		// results stay one line, output of 'rds' and alike is cut
+		ssize_t n = pread(out, obuf, SIB_OUT_MAX, 0);
+		if (n > 0)
+			jw_strn(&jw, "out", obuf, n);
+		if (lseek(out, 0, SEEK_END) > SIB_OUT_MAX)
+			jw_bool(&jw, "truncated", 1);
+		jw_end(&jw);
+		wbuf_flush(&wb);
+
+		if (status != 0) {
+			failed++;
+			if (!optional)
+				ret = -1;
+		}
+	}
+	fclose(tmp);
+	free(obuf);
+
+	jw_begin(&jw, &wb, "batch");
+	jw_uint(&jw, "steps", steps);
+	jw_uint(&jw, "failed", failed);
+	jw_int(&jw, "status", ret < 0 ? -1 : 0);
+	jw_u64(&jw, "us", rpi_micros() - start);
+	jw_end(&jw);
+	wbuf_flush(&wb);
+	return ret < 0 ? -1 : 0;
+}
@@ -0,0 +1,56 @@
+/*	Batch of commands in one device session
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	One command per line, exactly as for rdspi, GPIO and I2C bus are
+	set up once for the whole batch. Besides commands:
+
+	  # comment
+	  -command           failure does not stop the batch
+	  wait MS
+	  wait until COND [timeout MS]   default timeout 5 s, fails on timeout
+	  if COND command    runs command only if COND is true
+	  stop               ends the batch, 'if rssi < 20 stop'
+
+	COND is 'rssi OP N', 'pi OP XXXX', 'stereo', 'rds' (RDS synchronized)
+	or 'stc', with optional '!' in front, OP is one of < <= > >= == !=.
+	'pi' waits up to half a second for a group, 'pi != XXXX' is true if
+	there is no RDS at all.
+
+	Results are NDJSON, one "step" record per line with its status,
+	time and captured output, and "batch" record at the end.
+*/
+
+#ifndef __SI4703_BATCH_H__
+#define __SI4703_BATCH_H__
+
+#include "cmd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+// runs 'script' which is modified, returns 0 if all steps succeeded
+int sib_batch(int fd, char *script, cmd_t *cmds);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
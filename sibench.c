@@ -0,0 +1,258 @@
+/*	Si4703 hardware self-benchmark
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+#include "cli.h"
+#include "rdsrx.h"
+#include "sibench.h"
+#include "si4703.h"
+#include "rpi_pin.h"
+
+#define SIB_GROUP_US 87600 // nominal RDS group duration
+#define SIB_STC_MS   3000  // tune or seek timeout
+
+typedef struct sib_stat_s
+{
+	char      name[16];
+	uint32_t *us;  // samples, sorted when reported
+	uint32_t  n;
+	uint32_t  cap;
+} sib_stat_t;
+
+enum { SIB_READ, SIB_STATUS, SIB_UPDATE, SIB_TUNE, SIB_SEEK1, SIB_NSTATS = SIB_SEEK1 + 5 };
+
+static const char *sib_names[SIB_NSTATS] = {
+	"read_full", "read_partial", "update", "tune_stc",
+	"seek_mode1", "seek_mode2", "seek_mode3", "seek_mode4", "seek_mode5"
+};
+
+void sib_init(sib_opt_t *opt)
+{
+	opt->reads  = 1000;
+	opt->tunes  = 21;
+	opt->seeks  = 5;
+	opt->rds_ms = 10000;
+}
+
+static void sib_add(sib_stat_t *st, uint32_t us)
+{
+	if (st->n == st->cap) {
+		uint32_t cap = st->cap ? st->cap*2 : 256;
+		uint32_t *p = (uint32_t *)realloc(st->us, cap*sizeof(uint32_t));
+		if (p == NULL)
+			return;
+		st->us  = p;
+		st->cap = cap;
+	}
+	st->us[st->n++] = us;
+}
+
+static int sib_cmp(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+static uint32_t sib_pct(const sib_stat_t *st, uint32_t pct)
+{
+	if (st->n == 0)
+		return 0;
+	uint32_t i = (st->n*pct + 99)/100;
+	return st->us[i ? i - 1 : 0];
+}
+
+// waits for STC to be set or cleared, returns wait time in us or 0 on timeout
+static uint32_t sib_wait_stc(uint16_t *regs, int set)
+{
+	uint64_t start = rpi_micros();
+	while(rpi_micros() - start < SIB_STC_MS*1000ull) {
+		si_read_status(regs);
+		if (!!(regs[STATUSRSSI] & STC) == set)
+			return rpi_micros() - start;
+		usleep(500);
+	}
+	return 0;
+}
+
+static uint32_t sib_tune(uint16_t *regs, uint16_t chan)
+{
+	regs[CHANNEL] = (regs[CHANNEL] & ~CHAN) | chan | TUNE;
+	uint64_t start = rpi_micros();
+	si_update(regs);
+	uint32_t us = sib_wait_stc(regs, 1) ? rpi_micros() - start : 0;
+	regs[CHANNEL] &= ~TUNE;
+	si_update(regs);
+	sib_wait_stc(regs, 0);
+	return us;
+}
+
+// seeks up, returns seek time or 0 if seek failed or reached band limit
+static uint32_t sib_seek(uint16_t *regs)
+{
+	regs[POWERCFG] |= SEEKUP | SEEK;
+	uint64_t start = rpi_micros();
+	si_update(regs);
+	uint32_t us = sib_wait_stc(regs, 1) ? rpi_micros() - start : 0;
+	if (regs[STATUSRSSI] & SFBL)
+		us = 0;
+	regs[POWERCFG] &= ~SEEK;
+	si_update(regs);
+	sib_wait_stc(regs, 0);
+	return us;
+}
+
+// polls RDS exactly as 'rds' command does
+static void sib_rds(uint16_t *regs, uint32_t ms, rds_rx_t *rx, uint32_t *ngroups, uint32_t *elapsed)
+{
+	rds_pll_t pll;
+	uint64_t start = rpi_micros();
+
+	rds_pll_init(&pll);
+	*ngroups = 0;
+	while(rpi_micros() - start < ms*1000ull) {
+		uint64_t now = rpi_micros();
+		si_read_status(regs);
+		int rdsr = !!(regs[STATUSRSSI] & RDSR);
+		rds_rx_read(rx, now, rdsr ? &regs[RDSA] : NULL);
+		if (rdsr)
+			(*ngroups)++;
+		uint64_t next = rds_pll_read(&pll, now, rdsr);
+		now = rpi_micros();
+		if (next > now)
+			usleep(next - now);
+	}
+	*elapsed = (rpi_micros() - start)/1000;
+}
+
+static void sib_json_stat(FILE *out, const sib_stat_t *st)
+{
+	fprintf(out, "  \"%s\": {\"n\": %u, \"min\": %u, \"p50\": %u, \"p90\": %u, \"p99\": %u, \"max\": %u},\n",
+		st->name, st->n, sib_pct(st, 0), sib_pct(st, 50), sib_pct(st, 90), sib_pct(st, 99), sib_pct(st, 100));
+}
+
+int sib_run(int fd, const sib_opt_t *opt, const char *json)
+{
+	uint16_t regs[16], saved[16];
+	sib_stat_t stats[SIB_NSTATS];
+	rds_rx_t rx;
+	uint32_t ngroups = 0, elapsed = 0;
+
+	if (si_read_regs(regs) != 0)
+		return -1;
+	memcpy(saved, regs, sizeof(saved));
+	memset(stats, 0, sizeof(stats));
+	rds_rx_init(&rx);
+	for(int i = 0; i < SIB_NSTATS; i++)
+		strcpy(stats[i].name, sib_names[i]);
+
+	dprintf(fd, "benchmarking, it takes a while...\n");
+	for(uint32_t i = 0; i < opt->reads; i++) {
+		uint64_t start = rpi_micros();
+		si_read_regs(regs);
+		sib_add(&stats[SIB_READ], rpi_micros() - start);
+
+		start = rpi_micros();
+		si_read_status(regs);
+		sib_add(&stats[SIB_STATUS], rpi_micros() - start);
+
+		start = rpi_micros();
+		si_update(regs);
+		sib_add(&stats[SIB_UPDATE], rpi_micros() - start);
+	}
+
+	int band  = (regs[SYSCONF2] >> 6) & 0x03;
+	int space = (regs[SYSCONF2] >> 4) & 0x03;
+	uint32_t nchan = (si_band[band][1] - si_band[band][0])/si_space[space];
+	for(uint32_t i = 0; i < opt->tunes; i++) {
+		uint32_t chan = (opt->tunes > 1) ? i*nchan/(opt->tunes - 1) : 0;
+		uint32_t us = sib_tune(regs, chan);
+		if (us)
+			sib_add(&stats[SIB_TUNE], us);
+	}
+
+	// stop at the upper band limit
+	regs[POWERCFG] |= SKMODE;
+	for(uint8_t mode = 1; mode <= 5; mode++) {
+		si_set_seek_mode(regs, mode);
+		sib_tune(regs, 0);
+		for(uint32_t i = 0; i < opt->seeks; i++) {
+			uint32_t us = sib_seek(regs);
+			if (!us)
+				break;
+			sib_add(&stats[SIB_SEEK1 + mode - 1], us);
+		}
+	}
+
+	// restore settings and station
+	regs[POWERCFG] = saved[POWERCFG];
+	regs[SYSCONF2] = saved[SYSCONF2];
+	regs[SYSCONF3] = saved[SYSCONF3];
+	sib_tune(regs, saved[READCHAN] & RCHAN);
+	if (opt->rds_ms)
+		sib_rds(regs, opt->rds_ms, &rx, &ngroups, &elapsed);
+
+	uint32_t expected = elapsed*1000ull/SIB_GROUP_US;
+	uint32_t missed = (expected > ngroups) ? (expected - ngroups)*1000ull/expected : 0;
+
+	dprintf(fd, "%-12s %6s %8s %8s %8s %8s %8s (us)\n", "", "n", "min", "p50", "p90", "p99", "max");
+	for(int i = 0; i < SIB_NSTATS; i++) {
+		sib_stat_t *st = &stats[i];
+		qsort(st->us, st->n, sizeof(uint32_t), sib_cmp);
+		dprintf(fd, "%-12s %6u %8u %8u %8u %8u %8u\n", st->name, st->n,
+			sib_pct(st, 0), sib_pct(st, 50), sib_pct(st, 90), sib_pct(st, 99), sib_pct(st, 100));
+	}
+	dprintf(fd, "RDS %u groups in %u ms, %u.%02u groups/s, %u expected, %u.%u%% missed\n",
+		ngroups, elapsed, elapsed ? ngroups*1000/elapsed : 0, elapsed ? ngroups*100000/elapsed % 100 : 0,
+		expected, missed/10, missed%10);
+	if (opt->rds_ms)
+		rds_rx_report(fd, &rx, 0);
+
+	int ret = 0;
+	if (json) {
+		FILE *out = fopen(json, "w");
+		if (out) {
+			struct utsname un;
+			memset(&un, 0, sizeof(un));
+			uname(&un);
+			// to compare different Pis and kernels
+			fprintf(out, "{\n  \"host\": {\"name\": \"%s\", \"kernel\": \"%s\", \"machine\": \"%s\"},\n",
+				un.nodename, un.release, un.machine);
+			for(int i = 0; i < SIB_NSTATS; i++)
+				sib_json_stat(out, &stats[i]);
+			fprintf(out, "  \"rds\": {\"groups\": %u, \"ms\": %u, \"expected\": %u, \"missed\": %.3f, \"reads\": %u, \"duplicates\": %u, \"missed_groups\": %u}\n}\n",
+				ngroups, elapsed, expected, missed/1000.0, rx.reads, rx.dups, rx.missed);
+			if (fclose(out) == 0)
+				dprintf(fd, "Saved to %s\n", json);
+			else {
+				dprintf(fd, "Unable to write '%s'\n", json);
+				ret = CLI_EARG;
+			}
+		}
+		else {
+			dprintf(fd, "Unable to open '%s'\n", json);
+			ret = CLI_EARG;
+		}
+	}
+
+	for(int i = 0; i < SIB_NSTATS; i++)
+		free(stats[i].us);
+	return ret;
+}
@@ -0,0 +1,45 @@
+/*	Si4703 hardware self-benchmark
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __SI4703_BENCH_H__
+#define __SI4703_BENCH_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+typedef struct sib_opt_s
+{
+	uint32_t reads;  // number of register reads and writes
+	uint32_t tunes;  // number of channels tuned across the band
+	uint32_t seeks;  // seeks per AN230 mode
+	uint32_t rds_ms; // RDS polling time
+} sib_opt_t;
+
+void sib_init(sib_opt_t *opt);
+// runs benchmarks, prints percentiles and saves them to 'json' if not NULL
+int  sib_run(int fd, const sib_opt_t *opt, const char *json);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,320 @@
+/*	Si4703 emulator for development without hardware
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pi2c.h"
+#include "siemu.h"
+#include "rdscap.h"
+#include "rdsgen.h"
+#include "si4703.h"
+#include "rpi_pin.h"
+
+#define EMU_GROUP_US 87600 // RDS group duration
+#define EMU_RDSR_US  40000 // RDSR is kept set for
+#define EMU_TUNE_US  60000 // tune time
+#define EMU_SEEK_US  15000 // seek time per channel
+#define EMU_SYNC_US  150000 // RDS synchronization after tune
+#define EMU_MAX_STATIONS 32
+
+typedef struct emu_station_s
+{
+	uint16_t freq;
+	uint8_t  rssi;
+	gen_station_t gen;
+	uint32_t *recs;  // capture records of the station
+	uint32_t nrecs;
+	uint32_t pos;
+} emu_station_t;
+
+typedef struct si_emu_s
+{
+	uint16_t regs[16];
+	uint64_t stc_at;   // time tune or seek completes, 0 - none in progress
+	uint16_t target;   // channel tune or seek ends at
+	uint8_t  seek_fail;
+	uint64_t next;     // time next RDS group is ready
+	uint64_t rdsr_at;  // time current RDS group became ready
+	int      cur;      // current station, -1 - none
+
+	emu_station_t st[EMU_MAX_STATIONS];
+	int      nst;
+	cap_map_t cap;
+	gen_err_t err;
+	pi2c_emu_t dev;
+} si_emu_t;
+
+static si_emu_t *emu;
+
+static const int emu_band[3][2] = { {8750, 10800}, {7600, 10800}, {7600, 9000}};
+static const int emu_space[3] = { 20, 10, 5 };
+
+static int emu_freq(const si_emu_t *pemu, uint16_t chan)
+{
+	int band  = (pemu->regs[SYSCONF2] >> 6) & 0x03;
+	int space = (pemu->regs[SYSCONF2] >> 4) & 0x03;
+	if (band > 2)
+		band = 0;
+	if (space > 2)
+		space = 0;
+	return emu_band[band][0] + chan*emu_space[space];
+}
+
+static int emu_nchan(const si_emu_t *pemu)
+{
+	int band  = (pemu->regs[SYSCONF2] >> 6) & 0x03;
+	int space = (pemu->regs[SYSCONF2] >> 4) & 0x03;
+	if (band > 2)
+		band = 0;
+	if (space > 2)
+		space = 0;
+	return (emu_band[band][1] - emu_band[band][0])/emu_space[space];
+}
+
+static int emu_station(const si_emu_t *pemu, uint16_t chan)
+{
+	int freq = emu_freq(pemu, chan);
+	for(int i = 0; i < pemu->nst; i++) {
+		if (pemu->st[i].freq == freq)
+			return i;
+	}
+	return -1;
+}
+
+static void emu_next_group(si_emu_t *pemu, uint64_t at)
+{
+	emu_station_t *st = &pemu->st[pemu->cur];
+	uint16_t rds[4];
+	uint8_t  bler;
+
+	if (st->recs) {
+		const cap_rec_t *rec = cap_map_rec(&pemu->cap, st->recs[st->pos]);
+		memcpy(rds, rec->rds, sizeof(rds));
+		bler = rec->bler;
+		if (++st->pos >= st->nrecs)
+			st->pos = 0;
+	}
+	else {
+		gen_group(&st->gen, time(NULL), rds);
+		bler = gen_errors(&pemu->err, rds);
+	}
+
+	memcpy(&pemu->regs[RDSA], rds, sizeof(rds));
+	pemu->regs[STATUSRSSI] = (pemu->regs[STATUSRSSI] & ~BLERA) | ((bler >> 6) << 9);
+	pemu->regs[READCHAN] = (pemu->regs[READCHAN] & RCHAN) | ((bler & 0x3F) << 10);
+	pemu->rdsr_at = at;
+}
+
+// advances emulated time to 'now'
+static void emu_update(si_emu_t *pemu, uint64_t now)
+{
+	uint16_t *regs = pemu->regs;
+
+	if (pemu->stc_at && now >= pemu->stc_at) {
+		pemu->stc_at = 0;
+		regs[READCHAN] = (regs[READCHAN] & ~RCHAN) | pemu->target;
+		regs[STATUSRSSI] &= ~(RSSI | STEREO | SFBL | RDSS | RDSR);
+		regs[STATUSRSSI] |= STC | (pemu->seek_fail ? SFBL : 0);
+		pemu->cur = emu_station(pemu, pemu->target);
+		if (pemu->cur >= 0) {
+			uint8_t rssi = pemu->st[pemu->cur].rssi;
+			regs[STATUSRSSI] |= rssi | ((rssi > 30) ? STEREO : 0);
+		}
+		else
+			regs[STATUSRSSI] |= 8;
+		pemu->next = now + EMU_SYNC_US;
+	}
+
+	int rds_on = (regs[POWERCFG] & PWR_ENABLE) && !(regs[POWERCFG] & PWR_DISABLE) &&
+		(regs[SYSCONF1] & RDS) && !pemu->stc_at && pemu->cur >= 0;
+	if (!rds_on) {
+		regs[STATUSRSSI] &= ~(RDSR | RDSS);
+		return;
+	}
+
+	regs[STATUSRSSI] |= RDSS;
+	// groups not read in time are overwritten
+	while(now >= pemu->next) {
+		emu_next_group(pemu, pemu->next);
+		pemu->next += EMU_GROUP_US;
+	}
+	if (pemu->rdsr_at && now < pemu->rdsr_at + EMU_RDSR_US)
+		regs[STATUSRSSI] |= RDSR;
+	else
+		regs[STATUSRSSI] &= ~RDSR;
+}
+
+static int emu_read(void *dev, uint8_t *data, uint32_t len)
+{
+	si_emu_t *pemu = (si_emu_t *)dev;
+
+	emu_update(pemu, rpi_micros());
+	// reading starts at register 0x0A
+	for(uint32_t i = 0; i < len; i++) {
+		uint16_t reg = pemu->regs[(STATUSRSSI + i/2) & 0x0F];
+		data[i] = (i & 1) ? (reg & 0xFF) : (reg >> 8);
+	}
+	return 0;
+}
+
+static void emu_seek(si_emu_t *pemu, uint64_t now)
+{
+	uint16_t *regs = pemu->regs;
+	int nchan = emu_nchan(pemu);
+	int chan  = regs[READCHAN] & RCHAN;
+	int dir   = (regs[POWERCFG] & SEEKUP) ? 1 : -1;
+	int wrap  = !(regs[POWERCFG] & SKMODE);
+	int seekth = (regs[SYSCONF2] & SEEKTH) >> 8;
+	int steps;
+
+	pemu->seek_fail = 1;
+	pemu->target = chan;
+	for(steps = 1; steps <= nchan; steps++) {
+		chan += dir;
+		if (chan < 0 || chan > nchan) {
+			if (!wrap)
+				break;
+			chan = (chan < 0) ? nchan : 0;
+		}
+		int st = emu_station(pemu, chan);
+		if (st >= 0 && pemu->st[st].rssi >= seekth) {
+			pemu->seek_fail = 0;
+			pemu->target = chan;
+			break;
+		}
+	}
+	if (pemu->seek_fail && !wrap)
+		pemu->target = (dir > 0) ? nchan : 0;
+	pemu->stc_at = now + steps*EMU_SEEK_US;
+	pemu->cur = -1;
+}
+
+// writing starts at register 0x02
+static int emu_write(void *dev, const uint8_t *data, uint32_t len)
+{
+	si_emu_t *pemu = (si_emu_t *)dev;
+	uint16_t *regs = pemu->regs;
+	uint64_t now = rpi_micros();
+	uint16_t powercfg = regs[POWERCFG];
+	uint16_t channel  = regs[CHANNEL];
+
+	emu_update(pemu, now);
+	for(uint32_t i = 0; i + 1 < len && i/2 < 6; i += 2)
+		regs[POWERCFG + i/2] = (data[i] << 8) | data[i + 1];
+
+	if ((regs[CHANNEL] & TUNE) && !(channel & TUNE)) {
+		pemu->target = regs[CHANNEL] & CHAN;
+		pemu->seek_fail = 0;
+		pemu->stc_at = now + EMU_TUNE_US;
+		pemu->cur = -1;
+	}
+	if ((regs[POWERCFG] & SEEK) && !(powercfg & SEEK))
+		emu_seek(pemu, now);
+	// host clears TUNE or SEEK to acknowledge STC
+	if ((!(regs[CHANNEL] & TUNE) && (channel & TUNE)) || (!(regs[POWERCFG] & SEEK) && (powercfg & SEEK))) {
+		pemu->stc_at = 0;
+		regs[STATUSRSSI] &= ~(STC | SFBL);
+	}
+	if (regs[POWERCFG] & PWR_DISABLE)
+		pemu->cur = -1;
+	return 0;
+}
+
+static int emu_add(si_emu_t *pemu, uint16_t freq)
+{
+	for(int i = 0; i < pemu->nst; i++) {
+		if (pemu->st[i].freq == freq)
+			return i;
+	}
+	if (pemu->nst >= EMU_MAX_STATIONS)
+		return -1;
+	emu_station_t *st = &pemu->st[pemu->nst];
+	st->freq = freq;
+	st->rssi = 25 + (pemu->nst*7) % 30;
+	return pemu->nst++;
+}
+
+static int emu_load_capture(si_emu_t *pemu, const char *name)
+{
+	if (cap_map(&pemu->cap, name) != 0)
+		return -1;
+	for(uint32_t i = 0; i < pemu->cap.nrec; i++) {
+		const cap_rec_t *rec = cap_map_rec(&pemu->cap, i);
+		if (CAP_IS_SYNC(rec))
+			continue;
+		int n = emu_add(pemu, rec->freq);
+		if (n < 0)
+			continue;
+		emu_station_t *st = &pemu->st[n];
+		if ((st->nrecs & 0x3FF) == 0) {
+			uint32_t *p = (uint32_t *)realloc(st->recs, (st->nrecs + 1024)*sizeof(uint32_t));
+			if (p == NULL)
+				return -1;
+			st->recs = p;
+		}
+		st->recs[st->nrecs++] = i;
+	}
+	return pemu->nst ? 0 : -1;
+}
+
+int si_emu_attach(const char *src)
+{
+	si_emu_detach();
+	emu = (si_emu_t *)calloc(1, sizeof(si_emu_t));
+	if (emu == NULL)
+		return -1;
+
+	emu->cur = -1;
+	emu->regs[DEVICEID] = 0x1242;
+	emu->regs[CHIPID]   = 0x1253; // Si4703 rev C firmware 19
+	emu->regs[TEST1]    = 0x0100;
+
+	if (strncmp(src, "gen", 3) == 0) {
+		unsigned nst = 6, rate = 0, burst = 0;
+		sscanf(src, "gen:%u:%u:%u", &nst, &rate, &burst);
+		if (nst > EMU_MAX_STATIONS)
+			nst = EMU_MAX_STATIONS;
+		for(unsigned i = 0; i < nst; i++) {
+			int n = emu_add(emu, gen_station_freq(i));
+			gen_station_init(&emu->st[n].gen, 0xC201 + i, emu->st[n].freq);
+		}
+		gen_err_init(&emu->err, 1, rate, burst);
+	}
+	else if (emu_load_capture(emu, src) != 0) {
+		si_emu_detach();
+		return -1;
+	}
+
+	emu->dev.read  = emu_read;
+	emu->dev.write = emu_write;
+	emu->dev.dev   = emu;
+	return pi2c_emulate(PI2C_BUS, &emu->dev);
+}
+
+void si_emu_detach(void)
+{
+	if (emu == NULL)
+		return;
+	pi2c_emulate(PI2C_BUS, NULL);
+	for(int i = 0; i < emu->nst; i++)
+		free(emu->st[i].recs);
+	cap_unmap(&emu->cap);
+	free(emu);
+	emu = NULL;
+}
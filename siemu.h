@@ -0,0 +1,49 @@
+/*	Si4703 emulator for development without hardware
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	Emulator replaces Si4703 on I2C bus at registers level: tune and seek
+	complete after a delay setting STC, RDS groups arrive every 87.6 ms
+	and RDSR stays set for 40 ms, so groups not read in time are lost as
+	on real hardware. Source of stations is either
+
+	gen[:N[:E[:B]]] - N generated stations (6 by default), E block errors
+	                  per 1000 blocks, B mean error burst length in groups
+	file.cap        - capture replayed in a loop, a station per frequency
+*/
+
+#ifndef __SI4703_EMU_H__
+#define __SI4703_EMU_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+#define SI_EMU_ENV "RDSPI_EMU" // environment variable to enable emulator
+
+int  si_emu_attach(const char *src);
+void si_emu_detach(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,152 @@
+/*	Flight data recorder of Si4703 registers transactions
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <time.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sifdr.h"
+#include "rpi_pin.h"
+
+#define SI_FDR_VERSION  1
+#define SI_FDR_ERROR_US 10000000 // minimal interval between saves on errors
+
+// start of the executable image, provided by linker
+extern char __executable_start;
+
+static si_fdr_rec_t fdr_ring[SI_FDR_SIZE];
+static uint32_t fdr_pos;  // total number of records
+static uint64_t fdr_saved; // time of last save on error
+static char     fdr_name[256]; // default file name, resolved before signals arrive
+
+void si_fdr_record(uint8_t op, uint8_t reg, uint8_t nregs, const uint16_t *regs, void *site)
+{
+	si_fdr_rec_t *rec = &fdr_ring[__sync_fetch_and_add(&fdr_pos, 1) & (SI_FDR_SIZE - 1)];
+
+	if (nregs > 16)
+		nregs = 16;
+	rec->us    = rpi_micros();
+	rec->site  = (uint32_t)((char *)site - &__executable_start);
+	rec->op    = op;
+	rec->reg   = reg;
+	rec->nregs = nregs;
+	rec->rsv   = 0;
+	if (regs)
+		memcpy(rec->regs, regs, nregs*sizeof(uint16_t));
+}
+
+static int fdr_write(int fd, const void *data, size_t len)
+{
+	const char *p = (const char *)data;
+	while(len) {
+		ssize_t n = write(fd, p, len);
+		if (n <= 0)
+			return -1;
+		p += n;
+		len -= n;
+	}
+	return 0;
+}
+
+// uses only async-signal-safe calls
+int si_fdr_save(const char *name)
+{
+	si_fdr_hdr_t hdr;
+	uint32_t pos = fdr_pos;
+	uint32_t nrec = (pos < SI_FDR_SIZE) ? pos : SI_FDR_SIZE;
+	uint32_t first = (pos - nrec) & (SI_FDR_SIZE - 1);
+
+	if (name == NULL)
+		name = fdr_name[0] ? fdr_name : (getenv(SI_FDR_ENV) ? getenv(SI_FDR_ENV) : SI_FDR_FILE);
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic   = SI_FDR_MAGIC;
+	hdr.version = SI_FDR_VERSION;
+	hdr.nrec    = nrec;
+	hdr.time    = time(NULL);
+	hdr.us      = rpi_micros();
+
+	int fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return -1;
+	// ring is saved in two parts, from the oldest record to the end and from the start
+	uint32_t tail = (first + nrec > SI_FDR_SIZE) ? SI_FDR_SIZE - first : nrec;
+	int ret = fdr_write(fd, &hdr, sizeof(hdr));
+	if (ret == 0)
+		ret = fdr_write(fd, &fdr_ring[first], tail*sizeof(si_fdr_rec_t));
+	if (ret == 0)
+		ret = fdr_write(fd, fdr_ring, (nrec - tail)*sizeof(si_fdr_rec_t));
+	close(fd);
+	return ret;
+}
+
+void si_fdr_error(void)
+{
+	uint64_t now = rpi_micros();
+	if (fdr_saved && now - fdr_saved < SI_FDR_ERROR_US)
+		return;
+	fdr_saved = now;
+	si_fdr_save(NULL);
+}
+
+static void fdr_signal(int sig)
+{
+	si_fdr_save(NULL);
+	// fatal signals are reset to default action by SA_RESETHAND
+	if (sig != SIGUSR1)
+		raise(sig);
+}
+
+void si_fdr_signals(void)
+{
+	static const int sigs[] = { SIGUSR1, SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+	struct sigaction sa;
+
+	snprintf(fdr_name, sizeof(fdr_name), "%s", getenv(SI_FDR_ENV) ? getenv(SI_FDR_ENV) : SI_FDR_FILE);
+	for(size_t i = 0; i < sizeof(sigs)/sizeof(sigs[0]); i++) {
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler = fdr_signal;
+		sigemptyset(&sa.sa_mask);
+		sa.sa_flags = SA_RESTART | ((sigs[i] == SIGUSR1) ? 0 : SA_RESETHAND);
+		sigaction(sigs[i], &sa, NULL);
+	}
+}
+
+int si_fdr_load(const char *name, si_fdr_hdr_t *hdr, si_fdr_rec_t **precs)
+{
+	FILE *fin = fopen(name, "rb");
+	if (fin == NULL)
+		return -1;
+
+	int ret = -1;
+	*precs = NULL;
+	if (fread(hdr, sizeof(*hdr), 1, fin) == 1 && hdr->magic == SI_FDR_MAGIC &&
+		hdr->version == SI_FDR_VERSION && hdr->nrec <= SI_FDR_SIZE) {
+		*precs = (si_fdr_rec_t *)malloc((hdr->nrec + 1)*sizeof(si_fdr_rec_t));
+		if (*precs && fread(*precs, sizeof(si_fdr_rec_t), hdr->nrec, fin) == hdr->nrec)
+			ret = hdr->nrec;
+	}
+	fclose(fin);
+	if (ret < 0) {
+		free(*precs);
+		*precs = NULL;
+	}
+	return ret;
+}
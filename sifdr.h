@@ -0,0 +1,86 @@
+/*	Flight data recorder of Si4703 registers transactions
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	Every register read and write is copied to a fixed in-memory ring
+	with its time and caller address. The ring is saved to a file on
+	request, on I2C errors and STC timeouts, on SIGUSR1 and on fatal
+	signals. File is the header followed by records, oldest first.
+
+	Caller is stored as offset in rdspi executable, to find the source
+	line use 'addr2line -f -e rdspi 0xOFFSET'.
+*/
+
+#ifndef __SI4703_FDR_H__
+#define __SI4703_FDR_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+#define SI_FDR_ENV   "RDSPI_FDR"      // environment variable to override file name
+#define SI_FDR_FILE  "/tmp/rdspi.fdr" // default file name
+#define SI_FDR_MAGIC 0x52444653       // 'SFDR'
+#define SI_FDR_SIZE  4096             // records in ring, power of two
+
+// record operations
+#define SI_FDR_READ  0x01
+#define SI_FDR_WRITE 0x02
+#define SI_FDR_ERR   0x80 // transaction failed
+
+typedef struct si_fdr_hdr_s
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t rsv;
+	uint32_t nrec;
+	uint32_t time; // seconds since the Epoch when saved
+	uint64_t us;   // monotonic time when saved
+} si_fdr_hdr_t;
+
+typedef struct si_fdr_rec_s
+{
+	uint64_t us;       // monotonic time
+	uint32_t site;     // caller offset in executable
+	uint8_t  op;
+	uint8_t  reg;      // first register
+	uint8_t  nregs;
+	uint8_t  rsv;
+	uint16_t regs[16]; // nregs registers starting from reg
+} si_fdr_rec_t;
+
+void si_fdr_record(uint8_t op, uint8_t reg, uint8_t nregs, const uint16_t *regs, void *site);
+// saves the ring, NULL for default name, signal safe
+int  si_fdr_save(const char *name);
+// saves the ring after an error, not more often than once in 10 seconds
+void si_fdr_error(void);
+// saves the ring on SIGUSR1 and fatal signals
+void si_fdr_signals(void);
+
+// helpers for reading saved files, returns number of records or -1,
+// *precs must be freed by caller
+int  si_fdr_load(const char *name, si_fdr_hdr_t *hdr, si_fdr_rec_t **precs);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,313 @@
+/*	RDS harvesting with the tuner powered only while needed
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rdsrx.h"
+#include "siharv.h"
+#include "si4703.h"
+#include "rpi_pin.h"
+
+static const char *harv_name[] = { "pi", "pty", "ps", "rt", "ct" };
+#define HARV_NAMES (sizeof(harv_name)/sizeof(harv_name[0]))
+
+int harv_parse(const char *str, uint8_t *need)
+{
+	*need = 0;
+	while(*str) {
+		size_t len = strcspn(str, ",");
+		uint32_t i;
+		for(i = 0; i < HARV_NAMES; i++) {
+			if (len == strlen(harv_name[i]) && !strncmp(str, harv_name[i], len))
+				break;
+		}
+		if (i == HARV_NAMES)
+			return -1;
+		*need |= 1 << i;
+		str += len;
+		if (*str == ',')
+			str++;
+	}
+	return *need ? 0 : -1;
+}
+
+void harv_names(char *buf, uint8_t have)
+{
+	*buf = '\0';
+	for(uint32_t i = 0; i < HARV_NAMES; i++) {
+		if (have & (1 << i)) {
+			if (*buf)
+				strcat(buf, ",");
+			strcat(buf, harv_name[i]);
+		}
+	}
+	if (*buf == '\0')
+		strcpy(buf, "none");
+}
+
+static void harv_group(harv_st_t *st, const uint16_t *prds)
+{
+	uint16_t gtv = RDS_GET_GT(prds[RDS_B]);
+
+	st->groups++;
+	st->hist++;
+	if (gtv == RDS_GT_00A || gtv == RDS_GT(0, 1))
+		st->hist_gt[0]++;
+	if (gtv == RDS_GT_02A)
+		st->hist_gt[1]++;
+	if (gtv == RDS_GT_04A)
+		st->hist_gt[2]++;
+	// PI and PTY are taken when two groups in a row agree
+	if (st->groups > 1 && st->pi == prds[RDS_A])
+		st->have |= HARV_PI;
+	st->pi = prds[RDS_A];
+	uint8_t pty = (prds[RDS_B] >> 5) & 0x1F;
+	if (st->groups > 1 && st->pty == pty)
+		st->have |= HARV_PTY;
+	st->pty = pty;
+
+	if (gtv == RDS_GT_00A || gtv == RDS_GT(0, 1)) {
+		rds_parse_gt00a(prds, &st->rd0);
+		if (st->rd0.valid == 0x0F) {
+			memcpy(st->ps, st->rd0.ps, sizeof(st->ps));
+			st->have |= HARV_PS;
+		}
+	}
+	if (gtv == RDS_GT_02A && rds_rt_add(prds, &st->rd2)) {
+		strcpy(st->rt, st->rd2.text);
+		st->rt_seg = st->rd2.nseg;
+		st->have |= HARV_RT;
+	}
+	if (gtv == RDS_GT_04A && rds_parse_gt04a(prds, &st->ct) == 0)
+		st->have |= HARV_CT;
+}
+
+int harv_collect(uint16_t *regs, harv_st_t *st, uint8_t need, uint32_t budget, uint32_t now)
+{
+	rds_pll_t pll;
+	rds_rx_t  rx;
+	uint64_t start = rpi_micros();
+	uint16_t pi = st->pi;
+	int ret = -1;
+
+	rds_pll_init(&pll);
+	rds_rx_init(&rx);
+	st->have = 0;
+	st->groups = 0;
+	memset(&st->rd0, 0, sizeof(st->rd0));
+	memset(&st->rd2, 0, sizeof(st->rd2));
+
+	while((st->have & need) != need) {
+		uint64_t us = rpi_micros();
+		if (us - start >= budget*1000ull)
+			break;
+		if (!st->groups && us - start >= HARV_SYNC_MS*1000ull)
+			break;
+		if (si_read_status(regs) != 0)
+			break;
+		int rdsr = !!(regs[STATUSRSSI] & RDSR);
+		if (rds_rx_read(&rx, us, rdsr ? &regs[RDSA] : NULL) == 0 && rdsr) {
+			harv_group(st, &regs[RDSA]);
+			// do not wait for the next group if this one completed it
+			if ((st->have & need) == need) {
+				ret = (rpi_micros() - start)/1000;
+				break;
+			}
+		}
+		uint64_t next = rds_pll_read(&pll, us, rdsr);
+		us = rpi_micros();
+		if (next > us)
+			usleep(next - us);
+	}
+
+	// another station on this frequency, forget what was known
+	if ((st->have & HARV_PI) && st->seen[0] && st->pi != pi) {
+		for(int i = 0; i < HARV_ITEMS; i++)
+			st->seen[i] = 0;
+		st->hist = st->groups;
+		memset(st->hist_gt, 0, sizeof(st->hist_gt));
+	}
+	for(int i = 0; i < HARV_ITEMS; i++) {
+		if (st->have & (1 << i))
+			st->seen[i] = now;
+	}
+	st->quiet = st->groups ? 0 : now;
+	return ret;
+}
+
+static const char *harv_file(void)
+{
+	return getenv(HARV_ENV) ? getenv(HARV_ENV) : HARV_FILE;
+}
+
+harv_st_t *harv_find(harv_cache_t *hc, uint16_t freq, int add)
+{
+	for(uint32_t i = 0; i < hc->n; i++) {
+		if (hc->st[i].freq == freq)
+			return &hc->st[i];
+	}
+	if (!add || hc->n == HARV_MAX)
+		return NULL;
+	harv_st_t *st = &hc->st[hc->n++];
+	memset(st, 0, sizeof(*st));
+	st->freq = freq;
+	return st;
+}
+
+// copies tab separated field, returns the next one
+static char *harv_field(char *dst, size_t size, char *src)
+{
+	size_t len = strcspn(src, "\t\n");
+	if (len >= size)
+		len = size - 1;
+	memcpy(dst, src, len);
+	dst[len] = '\0';
+	src += strcspn(src, "\t\n");
+	return (*src == '\t') ? src + 1 : src;
+}
+
+int harv_load(harv_cache_t *hc)
+{
+	char line[256];
+	unsigned freq, pi, pty, rt_seg, seen[HARV_ITEMS], quiet, hist, gt[3];
+	int off;
+
+	hc->n = 0;
+	FILE *in = fopen(harv_file(), "r");
+	if (in == NULL)
+		return 0;
+	while(fgets(line, sizeof(line), in)) {
+		if (line[0] == '#')
+			continue;
+		if (sscanf(line, "%u %x %u %u %u %u %u %u %u %u %u %u %u %u%n", &freq, &pi, &pty, &rt_seg,
+			&seen[0], &seen[1], &seen[2], &seen[3], &seen[4], &quiet, &hist, &gt[0], &gt[1], &gt[2], &off) != 14)
+			continue;
+		harv_st_t *st = harv_find(hc, freq, 1);
+		if (st == NULL)
+			break;
+		st->pi  = pi;
+		st->pty = pty;
+		st->rt_seg = rt_seg;
+		for(int i = 0; i < HARV_ITEMS; i++)
+			st->seen[i] = seen[i];
+		st->quiet = quiet;
+		st->hist = hist;
+		for(int i = 0; i < 3; i++)
+			st->hist_gt[i] = gt[i];
+		// PS and Radiotext are the last and may have spaces
+		char *p = line + off;
+		if (*p == '\t')
+			p = harv_field(st->rt, sizeof(st->rt), harv_field(st->ps, sizeof(st->ps), p + 1));
+	}
+	fclose(in);
+	return 0;
+}
+
+int harv_save(const harv_cache_t *hc)
+{
+	FILE *out = fopen(harv_file(), "w");
+	if (out == NULL)
+		return -1;
+	fprintf(out, "# freq\tpi\tpty\trt_seg\tseen pi pty ps rt ct\tquiet\tgroups\t0A\t2A\t4A\tps\trt\n");
+	for(uint32_t i = 0; i < hc->n; i++) {
+		const harv_st_t *st = &hc->st[i];
+		fprintf(out, "%u\t%04X\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%s\t%s\n",
+			st->freq, st->pi, st->pty, st->rt_seg,
+			st->seen[0], st->seen[1], st->seen[2], st->seen[3], st->seen[4],
+			st->quiet, st->hist, st->hist_gt[0], st->hist_gt[1], st->hist_gt[2], st->ps, st->rt);
+	}
+	return fclose(out);
+}
+
+uint8_t harv_stale(const harv_st_t *st, uint8_t need, uint32_t now, uint32_t fresh)
+{
+	uint8_t stale = 0;
+	if (st->quiet && now - st->quiet < fresh)
+		return 0;
+	for(int i = 0; i < HARV_ITEMS; i++) {
+		if ((need & (1 << i)) && (now - st->seen[i] >= fresh))
+			stale |= 1 << i;
+	}
+	// enough history to tell the station does not send these groups
+	if (st->hist >= HARV_HISTORY) {
+		if (!st->hist_gt[0])
+			stale &= ~HARV_PS;
+		if (!st->hist_gt[1])
+			stale &= ~HARV_RT;
+		if (!st->hist_gt[2])
+			stale &= ~HARV_CT;
+	}
+	return stale;
+}
+
+// groups to pass until all 'n' segments are seen, segments are sent in
+// turn 'cnt' times in 'hist' groups, one more for the first one missed
+static uint32_t harv_groups(uint32_t n, uint32_t cnt, uint32_t hist)
+{
+	return (uint64_t)(n + 1)*hist/cnt;
+}
+
+static inline uint32_t harv_max(uint32_t a, uint32_t b)
+{
+	return (a > b) ? a : b;
+}
+
+// expected time in ms to collect item, 0 if history is too short to tell
+static uint32_t harv_item(const harv_st_t *st, uint8_t item, uint64_t now_ms)
+{
+	// clock time is sent at the start of every minute
+	if (item == HARV_CT)
+		return 60000 - now_ms % 60000 + HARV_CT_MS;
+	if (st->hist < HARV_HISTORY)
+		return 0;
+
+	uint32_t groups = 2; // PI and PTY
+	if (item == HARV_PS && st->hist_gt[0])
+		groups = harv_groups(4, st->hist_gt[0], st->hist);
+	if (item == HARV_RT && st->hist_gt[1])
+		groups = harv_groups(st->rt_seg ? st->rt_seg : 16, st->hist_gt[1], st->hist);
+	// half as much again for the slower than average cases
+	return (uint64_t)groups*RDS_GROUP_US*3/2/1000;
+}
+
+uint8_t harv_fits(const harv_st_t *st, uint8_t need, uint32_t budget, uint64_t now_ms)
+{
+	uint8_t fits = 0;
+	for(int i = 0; i < HARV_ITEMS; i++) {
+		uint8_t item = 1 << i;
+		if ((need & item) && harv_item(st, item, now_ms) <= budget)
+			fits |= item;
+	}
+	return fits;
+}
+
+uint32_t harv_dwell(const harv_st_t *st, uint8_t need, uint32_t max, uint64_t now_ms)
+{
+	uint32_t ms = 0;
+	for(int i = 0; i < HARV_ITEMS; i++) {
+		if (!(need & (1 << i)))
+			continue;
+		uint32_t item = harv_item(st, 1 << i, now_ms);
+		// no history, dwell until complete
+		if (item == 0)
+			return max;
+		ms = harv_max(ms, item);
+	}
+	return (ms > max) ? max : ms;
+}
@@ -0,0 +1,115 @@
+/*	RDS harvesting with the tuner powered only while needed
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	Collects PI, PTY, PS, Radiotext and clock time of the tuned station
+	until the data asked for is complete or time budget is spent. Radiotext
+	is complete as rds_rt_add() says: up to 0x0D terminator or repeated
+	twice the same.
+
+	Stations are cached in a text file, one per line with tab separated
+	fields, together with time every item was last collected and group
+	schedule history: how many of the groups read were 0A/0B, 2A and 4A.
+	Harvester dwells on a station as long as the history says it takes
+	to complete the stale items, and skips items a station never sends.
+	Items expected to take longer than the budget, like clock time sent at
+	the start of every minute, do not extend the dwell and are kept only
+	if they come while other items are collected.
+*/
+
+#ifndef __SI4703_HARV_H__
+#define __SI4703_HARV_H__
+
+#include <stdint.h>
+#include "rds.h"
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+// data to collect
+#define HARV_PI  0x01
+#define HARV_PTY 0x02
+#define HARV_PS  0x04
+#define HARV_RT  0x08
+#define HARV_CT  0x10
+#define HARV_ITEMS 5
+
+#define HARV_ENV     "RDSPI_STATIONS"          // environment variable to override file name
+#define HARV_FILE    "/var/tmp/rdspi.stations" // survives reboot, unlike /tmp
+#define HARV_MAX     64                        // stations in cache
+#define HARV_SYNC_MS 500                       // no group in this time means no RDS
+#define HARV_HISTORY 200                       // groups to trust the schedule
+#define HARV_CT_MS   500                       // clock time after the minute starts
+
+typedef struct harv_st_s
+{
+	uint16_t freq;  // 9500 for 95.00 MHz
+	uint16_t pi;
+	uint8_t  pty;
+	uint8_t  have;  // HARV_* collected
+	char     ps[9];
+	char     rt[65];
+	rds_gt04a_t ct;
+	uint32_t groups;   // read in the last collection
+	uint8_t  rt_seg;   // segments of the last complete Radiotext
+	uint32_t seen[HARV_ITEMS]; // when item was collected, seconds since the Epoch
+	uint32_t quiet;    // when no RDS was found, 0 after any group
+	uint32_t hist;     // groups read in all collections
+	uint32_t hist_gt[3]; // of them 0A/0B, 2A, 4A
+	// decoders, reset for every collection
+	rds_gt00a_t rd0;
+	rds_rt_t    rd2;
+} harv_st_t;
+
+// parses 'ps,rt,ct' list, returns -1 if a name is unknown
+int  harv_parse(const char *str, uint8_t *need);
+// prints names of 'have' bits
+void harv_names(char *buf, uint8_t have);
+// collects station already tuned until 'need' is complete or 'budget' ms,
+// returns time to complete in ms or -1 if budget was spent or there is no
+// RDS, items collected are marked as seen at 'now'
+int  harv_collect(uint16_t *regs, harv_st_t *st, uint8_t need, uint32_t budget, uint32_t now);
+
+typedef struct harv_cache_s
+{
+	uint32_t  n;
+	harv_st_t st[HARV_MAX];
+} harv_cache_t;
+
+// missing file is an empty cache
+int  harv_load(harv_cache_t *hc);
+int  harv_save(const harv_cache_t *hc);
+// returns cached station, adds it if 'add' is set, NULL if not found or full
+harv_st_t *harv_find(harv_cache_t *hc, uint16_t freq, int add);
+// items of 'need' older than 'fresh' seconds, leaving out the ones the
+// station does not send according to its history, none if there was no
+// RDS on the last visit less than 'fresh' seconds ago
+uint8_t  harv_stale(const harv_st_t *st, uint8_t need, uint32_t now, uint32_t fresh);
+// items of 'need' expected to be collected within 'budget' ms at 'now_ms',
+// ms since the Epoch, slower ones are taken only if they happen to come
+uint8_t  harv_fits(const harv_st_t *st, uint8_t need, uint32_t budget, uint64_t now_ms);
+// expected time in ms to collect 'need', 'max' if history is too short
+uint32_t harv_dwell(const harv_st_t *st, uint8_t need, uint32_t max, uint64_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
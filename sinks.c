@@ -0,0 +1,345 @@
+/*	Fan-out output sinks
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "sinks.h"
+#include "jsonw.h"
+
+#define SINK_CHUNK   4096 // fits into free pipe slot, never blocks after POLLOUT
+#define SINK_RETRY   1000 // ms between reopen attempts
+#define SINK_WAIT_MS 100  // poll slice while blocked
+
+static const char *sink_types[] = { "stdout", "file", "fifo", "unix" };
+static const char *sink_policies[] = { "drop", "coalesce", "block" };
+
+static void (*sigpipe)(int); // restored by sinks_close()
+
+static uint64_t sink_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1000ull + ts.tv_nsec/1000000;
+}
+
+static uint32_t sink_count(const char *buf, uint32_t len)
+{
+	uint32_t n = 0;
+	for(const char *p = buf; (p = (const char *)memchr(p, '\n', buf + len - p)) != NULL; p++)
+		n++;
+	return n;
+}
+
+static int sink_open(sink_t *s)
+{
+	if (s->fd >= 0)
+		return 0;
+	if (s->type == SINK_STDOUT || s->type == SINK_FILE)
+		return -1; // gone for good
+	uint64_t now = sink_ms();
+	if (now < s->retry)
+		return -1;
+	s->retry = now + SINK_RETRY;
+
+	if (s->type == SINK_FIFO) {
+		// fails with ENXIO until there is a reader
+		s->fd = open(s->path, O_WRONLY | O_NONBLOCK);
+		return (s->fd < 0) ? -1 : 0;
+	}
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	// path is kept shorter than sun_path by sinks_add()
+	memcpy(addr.sun_path, s->path, strlen(s->path) + 1);
+	int sd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sd < 0)
+		return -1;
+	if (connect(sd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		close(sd);
+		return -1;
+	}
+	fcntl(sd, F_SETFL, fcntl(sd, F_GETFL) | O_NONBLOCK);
+	s->fd = sd;
+	return 0;
+}
+
+// reader went away, pending records are useless for the next one
+static void sink_lost(sink_t *s)
+{
+	s->dropped += sink_count(s->buf + s->off, s->len - s->off);
+	s->off = s->len = 0;
+	s->mid = 0;
+	s->lost++;
+	if (s->type != SINK_STDOUT)
+		close(s->fd);
+	s->fd = -1;
+}
+
+// writes pending data while sink is writable, returns -1 if reader is lost
+static int sink_flush(sink_t *s, int wait_ms)
+{
+	while(s->off < s->len) {
+		struct pollfd pfd = { s->fd, POLLOUT, 0 };
+		int ret = poll(&pfd, 1, wait_ms);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return 0;
+		if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+			sink_lost(s);
+			return -1;
+		}
+		uint32_t n = s->len - s->off;
+		if (n > SINK_CHUNK)
+			n = SINK_CHUNK;
+		ssize_t nw;
+		if (s->type == SINK_UNIX)
+			nw = send(s->fd, s->buf + s->off, n, MSG_DONTWAIT | MSG_NOSIGNAL);
+		else
+			nw = write(s->fd, s->buf + s->off, n);
+		if (nw < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			sink_lost(s);
+			return -1;
+		}
+		s->off += nw;
+		s->bytes += nw;
+		s->mid = (s->buf[s->off - 1] != '\n');
+	}
+	s->off = s->len = 0;
+	return 0;
+}
+
+// drops oldest pending records, except partially written one, to fit 'len'
+static void sink_coalesce(sink_t *s, uint32_t len)
+{
+	char *start = s->buf + s->off;
+	char *end = s->buf + s->len;
+	if (s->mid) {
+		start = (char *)memchr(start, '\n', end - start);
+		if (start == NULL)
+			return;
+		start++;
+	}
+	char *p = start;
+	uint32_t n = 0;
+	while(p < end && (uint32_t)(end - p) + (start - s->buf) + len > SINK_BUF) {
+		char *eol = (char *)memchr(p, '\n', end - p);
+		p = eol ? eol + 1 : end;
+		n++;
+	}
+	memmove(start, p, end - p);
+	s->len -= p - start;
+	s->coalesced += n;
+}
+
+void sinks_init(sinks_t *ss)
+{
+	memset(ss, 0, sizeof(sinks_t));
+}
+
+int sinks_add(sinks_t *ss, int fd, const char *spec)
+{
+	if (ss->n == SINK_MAX)
+		return -1;
+	sink_t *s = &ss->sink[ss->n];
+	memset(s, 0, sizeof(sink_t));
+	s->fd = -1;
+
+	int type;
+	for(type = 0; type <= SINK_UNIX; type++) {
+		size_t len = strlen(sink_types[type]);
+		if (strncmp(spec, sink_types[type], len) == 0 && strchr(":,", spec[len]))
+			break;
+	}
+	if (type > SINK_UNIX)
+		return -1;
+	s->type = type;
+	s->policy = (type == SINK_FILE) ? SINK_BLOCK : SINK_DROP;
+	spec += strlen(sink_types[type]);
+
+	if (type != SINK_STDOUT) {
+		if (*spec++ != ':')
+			return -1;
+		size_t len = strcspn(spec, ",");
+		if (len == 0 || len >= sizeof(s->path))
+			return -1;
+		memcpy(s->path, spec, len);
+		spec += len;
+	}
+	if (*spec == ',') {
+		int policy;
+		for(policy = 0; policy <= SINK_BLOCK; policy++) {
+			if (strcmp(spec + 1, sink_policies[policy]) == 0)
+				break;
+		}
+		if (policy > SINK_BLOCK)
+			return -1;
+		s->policy = policy;
+	}
+	else if (*spec)
+		return -1;
+
+	if (type == SINK_STDOUT)
+		s->fd = fd;
+	if (type == SINK_FILE && (s->fd = open(s->path, O_WRONLY | O_CREAT | O_APPEND, 0644)) < 0)
+		return -1;
+	if (type == SINK_FIFO) {
+		struct stat st;
+		if (stat(s->path, &st) != 0 && mkfifo(s->path, 0666) != 0)
+			return -1;
+		sink_open(s);
+	}
+	if (type == SINK_UNIX)
+		sink_open(s);
+
+	if ((s->buf = (char *)malloc(SINK_BUF)) == NULL) {
+		if (s->fd >= 0 && type != SINK_STDOUT)
+			close(s->fd);
+		return -1;
+	}
+	// a reader going away must not kill us
+	if (ss->n++ == 0)
+		sigpipe = signal(SIGPIPE, SIG_IGN);
+	return 0;
+}
+
+void sinks_write(sinks_t *ss, const char *rec, uint32_t len)
+{
+	for(int i = 0; i < ss->n; i++) {
+		sink_t *s = &ss->sink[i];
+		if ((s->fd < 0 && sink_open(s) != 0) || len > SINK_BUF) {
+			s->dropped++;
+			continue;
+		}
+
+		if (s->len + len > SINK_BUF && sink_flush(s, 0) != 0) {
+			s->dropped++;
+			continue;
+		}
+		if (s->len + len > SINK_BUF && s->off) {
+			memmove(s->buf, s->buf + s->off, s->len - s->off);
+			s->len -= s->off;
+			s->off = 0;
+		}
+		if (s->len + len > SINK_BUF) {
+			if (s->policy == SINK_COALESCE)
+				sink_coalesce(s, len);
+			if (s->policy == SINK_BLOCK) {
+				uint64_t start = sink_ms();
+				while(s->fd >= 0 && s->len) {
+					if (sink_flush(s, SINK_WAIT_MS) != 0)
+						break;
+				}
+				s->blocked_us += (sink_ms() - start)*1000;
+				if (s->fd < 0) {
+					s->dropped++;
+					continue;
+				}
+			}
+			if (s->len + len > SINK_BUF) {
+				s->dropped++;
+				continue;
+			}
+		}
+
+		memcpy(s->buf + s->len, rec, len);
+		s->len += len;
+		s->records++;
+		if (s->len - s->off > s->max_lag)
+			s->max_lag = s->len - s->off;
+		sink_flush(s, 0);
+	}
+}
+
+void sinks_poll(sinks_t *ss)
+{
+	for(int i = 0; i < ss->n; i++) {
+		sink_t *s = &ss->sink[i];
+		if (s->fd >= 0 && s->len)
+			sink_flush(s, 0);
+	}
+}
+
+void sinks_report(int fd, sinks_t *ss, int json)
+{
+	wbuf_t wb;
+	wbuf_init(&wb, fd);
+	for(int i = 0; i < ss->n; i++) {
+		sink_t *s = &ss->sink[i];
+		uint32_t lag = s->len - s->off;
+		if (json) {
+			jw_t jw;
+			jw_begin(&jw, &wb, "sink");
+			jw_str(&jw, "sink", sink_types[s->type]);
+			jw_str(&jw, "path", s->path);
+			jw_str(&jw, "policy", sink_policies[s->policy]);
+			jw_uint(&jw, "records", s->records);
+			jw_u64(&jw, "bytes", s->bytes);
+			jw_uint(&jw, "dropped", s->dropped);
+			jw_uint(&jw, "coalesced", s->coalesced);
+			jw_uint(&jw, "lost", s->lost);
+			jw_uint(&jw, "lag", lag);
+			jw_uint(&jw, "max_lag", s->max_lag);
+			jw_u64(&jw, "blocked_us", s->blocked_us);
+			jw_end(&jw);
+		}
+		else
+			wbuf_printf(&wb, "Sink %s%s%s (%s): %u records, %llu bytes, %u dropped, %u coalesced, "
+				"reader lost %u times, lag %u bytes, max %u, blocked %llu ms\n",
+				sink_types[s->type], s->path[0] ? ":" : "", s->path, sink_policies[s->policy],
+				s->records, (unsigned long long)s->bytes, s->dropped, s->coalesced,
+				s->lost, lag, s->max_lag, (unsigned long long)s->blocked_us/1000);
+	}
+	wbuf_flush(&wb);
+}
+
+void sinks_close(sinks_t *ss, uint32_t ms)
+{
+	uint64_t end = sink_ms() + ms;
+	for(int i = 0; i < ss->n; i++) {
+		sink_t *s = &ss->sink[i];
+		while(s->fd >= 0 && s->len && sink_ms() < end) {
+			if (sink_flush(s, SINK_WAIT_MS) != 0)
+				break;
+		}
+	}
+	for(int i = 0; i < ss->n; i++) {
+		sink_t *s = &ss->sink[i];
+		// what is left stays as lag in the report
+		s->dropped += sink_count(s->buf + s->off, s->len - s->off);
+		if (s->fd >= 0 && s->type != SINK_STDOUT)
+			close(s->fd);
+		s->fd = -1;
+		free(s->buf);
+		s->buf = NULL;
+	}
+	if (ss->n)
+		signal(SIGPIPE, sigpipe);
+}
@@ -0,0 +1,102 @@
+/*	Fan-out output sinks
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	The same records, lines of text or NDJSON, are written to several
+	sinks. Every sink has its own buffer and is written only when poll()
+	says it is writable, so a paused 'less' or a dead collector never
+	stalls RDS polling. When the buffer is full the sink policy decides:
+
+	  drop     - new record is dropped
+	  coalesce - oldest pending records are dropped, reader gets the latest
+	  block    - acquisition waits for the reader
+
+	Sink spec is TYPE[:PATH][,POLICY]:
+	  stdout           - command output, drop by default
+	  file:PATH        - appended, block by default
+	  fifo:PATH        - created if missing, drop by default
+	  unix:PATH        - connects to stream socket, drop by default
+	FIFO and socket are (re)opened once a second while there is no reader,
+	records are dropped meanwhile.
+*/
+
+#ifndef __SINKS_H__
+#define __SINKS_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+#define SINK_MAX 8
+#define SINK_BUF (64*1024) // per sink buffer
+
+#define SINK_STDOUT 0
+#define SINK_FILE   1
+#define SINK_FIFO   2
+#define SINK_UNIX   3
+
+#define SINK_DROP     0
+#define SINK_COALESCE 1
+#define SINK_BLOCK    2
+
+typedef struct sink_s
+{
+	uint8_t  type;
+	uint8_t  policy;
+	uint8_t  mid;      // first pending byte is in the middle of a record
+	int      fd;       // -1 if there is no reader
+	char     path[108];
+	uint64_t retry;    // next reopen attempt, ms
+	char    *buf;
+	uint32_t off;      // first pending byte
+	uint32_t len;
+	uint32_t records;  // accepted
+	uint32_t dropped;  // dropped, new or pending
+	uint32_t coalesced;
+	uint32_t lost;     // times reader went away
+	uint32_t max_lag;  // max pending bytes
+	uint64_t bytes;    // written
+	uint64_t blocked_us;
+} sink_t;
+
+typedef struct sinks_s
+{
+	int    n;
+	sink_t sink[SINK_MAX];
+} sinks_t;
+
+void sinks_init(sinks_t *ss);
+// 'fd' is used by stdout sink, returns -1 if spec is invalid or file cannot be opened
+int  sinks_add(sinks_t *ss, int fd, const char *spec);
+// queues record to every sink and writes as much as sinks take now
+void sinks_write(sinks_t *ss, const char *rec, uint32_t len);
+// writes pending data without waiting
+void sinks_poll(sinks_t *ss);
+// per sink counters, as NDJSON "sink" records if 'json'
+void sinks_report(int fd, sinks_t *ss, int json);
+// waits up to 'ms' for pending data and closes sinks, counters are kept for report
+void sinks_close(sinks_t *ss, uint32_t ms);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,109 @@
+/*	Si4703 power up timings learned per unit
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "siready.h"
+
+#define SI_READY_MARGIN 25 // %
+#define SI_READY_MIN    20 // ms, at least this much above learned time
+
+static const char *ready_file(void)
+{
+	return getenv(SI_READY_ENV) ? getenv(SI_READY_ENV) : SI_READY_FILE;
+}
+
+// 'Serial : 00000000xxxxxxxx' line of /proc/cpuinfo on Raspberry Pi
+static void ready_serial(char *serial, size_t size)
+{
+	char line[128], val[24];
+
+	serial[0] = '\0';
+	FILE *in = fopen("/proc/cpuinfo", "r");
+	if (in == NULL)
+		return;
+	while(fgets(line, sizeof(line), in)) {
+		if (sscanf(line, "Serial : %23s", val) == 1) {
+			snprintf(serial, size, "%s", val);
+			break;
+		}
+	}
+	fclose(in);
+}
+
+int si_ready_load(si_ready_t *rd, uint16_t chipid)
+{
+	char line[64], name[32], serial[24], str[24];
+	unsigned val;
+
+	memset(rd, 0, sizeof(*rd));
+	ready_serial(serial, sizeof(serial));
+	FILE *in = fopen(ready_file(), "r");
+	if (in) {
+		while(fgets(line, sizeof(line), in)) {
+			if (sscanf(line, "%31s %x", name, &val) == 2 && !strcmp(name, "chipid"))
+				rd->chipid = val;
+			else if (sscanf(line, "%31s %23s", name, str) == 2 && !strcmp(name, "serial"))
+				snprintf(rd->serial, sizeof(rd->serial), "%s", str);
+			else if (sscanf(line, "%31s %u", name, &val) != 2)
+				continue;
+			else if (!strcmp(name, "xosc_ms"))
+				rd->xosc_ms = val;
+			else if (!strcmp(name, "power_ms"))
+				rd->power_ms = val;
+			else if (!strcmp(name, "rssi_ms"))
+				rd->rssi_ms = val;
+			else if (!strcmp(name, "resets"))
+				rd->resets = val;
+		}
+		fclose(in);
+	}
+	if (rd->chipid == chipid && !strcmp(rd->serial, serial) && rd->resets && rd->xosc_ms <= SI_XOSC_MS)
+		return 0;
+
+	memset(rd, 0, sizeof(*rd));
+	rd->chipid  = chipid;
+	strcpy(rd->serial, serial);
+	rd->xosc_ms = SI_XOSC_MS;
+	return -1;
+}
+
+int si_ready_save(const si_ready_t *rd)
+{
+	FILE *out = fopen(ready_file(), "w");
+	if (out == NULL)
+		return -1;
+	fprintf(out, "chipid %04X\n", rd->chipid);
+	// no serial line off Raspberry Pi
+	if (rd->serial[0])
+		fprintf(out, "serial %s\n", rd->serial);
+	fprintf(out, "xosc_ms %u\npower_ms %u\nrssi_ms %u\nresets %u\n",
+		rd->xosc_ms, rd->power_ms, rd->rssi_ms, rd->resets);
+	return fclose(out);
+}
+
+uint32_t si_ready_wait(const si_ready_t *rd)
+{
+	if (rd->resets == 0)
+		return SI_XOSC_MS;
+	uint32_t margin = rd->xosc_ms*SI_READY_MARGIN/100;
+	if (margin < SI_READY_MIN)
+		margin = SI_READY_MIN;
+	uint32_t ms = rd->xosc_ms + margin;
+	return (ms > SI_XOSC_MS) ? SI_XOSC_MS : ms;
+}
@@ -0,0 +1,65 @@
+/*	Si4703 power up timings learned per unit
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	Crystal start up and power up times are datasheet worst cases, actual
+	ones are measured on every cold reset and kept in a small text file,
+	one 'name value' per line. Next reset waits for the learned time plus
+	a margin and polls the rest. CHIPID is the same for every chip of
+	one revision, so values are also keyed by the board serial number
+	from /proc/cpuinfo and dropped if either changes: moving SD card to
+	another Raspberry Pi learns again. Replacing the radio module on the
+	same board is not detected, use 'reset learn' then.
+*/
+
+#ifndef __SI4703_READY_H__
+#define __SI4703_READY_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+#define SI_READY_ENV  "RDSPI_READY"          // environment variable to override file name
+#define SI_READY_FILE "/var/tmp/rdspi.ready" // survives reboot, unlike /tmp
+#define SI_XOSC_MS    500                    // datasheet crystal start up time
+
+typedef struct si_ready_s
+{
+	uint16_t chipid;
+	char     serial[24]; // board serial, empty if not known
+	uint32_t xosc_ms;  // XOSCEN until tuned with settled RSSI and AFC
+	uint32_t power_ms; // power up until STC of the first tune
+	uint32_t rssi_ms;  // STC until first valid RSSI
+	uint32_t resets;   // number of measurements
+} si_ready_t;
+
+// returns 0 if values learned for 'chipid' on this board were loaded,
+// otherwise -1 and datasheet values
+int si_ready_load(si_ready_t *rd, uint16_t chipid);
+int si_ready_save(const si_ready_t *rd);
+// learned time plus safety margin, never above datasheet value
+uint32_t si_ready_wait(const si_ready_t *rd);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
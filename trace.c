@@ -0,0 +1,206 @@
+/*	Hot path tracing spans
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "trace.h"
+
+// log-linear buckets: values below 16 ns are exact, then 8 buckets
+// per power of two, up to 2^40 ns (18 minutes), error is within 12.5%
+#define TRACE_SUB   8
+#define TRACE_EXACT 16
+#define TRACE_MAXE  40
+#define TRACE_NBUCKETS (TRACE_EXACT + (TRACE_MAXE - 4)*TRACE_SUB)
+
+typedef struct trace_hist_s
+{
+	uint64_t count;
+	uint64_t max;
+	uint32_t bucket[TRACE_NBUCKETS];
+} trace_hist_t;
+
+// histograms of a thread, written by the owner thread only
+typedef struct trace_thread_s
+{
+	trace_hist_t hist[TRACE_NSPANS];
+	volatile int busy; // owned by a live thread
+	struct trace_thread_s *next;
+} trace_thread_t;
+
+static const char *trace_names[TRACE_NSPANS] = {
+	"si_read_regs", "si_read_status", "si_update", "si_set_channel", "si_seek", "get_ps_si",
+	"rds_parse_gt00a", "rds_parse_gt01a", "rds_parse_gt02a", "rds_parse_gt03a",
+	"rds_parse_gt04a", "rds_parse_gt05a", "rds_parse_gt08a", "rds_parse_gt10a",
+	"rds_parse_gt14a"
+};
+
+static trace_thread_t *threads;
+static __thread trace_thread_t *self;
+static pthread_key_t trace_key;
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+
+static inline uint64_t trace_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec;
+}
+
+static inline uint32_t trace_bucket(uint64_t ns)
+{
+	if (ns < TRACE_EXACT)
+		return ns;
+	uint32_t e = 63 - __builtin_clzll(ns);
+	if (e >= TRACE_MAXE)
+		return TRACE_NBUCKETS - 1;
+	return TRACE_EXACT + (e - 4)*TRACE_SUB + ((ns >> (e - 3)) & (TRACE_SUB - 1));
+}
+
+// lowest value of the bucket
+static uint64_t trace_value(uint32_t bucket)
+{
+	if (bucket < TRACE_EXACT)
+		return bucket;
+	bucket -= TRACE_EXACT;
+	uint32_t e = bucket/TRACE_SUB + 4;
+	return (1ull << e) | ((uint64_t)(bucket % TRACE_SUB) << (e - 3));
+}
+
+// thread exit: histograms stay in the list, block is free to be reused
+static void trace_release(void *th)
+{
+	__sync_lock_release(&((trace_thread_t *)th)->busy);
+}
+
+static void trace_key_init(void)
+{
+	pthread_key_create(&trace_key, trace_release);
+}
+
+static trace_thread_t *trace_self(void)
+{
+	if (self)
+		return self;
+	pthread_once(&trace_once, trace_key_init);
+	// take over a block of exited thread, so decode workers started
+	// over and over do not grow the list, counts keep adding up
+	for(trace_thread_t *th = threads; th; th = th->next) {
+		if (!th->busy && !__sync_lock_test_and_set(&th->busy, 1)) {
+			self = th;
+			break;
+		}
+	}
+	if (self == NULL) {
+		self = (trace_thread_t *)calloc(1, sizeof(trace_thread_t));
+		if (self == NULL)
+			return NULL;
+		self->busy = 1;
+		// lock-free push, threads list is never shrunk
+		do {
+			self->next = threads;
+		} while(!__sync_bool_compare_and_swap(&threads, self->next, self));
+	}
+	pthread_setspecific(trace_key, self);
+	return self;
+}
+
+trace_span_t trace_begin(uint32_t id)
+{
+	trace_span_t span;
+	span.id = id;
+	span.start = trace_ns();
+	return span;
+}
+
+void trace_end(trace_span_t *span)
+{
+	uint64_t ns = trace_ns() - span->start;
+	trace_thread_t *th = trace_self();
+	if (th == NULL || span->id >= TRACE_NSPANS)
+		return;
+	trace_hist_t *h = &th->hist[span->id];
+	h->count++;
+	h->bucket[trace_bucket(ns)]++;
+	if (ns > h->max)
+		h->max = ns;
+}
+
+static void trace_print_ns(char *buf, uint64_t ns)
+{
+	if (ns < 10000)
+		sprintf(buf, "%llu ns", (unsigned long long)ns);
+	else if (ns < 10000000)
+		sprintf(buf, "%llu us", (unsigned long long)ns/1000);
+	else
+		sprintf(buf, "%llu ms", (unsigned long long)ns/1000000);
+}
+
+static uint64_t trace_pct(const trace_hist_t *h, uint32_t pct)
+{
+	uint64_t n = (h->count*pct + 99)/100, sum = 0;
+	for(uint32_t i = 0; i < TRACE_NBUCKETS; i++) {
+		sum += h->bucket[i];
+		if (sum >= n && sum)
+			return trace_value(i);
+	}
+	return h->max;
+}
+
+void trace_dump(int fd)
+{
+#ifndef RDSPI_TRACE
+	dprintf(fd, "tracing is not compiled in, rebuild with 'make TRACE=1'\n");
+#endif
+	trace_hist_t *sum = (trace_hist_t *)calloc(TRACE_NSPANS, sizeof(trace_hist_t));
+	if (sum == NULL)
+		return;
+
+	// other threads may be updating their histograms, small skew is fine
+	for(trace_thread_t *th = threads; th; th = th->next) {
+		for(int s = 0; s < TRACE_NSPANS; s++) {
+			const trace_hist_t *h = &th->hist[s];
+			sum[s].count += h->count;
+			if (h->max > sum[s].max)
+				sum[s].max = h->max;
+			for(int i = 0; i < TRACE_NBUCKETS; i++)
+				sum[s].bucket[i] += h->bucket[i];
+		}
+	}
+
+	dprintf(fd, "%-16s %10s %10s %10s %10s\n", "span", "count", "p50", "p99", "max");
+	for(int s = 0; s < TRACE_NSPANS; s++) {
+		const trace_hist_t *h = &sum[s];
+		if (!h->count)
+			continue;
+		char p50[24], p99[24], max[24];
+		trace_print_ns(p50, trace_pct(h, 50));
+		trace_print_ns(p99, trace_pct(h, 99));
+		trace_print_ns(max, h->max);
+		dprintf(fd, "%-16s %10llu %10s %10s %10s\n", trace_names[s],
+			(unsigned long long)h->count, p50, p99, max);
+	}
+	free(sum);
+}
+
+void trace_reset(void)
+{
+	for(trace_thread_t *th = threads; th; th = th->next)
+		memset(th->hist, 0, sizeof(th->hist));
+}
@@ -0,0 +1,82 @@
+/*	Hot path tracing spans
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	TRACE_SPAN(id) measures time from the point it is placed to the end
+	of enclosing scope. Durations are added to histograms owned by the
+	calling thread, so recording takes no locks or atomics, trace_dump()
+	merges histograms of all threads. Histograms of exited threads are
+	kept and their blocks are reused by new threads.
+
+	Spans are compiled in only with RDSPI_TRACE defined, 'make TRACE=1'.
+*/
+
+#ifndef __RDSPI_TRACE_H__
+#define __RDSPI_TRACE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+enum {
+	TRACE_READ_REGS,
+	TRACE_READ_STATUS,
+	TRACE_UPDATE,
+	TRACE_SET_CHANNEL,
+	TRACE_SEEK,
+	TRACE_GET_PS,
+	TRACE_GT00A,
+	TRACE_GT01A,
+	TRACE_GT02A,
+	TRACE_GT03A,
+	TRACE_GT04A,
+	TRACE_GT05A,
+	TRACE_GT08A,
+	TRACE_GT10A,
+	TRACE_GT14A,
+	TRACE_NSPANS
+};
+
+typedef struct trace_span_s
+{
+	uint64_t start; // ns
+	uint32_t id;
+} trace_span_t;
+
+#ifdef RDSPI_TRACE
+#define TRACE_SPAN(id) \
+	trace_span_t _trace_span __attribute__((cleanup(trace_end))) = trace_begin(id)
+#else
+#define TRACE_SPAN(id) do {} while(0)
+#endif
+
+trace_span_t trace_begin(uint32_t id);
+void trace_end(trace_span_t *span);
+
+// prints count, p50, p99 and max of every span
+void trace_dump(int fd);
+void trace_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
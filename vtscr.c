@@ -0,0 +1,198 @@
+/*	Diff-rendered VT100 screen
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <time.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+#include "vtscr.h"
+#include "wbuf.h"
+
+// unchanged characters shorter than that are rewritten instead of
+// moving the cursor over them, cursor move takes up to 8 bytes
+#define SCR_GAP 8
+
+static const char txt_nor[] = { 27, '[', '0', 'm', '\0' }; // normal text
+static const char txt_rev[] = { 27, '[', '7', 'm', '\0' }; // reverse text
+
+static void scr_goto(wbuf_t *wb, uint16_t row, uint16_t col)
+{
+	wbuf_putc(wb, 27);
+	wbuf_putc(wb, '[');
+	wbuf_uint(wb, row + 1, 0);
+	wbuf_putc(wb, ';');
+	wbuf_uint(wb, col + 1, 0);
+	wbuf_putc(wb, 'H');
+}
+
+static void scr_render(scr_t *scr)
+{
+	wbuf_t wb;
+	wbuf_init(&wb, scr->fd);
+
+	for(uint16_t r = 0; r < scr->rows; r++) {
+		const char *cur = scr->cur[r];
+		char *prev = scr->prev[r];
+		uint16_t c = 0;
+		while(c < scr->cols) {
+			if (cur[c] == prev[c]) {
+				c++;
+				continue;
+			}
+			uint16_t start = c, end = c + 1;
+			for(uint16_t i = end; i < scr->cols && (i - end) < SCR_GAP; i++) {
+				if (cur[i] != prev[i])
+					end = i + 1;
+			}
+			scr_goto(&wb, r, start);
+			if (r < scr->hdr_rows)
+				wbuf_puts(&wb, txt_rev);
+			for(uint16_t i = start; i < end; i++)
+				wbuf_putc(&wb, cur[i]);
+			if (r < scr->hdr_rows)
+				wbuf_puts(&wb, txt_nor);
+			c = end;
+		}
+		memcpy(prev, cur, scr->cols);
+	}
+	scr->bytes += wb.len;
+	scr->rendered++;
+	wbuf_flush(&wb);
+}
+
+static void *scr_thread(void *arg)
+{
+	scr_t *scr = (scr_t *)arg;
+
+	pthread_mutex_lock(&scr->lock);
+	while(1) {
+		while(!scr->dirty && !scr->stop)
+			pthread_cond_wait(&scr->wake, &scr->lock);
+		if (!scr->dirty)
+			break;
+		memcpy(scr->cur, scr->next, sizeof(scr->cur));
+		if (scr->next_rows > scr->nrows)
+			scr->nrows = scr->next_rows;
+		scr->dirty = 0;
+		pthread_mutex_unlock(&scr->lock);
+
+		scr_render(scr);
+
+		// newer frames wait till the end of refresh period
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec  += scr->refresh_ms/1000;
+		ts.tv_nsec += (scr->refresh_ms%1000)*1000000;
+		if (ts.tv_nsec >= 1000000000) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000;
+		}
+		pthread_mutex_lock(&scr->lock);
+		while(!scr->stop) {
+			if (pthread_cond_timedwait(&scr->wake, &scr->lock, &ts) == ETIMEDOUT)
+				break;
+		}
+	}
+	pthread_mutex_unlock(&scr->lock);
+	return NULL;
+}
+
+int scr_start(scr_t *scr, int fd, uint16_t hdr_rows, uint32_t refresh_ms)
+{
+	struct winsize ws;
+
+	scr->fd = fd;
+	scr->rows = SCR_ROWS;
+	scr->cols = SCR_COLS;
+	// lines must not wrap, otherwise rows on the screen are not known
+	if (ioctl(fd, TIOCGWINSZ, &ws) == 0 && ws.ws_row && ws.ws_col) {
+		if (ws.ws_row < scr->rows)
+			scr->rows = ws.ws_row;
+		if (ws.ws_col - 1 < scr->cols)
+			scr->cols = ws.ws_col - 1;
+	}
+	scr->hdr_rows = hdr_rows;
+	scr->nrows = 0;
+	scr->refresh_ms = refresh_ms;
+	scr->posted = scr->rendered = 0;
+	scr->bytes = 0;
+	scr->dirty = scr->stop = 0;
+	scr->next_rows = 0;
+	memset(scr->next, ' ', sizeof(scr->next));
+	memset(scr->prev, ' ', sizeof(scr->prev));
+	// header rows are not reversed on cleared screen yet
+	memset(scr->prev, 0, sizeof(scr->prev[0])*hdr_rows);
+
+	pthread_mutex_init(&scr->lock, NULL);
+	pthread_cond_init(&scr->wake, NULL);
+	if (pthread_create(&scr->tid, NULL, scr_thread, scr) != 0) {
+		pthread_mutex_destroy(&scr->lock);
+		pthread_cond_destroy(&scr->wake);
+		return -1;
+	}
+	return 0;
+}
+
+void scr_stop(scr_t *scr)
+{
+	pthread_mutex_lock(&scr->lock);
+	scr->stop = 1;
+	pthread_cond_signal(&scr->wake);
+	pthread_mutex_unlock(&scr->lock);
+	pthread_join(scr->tid, NULL);
+	pthread_mutex_destroy(&scr->lock);
+	pthread_cond_destroy(&scr->wake);
+
+	wbuf_t wb;
+	wbuf_init(&wb, scr->fd);
+	scr_goto(&wb, scr->nrows < scr->rows ? scr->nrows : scr->rows, 0);
+	wbuf_flush(&wb);
+}
+
+void scr_frame(scr_t *scr, const char *text, uint32_t len)
+{
+	uint16_t row = 0;
+	const char *end = text + len;
+
+	pthread_mutex_lock(&scr->lock);
+	while(text < end && row < SCR_ROWS) {
+		const char *eol = (const char *)memchr(text, '\n', end - text);
+		if (eol == NULL)
+			eol = end;
+		uint32_t n = eol - text;
+		if (n > SCR_COLS)
+			n = SCR_COLS;
+		memcpy(scr->next[row], text, n);
+		memset(scr->next[row] + n, ' ', SCR_COLS - n);
+		row++;
+		text = eol + 1;
+	}
+	if (row < SCR_ROWS)
+		memset(scr->next[row], ' ', (SCR_ROWS - row)*SCR_COLS);
+	scr->next_rows = row;
+	scr->posted++;
+	scr->dirty = 1;
+	pthread_cond_signal(&scr->wake);
+	pthread_mutex_unlock(&scr->lock);
+}
+
+void scr_report(int fd, const scr_t *scr)
+{
+	dprintf(fd, "Screen %u frames posted, %u rendered, %llu bytes written\n",
+		scr->posted, scr->rendered, (unsigned long long)scr->bytes);
+}
@@ -0,0 +1,78 @@
+/*	Diff-rendered VT100 screen
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	Full-screen 'rds' monitor used to redraw every line on every group,
+	about 1.5 KB per group, more than a 115200 serial console can take.
+	Now the acquisition thread only posts frames, plain text lines, with
+	scr_frame(). A renderer thread picks up the latest frame at most once
+	per refresh period, compares it with what is on the screen already and
+	writes cursor moves and changed characters only. Frames posted between
+	two refreshes are skipped, so slow output never delays RDS polling.
+*/
+
+#ifndef __VT_SCREEN_H__
+#define __VT_SCREEN_H__
+
+#include <stdint.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+#define SCR_ROWS 24
+#define SCR_COLS 256
+#define SCR_REFRESH_MS 200 // default refresh period
+
+typedef struct scr_s
+{
+	int      fd;
+	uint16_t rows;     // visible part of the frame, clipped to terminal size
+	uint16_t cols;
+	uint16_t hdr_rows; // top rows shown in reverse video
+	uint16_t nrows;    // lines in the last rendered frame
+	uint32_t refresh_ms;
+	uint32_t posted;   // frames posted
+	uint32_t rendered; // frames rendered
+	uint64_t bytes;    // bytes written
+	int      dirty;
+	int      stop;
+	uint16_t next_rows;
+	char next[SCR_ROWS][SCR_COLS]; // latest posted frame
+	char cur[SCR_ROWS][SCR_COLS];  // frame being rendered
+	char prev[SCR_ROWS][SCR_COLS]; // what is on the screen
+	pthread_t       tid;
+	pthread_mutex_t lock;
+	pthread_cond_t  wake;
+} scr_t;
+
+// starts renderer thread, screen is expected to be cleared already
+int  scr_start(scr_t *scr, int fd, uint16_t hdr_rows, uint32_t refresh_ms);
+// renders pending frame, stops the thread and moves cursor below the frame
+void scr_stop(scr_t *scr);
+// posts new frame, lines separated by '\n'
+void scr_frame(scr_t *scr, const char *text, uint32_t len);
+void scr_report(int fd, const scr_t *scr);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,157 @@
+/*	Buffered output writer
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <errno.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "wbuf.h"
+
+static const char hex[] = "0123456789ABCDEF";
+
+void wbuf_init(wbuf_t *wb, int fd)
+{
+	wb->fd  = fd;
+	wb->len = 0;
+}
+
+int wbuf_flush(wbuf_t *wb)
+{
+	uint32_t off = 0;
+	while(off < wb->len) {
+		ssize_t n = write(wb->fd, wb->buf + off, wb->len - off);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			wb->len = 0;
+			return -1;
+		}
+		off += n;
+	}
+	wb->len = 0;
+	return 0;
+}
+
+// makes sure 'n' bytes fit, 'n' must not exceed WBUF_SIZE
+static inline char *wbuf_room(wbuf_t *wb, uint32_t n)
+{
+	if (wb->len + n > WBUF_SIZE)
+		wbuf_flush(wb);
+	return wb->buf + wb->len;
+}
+
+void wbuf_putc(wbuf_t *wb, char c)
+{
+	*wbuf_room(wb, 1) = c;
+	wb->len++;
+}
+
+void wbuf_fill(wbuf_t *wb, char c, uint32_t n)
+{
+	while(n) {
+		uint32_t len = (n > WBUF_SIZE) ? WBUF_SIZE : n;
+		memset(wbuf_room(wb, len), c, len);
+		wb->len += len;
+		n -= len;
+	}
+}
+
+void wbuf_puts(wbuf_t *wb, const char *str)
+{
+	uint32_t n = strlen(str);
+	while(n) {
+		uint32_t len = (n > WBUF_SIZE) ? WBUF_SIZE : n;
+		memcpy(wbuf_room(wb, len), str, len);
+		wb->len += len;
+		str += len;
+		n -= len;
+	}
+}
+
+// 'neg' adds minus sign before the digits
+static void wbuf_dec(wbuf_t *wb, uint32_t val, uint8_t width, int neg)
+{
+	char tmp[12];
+	uint8_t n = 0;
+	do {
+		tmp[n++] = '0' + val % 10;
+		val /= 10;
+	} while(val);
+	if (neg)
+		tmp[n++] = '-';
+
+	if (width > 32)
+		width = 32;
+	char *p = wbuf_room(wb, n > width ? n : width);
+	for(; width > n; width--)
+		*p++ = ' ';
+	while(n)
+		*p++ = tmp[--n];
+	wb->len = p - wb->buf;
+}
+
+void wbuf_uint(wbuf_t *wb, uint32_t val, uint8_t width)
+{
+	wbuf_dec(wb, val, width, 0);
+}
+
+void wbuf_int(wbuf_t *wb, int32_t val, uint8_t width)
+{
+	if (val < 0)
+		wbuf_dec(wb, -(uint32_t)val, width, 1);
+	else
+		wbuf_dec(wb, val, width, 0);
+}
+
+void wbuf_hex(wbuf_t *wb, uint32_t val, uint8_t digits)
+{
+	uint8_t n = 1;
+	while(n < 8 && (val >> (n*4)))
+		n++;
+	if (digits > 8)
+		digits = 8;
+	if (n < digits)
+		n = digits;
+	char *p = wbuf_room(wb, n);
+	for(int i = n - 1; i >= 0; i--)
+		*p++ = hex[(val >> (i*4)) & 0x0F];
+	wb->len += n;
+}
+
+void wbuf_printf(wbuf_t *wb, const char *fmt, ...)
+{
+	va_list ap;
+	for(int i = 0; i < 2; i++) {
+		uint32_t room = WBUF_SIZE - wb->len;
+		va_start(ap, fmt);
+		int n = vsnprintf(wb->buf + wb->len, room, fmt, ap);
+		va_end(ap);
+		if (n < 0)
+			return;
+		if ((uint32_t)n < room) {
+			wb->len += n;
+			return;
+		}
+		if (i || wb->len == 0) {
+			// does not fit even in empty buffer
+			wb->len = WBUF_SIZE - 1;
+			return;
+		}
+		wbuf_flush(wb);
+	}
+}
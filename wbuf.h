@@ -0,0 +1,65 @@
+/*	Buffered output writer
+	Copyright (c) 2015 Andrey Chilikin (https://github.com/achilikin)
+
+	This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+	Every dprintf() is a write() syscall, so a line printed field by field
+	costs a dozen of them. wbuf_t collects a line or a whole screen in a
+	fixed buffer, usually on the stack, and writes it with one write().
+	Nothing is allocated, the buffer is flushed early only if it fills up.
+*/
+
+#ifndef __WBUF_H__
+#define __WBUF_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#if 0 // dummy bracket for VAssistX
+}
+#endif
+#endif
+
+#define WBUF_SIZE 4096
+
+typedef struct wbuf_s
+{
+	int      fd;
+	uint32_t len;
+	char     buf[WBUF_SIZE];
+} wbuf_t;
+
+void wbuf_init(wbuf_t *wb, int fd);
+// writes buffered data, returns -1 on error
+int  wbuf_flush(wbuf_t *wb);
+
+void wbuf_putc(wbuf_t *wb, char c);
+// 'n' copies of character 'c'
+void wbuf_fill(wbuf_t *wb, char c, uint32_t n);
+void wbuf_puts(wbuf_t *wb, const char *str);
+// decimal, right aligned to 'width' with spaces
+void wbuf_uint(wbuf_t *wb, uint32_t val, uint8_t width);
+void wbuf_int(wbuf_t *wb, int32_t val, uint8_t width);
+// upper case hex, zero padded to 'digits'
+void wbuf_hex(wbuf_t *wb, uint32_t val, uint8_t digits);
+// for the rest, output longer than WBUF_SIZE is truncated
+void wbuf_printf(wbuf_t *wb, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#ifdef __cplusplus
+}
+#endif
+#endif